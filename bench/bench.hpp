@@ -0,0 +1,218 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <random>
+#include <string>
+#include <vector>
+#include "memory_resource.hpp"
+
+namespace bench_constants {
+    // Every input is generated from this seed unless --seed says otherwise, so runs are comparable
+    const uint64_t default_seed = 0x62656e6368;
+    // Timings are the median of this many runs, after one warm-up run
+    const int default_repetitions = 5;
+}
+
+// Minimal benchmark harness. BENCH(name) { ... } defines a benchmark; it generates its inputs from bench::rng()
+// (reseeded before every benchmark from the seed and the benchmark's name) and reports through bench::report.
+//
+//     ./hash_bench [filter] [--quick] [--full] [--seed=N] [--reps=N] [--threads=N]
+//
+// --quick shrinks every size (a smoke run, which is what ctest does), --full adds the largest sizes.
+// The first lines of the output record the compiler, flags, ISA and seed the numbers were taken with
+namespace bench {
+    struct options {
+        uint64_t seed = bench_constants::default_seed;
+        int repetitions = bench_constants::default_repetitions;
+        bool quick = false;
+        bool full = false;
+        // Largest thread count of the scaling benchmarks
+        int max_threads = 0;
+        const char *filter = nullptr;
+    };
+
+    inline options &opts() {
+        static options o;
+        return o;
+    }
+
+    struct benchmark {
+        const char *name;
+        void (*run)();
+    };
+
+    inline std::vector<benchmark> &benchmarks() {
+        static std::vector<benchmark> all;
+        return all;
+    }
+
+    struct registrar {
+        registrar(const char *name, void (*run)()) {
+            benchmarks().push_back(benchmark{name, run});
+        }
+    };
+
+    inline std::mt19937_64 &rng() {
+        static std::mt19937_64 r;
+        return r;
+    }
+
+    // Uniform in [0, n)
+    inline uint64_t random(uint64_t n) {
+        return n == 0 ? 0 : rng()() % n;
+    }
+
+    // n distinct keys of 8 to 24 characters
+    inline std::vector<std::string> distinct_strings(size_t n, const char *tag = "key") {
+        std::vector<std::string> keys;
+        keys.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            std::string s(random(8), 'a');
+            for (char &c : s) {
+                c = (char) ('a' + random(26));
+            }
+            keys.push_back(s + tag + std::to_string(i));
+        }
+        return keys;
+    }
+
+    // Benchmark sizes: the default ones, cut to the first quick_count with --quick, plus full_only with --full
+    inline std::vector<size_t> sizes(std::initializer_list<size_t> normal, size_t quick_count = 1,
+                                     std::initializer_list<size_t> full_only = {}) {
+        std::vector<size_t> s(normal);
+        if (opts().quick) {
+            s.resize(std::min(s.size(), quick_count));
+        } else if (opts().full) {
+            s.insert(s.end(), full_only);
+        }
+        return s;
+    }
+
+    // 1, 2, 4, ... up to --threads (or the number of cores)
+    inline std::vector<int> thread_counts() {
+        std::vector<int> counts;
+        for (int t = 1; t < opts().max_threads; t *= 2) {
+            counts.push_back(t);
+        }
+        counts.push_back(opts().max_threads);
+        return counts;
+    }
+
+    // Keeps the compiler from optimizing away the computation of value
+    template <typename T>
+    inline void do_not_optimize(const T &value) {
+#if defined(__GNUC__)
+        asm volatile("" : : "g"(&value) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &value;
+#endif
+    }
+
+    inline uint64_t now_ns() {
+        return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Median wall time of f over the repetitions, in seconds. setup runs before every repetition, untimed
+    template <typename Setup, typename F>
+    double measure(Setup setup, F f) {
+        std::vector<double> times;
+        for (int r = 0; r <= opts().repetitions; r++) {
+            setup();
+            uint64_t start = now_ns();
+            f();
+            uint64_t elapsed = now_ns() - start;
+            // The first run only warms caches and the allocator up
+            if (r > 0) times.push_back((double) elapsed / 1e9);
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    template <typename F>
+    double measure(F f) {
+        return measure([]() { }, f);
+    }
+
+    // One result line: what was measured, on what, and the time per operation over ops operations
+    inline void report(const std::string &what, const std::string &config, size_t ops, double seconds,
+                       const std::string &extra = "") {
+        double ns = ops > 0 ? seconds * 1e9 / (double) ops : 0;
+        double mops = seconds > 0 ? (double) ops / seconds / 1e6 : 0;
+        printf("  %-34s %-22s %10.2f ns/op %10.2f Mops/s  %s\n", what.c_str(), config.c_str(), ns, mops,
+               extra.c_str());
+        fflush(stdout);
+    }
+
+    // A line of measurements that aren't timings (sizes, rates, counts)
+    inline void note(const std::string &what, const std::string &config, const std::string &values) {
+        printf("  %-34s %-22s %s\n", what.c_str(), config.c_str(), values.c_str());
+        fflush(stdout);
+    }
+
+    inline std::string format(const char *fmt, double value) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), fmt, value);
+        return buffer;
+    }
+
+    inline std::string size_name(size_t n) {
+        if (n >= 1000000 && n % 1000000 == 0) return std::to_string(n / 1000000) + "M";
+        if (n >= 1000 && n % 1000 == 0) return std::to_string(n / 1000) + "K";
+        return std::to_string(n);
+    }
+
+    // p-th percentile (0 <= p <= 1) of samples, which it sorts
+    inline uint64_t percentile(std::vector<uint64_t> &samples, double p) {
+        if (samples.empty()) return 0;
+        std::sort(samples.begin(), samples.end());
+        auto index = (size_t) (p * (double) (samples.size() - 1));
+        return samples[index];
+    }
+
+    // Hands everything on to upstream, counting the calls
+    class counting_resource : public mstd::memory_resource {
+    public:
+        explicit counting_resource(mstd::memory_resource *upstream = mstd::default_resource())
+                : _upstream(upstream), _allocations(0), _bytes(0) { }
+
+        // Calls to allocate so far, and bytes still allocated
+        size_t allocations() const { return _allocations; }
+
+        long bytes() const { return _bytes; }
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            _allocations++;
+            _bytes += (long) bytes;
+            return _upstream->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+            _bytes -= (long) bytes;
+            _upstream->deallocate(p, bytes, alignment);
+        }
+
+    private:
+        mstd::memory_resource *_upstream;
+        size_t _allocations;
+        long _bytes;
+    };
+}
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+#define BENCH(name) \
+    static void BENCH_CONCAT(bench_, name)(); \
+    static bench::registrar BENCH_CONCAT(name, _registrar)(#name, &BENCH_CONCAT(bench_, name)); \
+    static void BENCH_CONCAT(bench_, name)()
+
+#endif // BENCH_HPP
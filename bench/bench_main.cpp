@@ -0,0 +1,93 @@
+#include <cstring>
+#include <exception>
+#include <thread>
+#include "simd.hpp"
+#include "bench.hpp"
+
+static uint64_t name_hash(const char *name) {
+    uint64_t h = 14695981039346656037ULL;
+    for (const char *c = name; *c != '\0'; c++) {
+        h = (h ^ (unsigned char) *c) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static bool parse(int argc, char **argv) {
+    bench::options &o = bench::opts();
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--quick") == 0) {
+            o.quick = true;
+            o.repetitions = 1;
+        } else if (strcmp(arg, "--full") == 0) {
+            o.full = true;
+        } else if (strncmp(arg, "--seed=", 7) == 0) {
+            o.seed = strtoull(arg + 7, nullptr, 0);
+        } else if (strncmp(arg, "--reps=", 7) == 0) {
+            o.repetitions = std::max(1, atoi(arg + 7));
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            o.max_threads = std::max(1, atoi(arg + 10));
+        } else if (arg[0] != '-') {
+            o.filter = arg;
+        } else {
+            fprintf(stderr, "usage: %s [filter] [--quick] [--full] [--seed=N] [--reps=N] [--threads=N]\n", argv[0]);
+            return false;
+        }
+    }
+    if (o.max_threads == 0) {
+        o.max_threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    return true;
+}
+
+// Everything the numbers depend on besides the machine, so that two runs can be compared
+static void print_header(const char *program) {
+    const bench::options &o = bench::opts();
+#if defined(__OPTIMIZE__)
+    const char *optimized = "yes";
+#else
+    const char *optimized = "no";
+    fprintf(stderr, "warning: %s was built without optimizations, configure with -DCMAKE_BUILD_TYPE=Release\n",
+            program);
+#endif
+#if defined(__VERSION__)
+    const char *compiler = __VERSION__;
+#else
+    const char *compiler = "unknown";
+#endif
+    printf("%s\n", program);
+    printf("compiler: %s, optimized: %s, asserts: %s\n", compiler, optimized,
+#if defined(NDEBUG)
+           "off"
+#else
+           "on"
+#endif
+    );
+    printf("simd: %s (detected %s)\n", mstd::simd::isa_name(mstd::simd::current_isa()),
+           mstd::simd::isa_name(mstd::simd::detected_isa()));
+    printf("seed: %#llx, repetitions: %d (median), threads: up to %d of %u, sizes: %s\n",
+           (unsigned long long) o.seed, o.repetitions, o.max_threads, std::thread::hardware_concurrency(),
+           o.quick ? "quick" : o.full ? "full" : "default");
+}
+
+int main(int argc, char **argv) {
+    if (!parse(argc, argv)) return 2;
+    print_header(argv[0]);
+
+    size_t run = 0;
+    for (const bench::benchmark &b : bench::benchmarks()) {
+        if (bench::opts().filter != nullptr && strstr(b.name, bench::opts().filter) == nullptr) continue;
+
+        printf("\n%s\n", b.name);
+        // Same inputs for a benchmark whichever others run before it
+        bench::rng().seed(bench::opts().seed ^ name_hash(b.name));
+        try {
+            b.run();
+        } catch (const std::exception &e) {
+            fprintf(stderr, "%s failed: %s\n", b.name, e.what());
+            return 1;
+        }
+        run++;
+    }
+    return run > 0 ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+#ifndef COUNTING_NEW_HPP
+#define COUNTING_NEW_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new and delete with ones that count the calling thread's allocations and live
+// bytes, so that the std containers (and anything else that goes through new) can be measured the way a
+// bench::counting_resource measures the mstd ones. The size is kept in front of the block.
+// Include it from one file of a benchmark binary only. Every new of that binary pays for the counting
+namespace counting_new {
+    const size_t header_bytes = alignof(std::max_align_t);
+    // Calls to operator new, and bytes allocated and not freed yet, on this thread
+    thread_local size_t calls = 0;
+    thread_local long bytes = 0;
+}
+
+void *operator new(size_t bytes) {
+    auto *p = static_cast<char *>(malloc(bytes + counting_new::header_bytes));
+    if (p == nullptr) throw std::bad_alloc();
+    *reinterpret_cast<size_t *>(p) = bytes;
+    counting_new::calls++;
+    counting_new::bytes += (long) bytes;
+    return p + counting_new::header_bytes;
+}
+
+// Forwards to the counting new rather than rely on the library's: std::get_temporary_buffer allocates with it,
+// and a sanitizer's own nothrow new wouldn't leave the header in front of the block
+void *operator new(size_t bytes, const std::nothrow_t &) noexcept {
+    try {
+        return operator new(bytes);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void operator delete(void *p) noexcept {
+    if (p == nullptr) return;
+    char *block = static_cast<char *>(p) - counting_new::header_bytes;
+    counting_new::bytes -= (long) *reinterpret_cast<size_t *>(block);
+    free(block);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    operator delete(p);
+}
+
+#endif // COUNTING_NEW_HPP
@@ -0,0 +1,170 @@
+#include <string>
+#include <vector>
+#include "binary_fuse_filter.hpp"
+#include "bloom_filter.hpp"
+#include "cuckoo_filter.hpp"
+#include "thread_pool.hpp"
+#include "bench.hpp"
+
+namespace filter_bench_constants {
+    // The bloom filter gets about as many bits per key as an 8-bit fuse filter, with its optimal k
+    const size_t bloom_bits_per_key = 10;
+    const int bloom_hashes = 7;
+}
+
+struct filter_inputs {
+    std::vector<std::string> keys;
+    // Keys that were never added: every hit on one is a false positive
+    std::vector<std::string> others;
+    mstd::vector<std::string> key_vector;
+
+    explicit filter_inputs(size_t n) : keys(bench::distinct_strings(n)), others(bench::distinct_strings(n, "other")),
+                                       key_vector(n) {
+        for (const std::string &key : keys) {
+            key_vector.push(key);
+        }
+    }
+};
+
+// Times a pass of check over keys, and returns the fraction that passed
+template <typename Check>
+static double time_queries(const std::string &what, const std::string &config, const std::vector<std::string> &keys,
+                           Check check) {
+    size_t passed = 0;
+    double seconds = bench::measure([&]() {
+        passed = 0;
+        for (const std::string &key : keys) {
+            passed += check(key);
+        }
+        bench::do_not_optimize(passed);
+    });
+    double rate = (double) passed / (double) keys.size();
+    bench::report(what, config, keys.size(), seconds, "pass rate " + bench::format("%.5f", rate));
+    return rate;
+}
+
+template <typename F>
+static void fuse_queries(const filter_inputs &in, const std::string &config, const char *name) {
+    binary_fuse_filter<F> filter(in.key_vector);
+    bench::note(std::string(name) + " size", config, bench::format("%.2f bits/key", filter.bits_per_key()));
+    time_queries(std::string(name) + " hit", config, in.keys, [&](const std::string &k) { return filter.check(k); });
+    time_queries(std::string(name) + " miss", config, in.others, [&](const std::string &k) { return filter.check(k); });
+}
+
+template <typename F>
+static void cuckoo_queries(const filter_inputs &in, const std::string &config, const char *name) {
+    cuckoo_filter<F> filter(in.keys.size());
+    for (const std::string &key : in.keys) {
+        filter.insert(key);
+    }
+    bench::note(std::string(name) + " size", config, bench::format("%.2f bits/key", filter.bits_per_key()) +
+                bench::format(", load %.3f", filter.load_factor()));
+    time_queries(std::string(name) + " hit", config, in.keys, [&](const std::string &k) { return filter.check(k); });
+    time_queries(std::string(name) + " miss", config, in.others, [&](const std::string &k) { return filter.check(k); });
+}
+
+// Bits per key, false positive rate (the miss pass rate) and queries per second of every filter on the same keys
+BENCH(filter_queries) {
+    for (size_t n : bench::sizes({100000, 1000000}, 1, {10000000})) {
+        filter_inputs in(n);
+        std::string config = "n=" + bench::size_name(n);
+
+        bloom_filter bloom(n * filter_bench_constants::bloom_bits_per_key, filter_bench_constants::bloom_hashes);
+        for (const std::string &key : in.keys) {
+            bloom.insert(key);
+        }
+        bench::note("bloom size", config, bench::format("%.2f bits/key", (double) filter_bench_constants::bloom_bits_per_key));
+        time_queries("bloom hit", config, in.keys, [&](const std::string &k) { return bloom.check(k); });
+        time_queries("bloom miss", config, in.others, [&](const std::string &k) { return bloom.check(k); });
+
+        fuse_queries<uint8_t>(in, config, "binary_fuse8");
+        fuse_queries<uint16_t>(in, config, "binary_fuse16");
+        cuckoo_queries<uint8_t>(in, config, "cuckoo8");
+        cuckoo_queries<uint16_t>(in, config, "cuckoo16");
+    }
+}
+
+// Construction: the fuse filter serially and on a thread_pool, against inserting every key into the others
+BENCH(filter_build) {
+    thread_pool pool(bench::opts().max_threads);
+    for (size_t n : bench::sizes({100000, 1000000}, 1, {10000000})) {
+        filter_inputs in(n);
+        std::string config = "n=" + bench::size_name(n);
+
+        double seconds = bench::measure([&]() {
+            bloom_filter bloom(n * filter_bench_constants::bloom_bits_per_key, filter_bench_constants::bloom_hashes);
+            for (const std::string &key : in.keys) {
+                bloom.insert(key);
+            }
+        });
+        bench::report("bloom insert all", config, n, seconds);
+
+        seconds = bench::measure([&]() {
+            binary_fuse_filter<uint8_t> filter(in.key_vector);
+            bench::do_not_optimize(filter);
+        });
+        bench::report("binary_fuse8 build", config, n, seconds);
+
+        seconds = bench::measure([&]() {
+            binary_fuse_filter<uint8_t> filter(in.key_vector, &pool);
+            bench::do_not_optimize(filter);
+        });
+        bench::report("binary_fuse8 build on pool", config + " t=" + std::to_string(bench::opts().max_threads),
+                      n, seconds);
+
+        seconds = bench::measure([&]() {
+            cuckoo_filter<uint8_t> filter(n);
+            for (const std::string &key : in.keys) {
+                filter.insert(key);
+            }
+        });
+        bench::report("cuckoo8 insert all", config, n, seconds);
+    }
+}
+
+// How full a cuckoo filter gets before an insert fails, and what inserts and removes cost as it fills up
+template <typename F>
+static void cuckoo_load(size_t capacity, const char *name) {
+    std::string config = "capacity=" + bench::size_name(capacity);
+    std::vector<std::string> keys = bench::distinct_strings(capacity * 2);
+
+    cuckoo_filter<F> filter(capacity);
+    size_t inserted = 0;
+    while (inserted < keys.size() && filter.insert(keys[inserted])) {
+        inserted++;
+    }
+    bench::note(std::string(name) + " max load", config, bench::format("%.4f", filter.load_factor()) +
+                bench::format(" (%.0f keys", (double) inserted) + bench::format(" of %.0f slots)", (double) filter.capacity()));
+
+    // Inserts from load - step to load, then removes them again, at increasing loads
+    for (double load : {0.5, 0.8, 0.9, 0.95}) {
+        auto target = (size_t) (load * (double) filter.capacity());
+        size_t step = std::max((size_t) 1, capacity / 20);
+        if (target > inserted || target < step) continue;
+        size_t first = target - step;
+        cuckoo_filter<F> f(capacity);
+        for (size_t i = 0; i < first; i++) {
+            f.insert(keys[i]);
+        }
+        uint64_t start = bench::now_ns();
+        for (size_t i = first; i < target; i++) {
+            f.insert(keys[i]);
+        }
+        double insert_seconds = (double) (bench::now_ns() - start) / 1e9;
+        start = bench::now_ns();
+        for (size_t i = first; i < target; i++) {
+            f.remove(keys[i]);
+        }
+        double remove_seconds = (double) (bench::now_ns() - start) / 1e9;
+        std::string at = config + bench::format(" load=%.2f", load);
+        bench::report(std::string(name) + " insert", at, step, insert_seconds);
+        bench::report(std::string(name) + " remove", at, step, remove_seconds);
+    }
+}
+
+BENCH(cuckoo_load_factor) {
+    for (size_t capacity : bench::sizes({100000, 1000000}, 1)) {
+        cuckoo_load<uint8_t>(capacity, "cuckoo8");
+        cuckoo_load<uint16_t>(capacity, "cuckoo16");
+    }
+}
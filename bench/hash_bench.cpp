@@ -0,0 +1,697 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "concurrent_hash_map.hpp"
+#include "flat_hash_map.hpp"
+#include "hash_functions.hpp"
+#include "hash_map.hpp"
+#include "hash_table.hpp"
+#include "perfect_hash_index.hpp"
+#include "small_map.hpp"
+#include "string_view.hpp"
+#include "thread_pool.hpp"
+#include "bench.hpp"
+#include "counting_new.hpp"
+
+static std::vector<uint64_t> random_keys(size_t n) {
+    std::vector<uint64_t> keys(n);
+    for (uint64_t &k : keys) {
+        k = bench::rng()();
+    }
+    return keys;
+}
+
+// ns per key of the string hashes over keys of one length, against std::hash. The keys stay in cache, so that the
+// hash rather than the memory is measured. Then hash_batch on integer keys, against hashing them one at a time
+BENCH(hash_functions) {
+    const size_t num_keys = 1000;
+    size_t count = bench::opts().quick ? 10000 : 1000000;
+    size_t rounds = count / num_keys;
+    uint64_t sum = 0;
+    for (size_t length : {4, 8, 16, 32, 64, 256}) {
+        std::string config = "len=" + std::to_string(length);
+        // One buffer, as std::string would put the longer keys anywhere on the heap
+        std::string text(num_keys * length, ' ');
+        for (char &c : text) {
+            c = (char) ('a' + bench::random(26));
+        }
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < num_keys; i++) {
+            keys.push_back(text.substr(i * length, length));
+        }
+
+        double seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                for (size_t i = 0; i < num_keys; i++) {
+                    sum += mstd::fast_hash64(text.data() + i * length, length);
+                }
+            }
+        });
+        bench::report("fast_hash64", config, count, seconds);
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                for (size_t i = 0; i < num_keys; i++) {
+                    sum += mstd::murmur3_64(text.data() + i * length, length);
+                }
+            }
+        });
+        bench::report("murmur3_64", config, count, seconds);
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                for (const std::string &k : keys) {
+                    sum += std::hash<std::string>()(k);
+                }
+            }
+        });
+        bench::report("std::hash<std::string>", config, count, seconds);
+    }
+
+    std::vector<uint64_t> keys = random_keys(count);
+    std::vector<uint64_t> out(count);
+    std::string config = "n=" + bench::size_name(count);
+    double seconds = bench::measure([&]() {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = mstd::hash_u64(keys[i]);
+        }
+    });
+    bench::report("hash_u64 loop", config, count, seconds);
+    seconds = bench::measure([&]() {
+        mstd::hash_batch(keys.data(), count, out.data());
+    });
+    bench::report("hash_batch(uint64_t)", config, count, seconds);
+    sum += out[count / 2];
+    bench::do_not_optimize(sum);
+}
+
+// Indices into keys, in random order, for the lookup passes
+static std::vector<size_t> random_indices(size_t n, size_t count) {
+    std::vector<size_t> indices(count);
+    for (size_t &i : indices) {
+        i = bench::random(n);
+    }
+    return indices;
+}
+
+static size_t lookup_count() {
+    return bench::opts().quick ? 10000 : 1000000;
+}
+
+// Hit and miss lookups against maps of n random keys. Every map is built, measured and destroyed in turn,
+// so that the largest sizes (--full goes up to 100M entries, several GB per map) fit one at a time
+BENCH(hash_lookups) {
+    for (size_t n : bench::sizes({1000, 10000, 100000, 1000000}, 2, {10000000, 100000000})) {
+        std::string config = "n=" + bench::size_name(n);
+        std::vector<uint64_t> keys = random_keys(n);
+        std::vector<uint64_t> others = random_keys(lookup_count());
+        std::vector<size_t> hits = random_indices(n, lookup_count());
+        uint64_t sum = 0;
+
+        {
+            hash_map<uint64_t, uint64_t> map;
+            for (uint64_t k : keys) {
+                map.try_emplace(k, k);
+            }
+            double seconds = bench::measure([&]() {
+                for (size_t i : hits) {
+                    sum += map.get(keys[i]);
+                }
+            });
+            bench::report("hash_map hit", config, hits.size(), seconds);
+            seconds = bench::measure([&]() {
+                for (uint64_t k : others) {
+                    sum += map.find(k) != nullptr;
+                }
+            });
+            bench::report("hash_map miss", config, others.size(), seconds);
+        }
+        {
+            mstd::flat_hash_map<uint64_t, uint64_t> map;
+            for (uint64_t k : keys) {
+                map.insert(k, k);
+            }
+            double seconds = bench::measure([&]() {
+                for (size_t i : hits) {
+                    sum += *map.find(keys[i]);
+                }
+            });
+            bench::report("flat_hash_map hit", config, hits.size(), seconds);
+            seconds = bench::measure([&]() {
+                for (uint64_t k : others) {
+                    sum += map.find(k) != nullptr;
+                }
+            });
+            bench::report("flat_hash_map miss", config, others.size(), seconds);
+        }
+        {
+            std::unordered_map<uint64_t, uint64_t> map;
+            for (uint64_t k : keys) {
+                map.emplace(k, k);
+            }
+            double seconds = bench::measure([&]() {
+                for (size_t i : hits) {
+                    sum += map.find(keys[i])->second;
+                }
+            });
+            bench::report("std::unordered_map hit", config, hits.size(), seconds);
+            seconds = bench::measure([&]() {
+                for (uint64_t k : others) {
+                    sum += map.find(k) != map.end();
+                }
+            });
+            bench::report("std::unordered_map miss", config, others.size(), seconds);
+        }
+        bench::do_not_optimize(sum);
+    }
+}
+
+// Latency of every single insert while a map grows to n entries. Linear hashing splits one bucket per insert,
+// where std::unordered_map rehashes everything at once
+BENCH(hash_insert_latency) {
+    for (size_t n : bench::sizes({1000000}, 1, {10000000, 30000000})) {
+        size_t count = bench::opts().quick ? 10000 : n;
+        std::string config = "n=" + bench::size_name(count);
+        std::vector<uint64_t> keys = random_keys(count);
+        std::vector<uint64_t> samples(count);
+
+        auto summary = [&samples]() {
+            std::string s = "p50 " + std::to_string(bench::percentile(samples, 0.5));
+            s += " p99 " + std::to_string(bench::percentile(samples, 0.99));
+            s += " p99.9 " + std::to_string(bench::percentile(samples, 0.999));
+            s += " p99.99 " + std::to_string(bench::percentile(samples, 0.9999));
+            s += " max " + std::to_string(samples.back()) + " ns";
+            return s;
+        };
+
+        {
+            hash_map<uint64_t, uint64_t> map;
+            for (size_t i = 0; i < count; i++) {
+                uint64_t start = bench::now_ns();
+                map.try_emplace(keys[i], i);
+                samples[i] = bench::now_ns() - start;
+            }
+            bench::note("hash_map insert", config, summary());
+        }
+        {
+            mstd::flat_hash_map<uint64_t, uint64_t> map;
+            for (size_t i = 0; i < count; i++) {
+                uint64_t start = bench::now_ns();
+                map.insert(keys[i], i);
+                samples[i] = bench::now_ns() - start;
+            }
+            bench::note("flat_hash_map insert", config, summary());
+        }
+        {
+            std::unordered_map<uint64_t, uint64_t> map;
+            for (size_t i = 0; i < count; i++) {
+                uint64_t start = bench::now_ns();
+                map.emplace(keys[i], i);
+                samples[i] = bench::now_ns() - start;
+            }
+            bench::note("std::unordered_map insert", config, summary());
+        }
+    }
+}
+
+// Total throughput of threads doing random operations on one shared map of keys entries, half of them present.
+// read_percent of the operations are finds, the others are split between insert_or_assign and erase
+static void concurrent_mix(int read_percent) {
+    size_t keys = bench::opts().quick ? 10000 : 1000000;
+    size_t ops_per_thread = bench::opts().quick ? 10000 : 1000000;
+    std::string what = "concurrent_hash_map " + std::to_string(read_percent) + "/" +
+                       std::to_string(100 - read_percent);
+
+    for (int threads : bench::thread_counts()) {
+        std::vector<uint64_t> seeds;
+        for (int t = 0; t < threads; t++) {
+            seeds.push_back(bench::rng()());
+        }
+        mstd::concurrent_hash_map<uint64_t, uint64_t> map;
+        for (uint64_t k = 0; k < keys; k += 2) {
+            map.insert(k, k);
+        }
+
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                std::mt19937_64 rng(seeds[t]);
+                ready++;
+                while (!go.load()) {
+                    std::this_thread::yield();
+                }
+                uint64_t found = 0, value;
+                for (size_t i = 0; i < ops_per_thread; i++) {
+                    uint64_t r = rng();
+                    uint64_t key = (r >> 8) % keys;
+                    int op = (int) (r % 100);
+                    if (op < read_percent) {
+                        found += map.find(key, value);
+                    } else if (op % 2 == 0) {
+                        map.insert_or_assign(key, i);
+                    } else {
+                        map.erase(key);
+                    }
+                }
+                bench::do_not_optimize(found);
+            });
+        }
+        while (ready.load() < threads) {
+            std::this_thread::yield();
+        }
+        uint64_t start = bench::now_ns();
+        go.store(true);
+        for (std::thread &w : workers) w.join();
+        double seconds = (double) (bench::now_ns() - start) / 1e9;
+        bench::report(what, "t=" + std::to_string(threads), ops_per_thread * threads, seconds);
+    }
+}
+
+BENCH(concurrent_hash_map_scaling) {
+    concurrent_mix(95);
+    concurrent_mix(50);
+}
+
+// Views of keys into one buffer, as a parser would hand them out. text must outlive them
+static std::vector<mstd::string_view> views_into(std::string &text, const std::vector<std::string> &keys) {
+    for (const std::string &k : keys) {
+        text += k;
+    }
+    std::vector<mstd::string_view> views;
+    size_t offset = 0;
+    for (const std::string &k : keys) {
+        views.push_back(mstd::string_view(text.data() + offset, k.length()));
+        offset += k.length();
+    }
+    return views;
+}
+
+// Allocations per operation, over a bench::measure of ops operations
+static double allocations_per_op(size_t calls_before, size_t ops) {
+    return (double) (counting_new::calls - calls_before) / (double) (ops * (bench::opts().repetitions + 1));
+}
+
+// String keys: hash_map lookups by std::string, string_view and const char *, against std::unordered_map, which
+// needs a std::string to search with. Then inserts of long keys, where hash_map splits by the cached hashes
+BENCH(hash_map_string_keys) {
+    for (size_t n : bench::sizes({10000, 1000000}, 1)) {
+        std::string config = "n=" + bench::size_name(n);
+        std::vector<std::string> keys = bench::distinct_strings(n);
+        std::string text;
+        std::vector<mstd::string_view> views = views_into(text, keys);
+        std::vector<size_t> queries = random_indices(n, lookup_count());
+        uint64_t sum = 0;
+
+        hash_map<std::string, int> map;
+        for (size_t i = 0; i < n; i++) {
+            map.try_emplace(keys[i], (int) i);
+        }
+        double seconds = bench::measure([&]() {
+            for (size_t i : queries) {
+                sum += map.get(keys[i]);
+            }
+        });
+        bench::report("hash_map get(std::string)", config, queries.size(), seconds);
+        size_t calls = counting_new::calls;
+        seconds = bench::measure([&]() {
+            for (size_t i : queries) {
+                sum += map.get(views[i]);
+            }
+        });
+        bench::report("hash_map get(string_view)", config, queries.size(), seconds,
+                      bench::format("%.3f allocations/get", allocations_per_op(calls, queries.size())));
+        calls = counting_new::calls;
+        seconds = bench::measure([&]() {
+            for (size_t i : queries) {
+                sum += map.get(keys[i].c_str());
+            }
+        });
+        bench::report("hash_map get(const char *)", config, queries.size(), seconds,
+                      bench::format("%.3f allocations/get", allocations_per_op(calls, queries.size())));
+
+        std::unordered_map<std::string, int> std_map;
+        for (size_t i = 0; i < n; i++) {
+            std_map.emplace(keys[i], (int) i);
+        }
+        calls = counting_new::calls;
+        seconds = bench::measure([&]() {
+            for (size_t i : queries) {
+                sum += std_map.find(std::string(views[i].data(), views[i].size()))->second;
+            }
+        });
+        bench::report("std::unordered_map find(string)", config, queries.size(), seconds,
+                      bench::format("%.3f allocations/find", allocations_per_op(calls, queries.size())));
+        bench::do_not_optimize(sum);
+    }
+
+    for (size_t n : bench::sizes({100000, 1000000}, 1)) {
+        std::string config = "n=" + bench::size_name(n) + " len=64";
+        std::vector<std::string> keys = bench::distinct_strings(n);
+        for (std::string &k : keys) {
+            k.resize(64, '.');
+        }
+        double seconds = bench::measure([&]() {
+            hash_map<std::string, int> map;
+            for (const std::string &k : keys) {
+                map.try_emplace(k, 0);
+            }
+        });
+        bench::report("hash_map insert", config, n, seconds);
+        seconds = bench::measure([&]() {
+            std::unordered_map<std::string, int> map;
+            for (const std::string &k : keys) {
+                map.emplace(k, 0);
+            }
+        });
+        bench::report("std::unordered_map insert", config, n, seconds);
+    }
+}
+
+// Erasing every key of an n-entry map, after which hash_map has merged its buckets back, and a churn of
+// erases and inserts at a constant size, against std::unordered_map
+BENCH(hash_map_erase) {
+    for (size_t n : bench::sizes({100000, 1000000}, 1)) {
+        std::string config = "n=" + bench::size_name(n);
+        std::vector<uint64_t> keys = random_keys(n);
+        std::vector<uint64_t> fresh = random_keys(n);
+
+        hash_map<uint64_t, uint64_t> map;
+        size_t peak_buckets = 0;
+        double seconds = bench::measure([&]() {
+            for (uint64_t k : keys) {
+                map.try_emplace(k, k);
+            }
+            peak_buckets = map.size();
+        }, [&]() {
+            for (uint64_t k : keys) {
+                map.erase(k);
+            }
+        });
+        bench::report("hash_map erase all", config, n, seconds,
+                      std::to_string(peak_buckets) + " -> " + std::to_string(map.size()) + " buckets");
+
+        std::unordered_map<uint64_t, uint64_t> std_map;
+        seconds = bench::measure([&]() {
+            for (uint64_t k : keys) {
+                std_map.emplace(k, k);
+            }
+        }, [&]() {
+            for (uint64_t k : keys) {
+                std_map.erase(k);
+            }
+        });
+        bench::report("std::unordered_map erase all", config, n, seconds,
+                      std::to_string(std_map.bucket_count()) + " buckets after");
+
+        // Every repetition swaps keys and fresh out of the map, so it starts from the state the last one left
+        for (uint64_t k : keys) {
+            map.try_emplace(k, k);
+            std_map.emplace(k, k);
+        }
+        bool forward = true;
+        seconds = bench::measure([&]() {
+            const std::vector<uint64_t> &out = forward ? keys : fresh;
+            const std::vector<uint64_t> &in = forward ? fresh : keys;
+            for (size_t i = 0; i < n; i++) {
+                map.erase(out[i]);
+                map.try_emplace(in[i], i);
+            }
+            forward = !forward;
+        });
+        bench::report("hash_map erase + insert", config, n, seconds);
+        forward = true;
+        seconds = bench::measure([&]() {
+            const std::vector<uint64_t> &out = forward ? keys : fresh;
+            const std::vector<uint64_t> &in = forward ? fresh : keys;
+            for (size_t i = 0; i < n; i++) {
+                std_map.erase(out[i]);
+                std_map.emplace(in[i], i);
+            }
+            forward = !forward;
+        });
+        bench::report("std::unordered_map erase + insert", config, n, seconds);
+    }
+}
+
+// Startup time of a map loaded from n pairs: build() serially and on a pool, against inserting them one by one
+BENCH(hash_map_build) {
+    thread_pool pool(bench::opts().max_threads);
+    for (size_t n : bench::sizes({100000, 1000000}, 1, {10000000})) {
+        std::string config = "n=" + bench::size_name(n);
+        std::vector<std::pair<uint64_t, uint64_t>> pairs;
+        for (uint64_t k : random_keys(n)) {
+            pairs.push_back(std::make_pair(k, k));
+        }
+
+        double seconds = bench::measure([&]() {
+            hash_map<uint64_t, uint64_t> map;
+            for (const auto &p : pairs) {
+                map.try_emplace(p.first, p.second);
+            }
+        });
+        bench::report("insert one by one", config, n, seconds);
+
+        seconds = bench::measure([&]() {
+            hash_map<uint64_t, uint64_t> map;
+            map.reserve(n);
+            for (const auto &p : pairs) {
+                map.try_emplace(p.first, p.second);
+            }
+        });
+        bench::report("reserve, insert one by one", config, n, seconds);
+
+        seconds = bench::measure([&]() {
+            hash_map<uint64_t, uint64_t> map;
+            map.build(pairs.begin(), pairs.end());
+        });
+        bench::report("build", config, n, seconds);
+
+        seconds = bench::measure([&]() {
+            hash_map<uint64_t, uint64_t> map;
+            map.build(pairs.begin(), pairs.end(), &pool);
+        });
+        bench::report("build on pool", config + " t=" + std::to_string(bench::opts().max_threads), n, seconds);
+    }
+}
+
+// A static set of n string keys: building and writing the index, its size, opening it, and get against a
+// hash_map holding the same set (and the time to load that map, which the index replaces). Keys outside the
+// set must all be rejected
+BENCH(perfect_hash_index) {
+    const char *dir = getenv("TMPDIR");
+    std::string path = std::string(dir != nullptr ? dir : "/tmp") + "/hash_bench." + std::to_string(getpid());
+    for (size_t n : bench::sizes({100000, 1000000}, 1, {5000000})) {
+        std::string config = "n=" + bench::size_name(n);
+        std::vector<std::string> keys = bench::distinct_strings(n);
+        std::vector<std::string> absent = bench::distinct_strings(lookup_count(), "absent");
+        std::string text;
+        std::vector<mstd::string_view> views = views_into(text, keys);
+        std::vector<size_t> queries = random_indices(n, lookup_count());
+        uint64_t sum = 0;
+
+        double seconds = bench::measure([&]() {
+            mstd::perfect_hash_builder<uint64_t> builder;
+            for (size_t i = 0; i < n; i++) {
+                builder.add(keys[i], i);
+            }
+            builder.write(path);
+        });
+        bench::report("build and write", config, n, seconds);
+
+        seconds = bench::measure([&]() {
+            mstd::perfect_hash_index<uint64_t> index(path);
+            sum += index.size();
+        });
+        bench::note("open", config, bench::format("%.1f us", seconds * 1e6));
+
+        mstd::perfect_hash_index<uint64_t> index(path);
+        bench::note("index size", config, bench::format("%.2f bytes/key", (double) index.size_in_bytes() / (double) n));
+        seconds = bench::measure([&]() {
+            for (size_t i : queries) {
+                sum += index.get(views[i]);
+            }
+        });
+        bench::report("perfect_hash_index get", config, queries.size(), seconds);
+        size_t false_hits = 0;
+        seconds = bench::measure([&]() {
+            false_hits = 0;
+            for (const std::string &k : absent) {
+                false_hits += index.contains(k);
+            }
+        });
+        bench::report("perfect_hash_index miss", config, absent.size(), seconds,
+                      std::to_string(false_hits) + " false hits");
+
+        seconds = bench::measure([&]() {
+            hash_map<std::string, uint64_t> map;
+            map.reserve(n);
+            for (size_t i = 0; i < n; i++) {
+                map.try_emplace(keys[i], i);
+            }
+        });
+        bench::note("hash_map load", config, bench::format("%.1f ms", seconds * 1e3));
+        hash_map<std::string, uint64_t> map;
+        for (size_t i = 0; i < n; i++) {
+            map.try_emplace(keys[i], i);
+        }
+        seconds = bench::measure([&]() {
+            for (size_t i : queries) {
+                sum += map.get(views[i]);
+            }
+        });
+        bench::report("hash_map get", config, queries.size(), seconds,
+                      bench::format("%.2f bytes/key", (double) map.stats().total_bytes / (double) n));
+        bench::do_not_optimize(sum);
+    }
+    remove(path.c_str());
+}
+
+// Lookups by string_view: hash_table's get against std::unordered_map<std::string>, which needs a std::string
+// to search with. Counts the allocations the lookups make
+BENCH(hash_table_lookups) {
+    for (size_t n : bench::sizes({10000, 1000000}, 1)) {
+        std::string config = "n=" + bench::size_name(n);
+        std::vector<std::string> keys = bench::distinct_strings(n);
+        std::string text;
+        std::vector<mstd::string_view> views = views_into(text, keys);
+        std::vector<size_t> queries = random_indices(n, lookup_count());
+        uint64_t sum = 0;
+
+        mstd::hash_table<int> table;
+        for (size_t i = 0; i < n; i++) {
+            table.put(keys[i], (int) i);
+        }
+        size_t calls = counting_new::calls;
+        double seconds = bench::measure([&]() {
+            for (size_t i : queries) {
+                sum += table.get(views[i]);
+            }
+        });
+        bench::report("hash_table get(string_view)", config, queries.size(), seconds,
+                      bench::format("%.3f allocations/get", allocations_per_op(calls, queries.size())));
+
+        std::unordered_map<std::string, int> map;
+        for (size_t i = 0; i < n; i++) {
+            map.emplace(keys[i], (int) i);
+        }
+        calls = counting_new::calls;
+        seconds = bench::measure([&]() {
+            for (size_t i : queries) {
+                sum += map.find(std::string(views[i].data(), views[i].size()))->second;
+            }
+        });
+        bench::report("std::unordered_map find(string)", config, queries.size(), seconds,
+                      bench::format("%.3f allocations/find", allocations_per_op(calls, queries.size())));
+        bench::do_not_optimize(sum);
+    }
+}
+
+// Memory per map, and lookup latency, for maps of 1 to 64 entries: small_map against the hash tables it
+// switches to when it overflows. Many maps are built so that lookups don't all hit one warm map
+BENCH(small_map_sizes) {
+    const size_t num_maps = bench::opts().quick ? 100 : 10000;
+    const size_t lookups = bench::opts().quick ? 10000 : 1000000;
+    for (size_t entries : {1, 2, 4, 8, 16, 32, 64}) {
+        std::string config = "entries=" + std::to_string(entries);
+        std::vector<uint64_t> keys = random_keys(num_maps * entries);
+        std::vector<size_t> queries = random_indices(keys.size(), lookups);
+        uint64_t sum = 0;
+
+        {
+            bench::counting_resource resource;
+            std::vector<mstd::small_map<uint64_t, uint64_t>> maps;
+            maps.reserve(num_maps);
+            for (size_t m = 0; m < num_maps; m++) {
+                maps.emplace_back(&resource);
+                for (size_t e = 0; e < entries; e++) {
+                    maps.back().insert(keys[m * entries + e], e);
+                }
+            }
+            double bytes = (double) sizeof(maps[0]) + (double) resource.bytes() / (double) num_maps;
+            double seconds = bench::measure([&]() {
+                for (size_t q : queries) {
+                    sum += *maps[q / entries].find(keys[q]);
+                }
+            });
+            bench::report("small_map<8> find", config, lookups, seconds, bench::format("%.0f bytes/map", bytes));
+        }
+        {
+            bench::counting_resource resource;
+            std::vector<mstd::flat_hash_map<uint64_t, uint64_t>> maps;
+            maps.reserve(num_maps);
+            for (size_t m = 0; m < num_maps; m++) {
+                maps.emplace_back(flat_hash_map_constants::min_capacity, &resource);
+                for (size_t e = 0; e < entries; e++) {
+                    maps.back().insert(keys[m * entries + e], e);
+                }
+            }
+            double bytes = (double) sizeof(maps[0]) + (double) resource.bytes() / (double) num_maps;
+            double seconds = bench::measure([&]() {
+                for (size_t q : queries) {
+                    sum += *maps[q / entries].find(keys[q]);
+                }
+            });
+            bench::report("flat_hash_map find", config, lookups, seconds, bench::format("%.0f bytes/map", bytes));
+        }
+        {
+            long before = counting_new::bytes;
+            std::vector<std::unordered_map<uint64_t, uint64_t>> maps(num_maps);
+            long vector_bytes = (long) (num_maps * sizeof(maps[0]));
+            for (size_t m = 0; m < num_maps; m++) {
+                for (size_t e = 0; e < entries; e++) {
+                    maps[m].emplace(keys[m * entries + e], e);
+                }
+            }
+            double bytes = (double) (counting_new::bytes - before - vector_bytes) / (double) num_maps +
+                           (double) sizeof(maps[0]);
+            double seconds = bench::measure([&]() {
+                for (size_t q : queries) {
+                    sum += maps[q / entries].find(keys[q])->second;
+                }
+            });
+            bench::report("std::unordered_map find", config, lookups, seconds, bench::format("%.0f bytes/map", bytes));
+        }
+        bench::do_not_optimize(sum);
+    }
+}
+
+// What stats() reports for maps of n random keys, and what it costs: it walks the whole table
+BENCH(hash_stats) {
+    auto summary = [](const mstd::hash_stats &st) {
+        std::string s = bench::format("load %.2f", st.load_factor);
+        s += bench::format(" average probe %.2f", st.average_probe);
+        s += " longest " + std::to_string(st.longest_probe);
+        s += bench::format(" %.1f bytes/item", (double) st.total_bytes / (double) st.num_items);
+        return s;
+    };
+    for (size_t n : bench::sizes({100000, 1000000}, 1)) {
+        std::string config = "n=" + bench::size_name(n);
+        std::vector<std::string> keys = bench::distinct_strings(n);
+        mstd::hash_stats st;
+
+        hash_map<std::string, int> map;
+        for (size_t i = 0; i < n; i++) {
+            map.try_emplace(keys[i], (int) i);
+        }
+        double seconds = bench::measure([&]() {
+            st = map.stats();
+        });
+        bench::note("hash_map stats()", config, bench::format("%.2f ms: ", seconds * 1e3) + summary(st));
+
+        mstd::hash_table<int> table;
+        for (size_t i = 0; i < n; i++) {
+            table.put(keys[i], (int) i);
+        }
+        seconds = bench::measure([&]() {
+            st = table.stats();
+        });
+        bench::note("hash_table stats()", config, bench::format("%.2f ms: ", seconds * 1e3) + summary(st));
+    }
+}
@@ -0,0 +1,459 @@
+#include <atomic>
+#include <cstdlib>
+#include <deque>
+#include <list>
+#include <queue>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include "concurrent_stack.hpp"
+#include "mqueue.hpp"
+#include "pipeline.hpp"
+#include "priority_queue.hpp"
+#include "slab_allocator.hpp"
+#include "spsc_channel.hpp"
+#include "thread_pool.hpp"
+#include "bench.hpp"
+
+namespace queue_bench_constants {
+    // Elements kept by the top-k benchmarks
+    const int top_k = 100;
+    // Values moved per call by the batched spsc_channel benchmarks
+    const size_t spsc_batch = 64;
+    const size_t spsc_capacity = 1024;
+}
+
+// FIFO throughput: n pushes then n pops, and a steady state where the queue holds a small window
+BENCH(queue_throughput) {
+    for (size_t n : bench::sizes({1000, 100000, 1000000}, 2)) {
+        std::string config = "n=" + bench::size_name(n);
+        size_t rounds = std::max((size_t) 1, (bench::opts().quick ? 100000 : 10000000) / n);
+        size_t ops = 2 * n * rounds;
+
+        double seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                mstd::queue<uint64_t> q;
+                for (size_t i = 0; i < n; i++) {
+                    q.push(i);
+                }
+                uint64_t sum = 0;
+                while (!q.empty()) {
+                    sum += q.pop();
+                }
+                bench::do_not_optimize(sum);
+            }
+        });
+        bench::report("mstd::queue fill, drain", config, ops, seconds);
+
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                std::deque<uint64_t> q;
+                for (size_t i = 0; i < n; i++) {
+                    q.push_back(i);
+                }
+                uint64_t sum = 0;
+                while (!q.empty()) {
+                    sum += q.front();
+                    q.pop_front();
+                }
+                bench::do_not_optimize(sum);
+            }
+        });
+        bench::report("std::deque fill, drain", config, ops, seconds);
+
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                std::list<uint64_t> q;
+                for (size_t i = 0; i < n; i++) {
+                    q.push_back(i);
+                }
+                uint64_t sum = 0;
+                while (!q.empty()) {
+                    sum += q.front();
+                    q.pop_front();
+                }
+                bench::do_not_optimize(sum);
+            }
+        });
+        bench::report("std::list fill, drain", config, ops, seconds);
+    }
+
+    const size_t window = 64;
+    size_t ops = bench::opts().quick ? 100000 : 10000000;
+    std::string config = "window=" + std::to_string(window);
+    double seconds = bench::measure([&]() {
+        mstd::queue<uint64_t> q;
+        uint64_t sum = 0;
+        for (size_t i = 0; i < ops; i++) {
+            q.push(i);
+            if (i >= window) sum += q.pop();
+        }
+        bench::do_not_optimize(sum);
+    });
+    bench::report("mstd::queue push, pop", config, ops, seconds);
+    seconds = bench::measure([&]() {
+        std::deque<uint64_t> q;
+        uint64_t sum = 0;
+        for (size_t i = 0; i < ops; i++) {
+            q.push_back(i);
+            if (i >= window) {
+                sum += q.front();
+                q.pop_front();
+            }
+        }
+        bench::do_not_optimize(sum);
+    });
+    bench::report("std::deque push, pop", config, ops, seconds);
+    seconds = bench::measure([&]() {
+        std::list<uint64_t> q;
+        uint64_t sum = 0;
+        for (size_t i = 0; i < ops; i++) {
+            q.push_back(i);
+            if (i >= window) {
+                sum += q.front();
+                q.pop_front();
+            }
+        }
+        bench::do_not_optimize(sum);
+    });
+    bench::report("std::list push, pop", config, ops, seconds);
+}
+
+// Every thread pushes and pops in pairs on one shared stack
+BENCH(concurrent_stack_scaling) {
+    size_t pairs_per_thread = bench::opts().quick ? 10000 : 1000000;
+    for (int threads : bench::thread_counts()) {
+        mstd::concurrent_stack<uint64_t> stack;
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&]() {
+                ready++;
+                while (!go.load()) {
+                    std::this_thread::yield();
+                }
+                uint64_t sum = 0, value;
+                for (size_t i = 0; i < pairs_per_thread; i++) {
+                    stack.push(i);
+                    if (stack.try_pop(value)) sum += value;
+                }
+                bench::do_not_optimize(sum);
+            });
+        }
+        while (ready.load() < threads) {
+            std::this_thread::yield();
+        }
+        uint64_t start = bench::now_ns();
+        go.store(true);
+        for (std::thread &w : workers) w.join();
+        double seconds = (double) (bench::now_ns() - start) / 1e9;
+        bench::report("concurrent_stack push, pop", "t=" + std::to_string(threads), 2 * pairs_per_thread * threads,
+                      seconds);
+    }
+}
+
+// Batches of small objects of random sizes allocated, then freed in random order, on every thread at once:
+// the slab allocator against malloc
+template <typename Allocate, typename Deallocate>
+static double allocation_churn(int threads, size_t batches, const std::vector<size_t> &sizes,
+                               const std::vector<size_t> &order, Allocate allocate, Deallocate deallocate) {
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            std::vector<void *> blocks(sizes.size());
+            ready++;
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (size_t b = 0; b < batches; b++) {
+                for (size_t i = 0; i < sizes.size(); i++) {
+                    blocks[i] = allocate(sizes[i]);
+                }
+                for (size_t i : order) {
+                    deallocate(blocks[i], sizes[i]);
+                }
+            }
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+    uint64_t start = bench::now_ns();
+    go.store(true);
+    for (std::thread &w : workers) w.join();
+    return (double) (bench::now_ns() - start) / 1e9;
+}
+
+BENCH(slab_allocator) {
+    const size_t batch = 1000;
+    size_t batches = bench::opts().quick ? 10 : 1000;
+    std::vector<size_t> sizes(batch), order(batch);
+    for (size_t i = 0; i < batch; i++) {
+        sizes[i] = 8 * (1 + bench::random(32));
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), bench::rng());
+
+    for (int threads : bench::thread_counts()) {
+        std::string config = "t=" + std::to_string(threads);
+        size_t ops = 2 * batch * batches * threads;
+        double seconds = allocation_churn(threads, batches, sizes, order,
+                                          [](size_t bytes) { return mstd::slab_allocator::allocate(bytes); },
+                                          [](void *p, size_t bytes) { mstd::slab_allocator::deallocate(p, bytes); });
+        bench::report("slab_allocator allocate, free", config, ops, seconds);
+        seconds = allocation_churn(threads, batches, sizes, order,
+                                   [](size_t bytes) { return malloc(bytes); },
+                                   [](void *p, size_t) { free(p); });
+        bench::report("malloc, free", config, ops, seconds);
+    }
+}
+
+// Pins a thread to one core, so that producer and consumer don't migrate during a run. Only done when there's
+// more than one core: on a single one, pinning would only take the scheduler's choices away
+static void pin(std::thread &t, int core) {
+    unsigned cores = std::thread::hardware_concurrency();
+    if (cores < 2) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % cores, &set);
+    pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+}
+
+// Messages per second from one producer to one consumer, a value and a batch at a time
+static void spsc_throughput(bool blocking, bool batched) {
+    size_t messages = bench::opts().quick ? 100000 : 10000000;
+    std::string what = std::string("spsc_channel ") + (batched ? "batch" : "single");
+    std::string config = blocking ? "blocking" : "non-blocking";
+
+    double seconds = bench::measure([&]() {
+        mstd::spsc_channel<uint64_t> channel(queue_bench_constants::spsc_capacity, blocking);
+        std::thread producer([&]() {
+            if (batched) {
+                uint64_t batch[queue_bench_constants::spsc_batch];
+                for (size_t i = 0; i < messages; i += queue_bench_constants::spsc_batch) {
+                    size_t n = std::min(queue_bench_constants::spsc_batch, messages - i);
+                    for (size_t j = 0; j < n; j++) {
+                        batch[j] = i + j;
+                    }
+                    channel.push_batch(batch, n);
+                }
+            } else {
+                for (size_t i = 0; i < messages; i++) {
+                    channel.push(uint64_t(i));
+                }
+            }
+            channel.close();
+        });
+        pin(producer, 0);
+
+        uint64_t sum = 0;
+        if (batched) {
+            uint64_t batch[queue_bench_constants::spsc_batch];
+            size_t n;
+            while ((n = channel.pop_batch(batch, queue_bench_constants::spsc_batch)) > 0) {
+                for (size_t j = 0; j < n; j++) {
+                    sum += batch[j];
+                }
+            }
+        } else {
+            uint64_t value;
+            while (channel.pop(value)) {
+                sum += value;
+            }
+        }
+        producer.join();
+        if (sum != (uint64_t) messages * (messages - 1) / 2) throw std::runtime_error("spsc_channel lost messages");
+    });
+    bench::report(what, config, messages, seconds);
+}
+
+// One-way latency, as half a round trip: the producer sends a message and waits for it to come back
+static void spsc_latency(bool blocking) {
+    size_t round_trips = bench::opts().quick ? 1000 : 100000;
+    mstd::spsc_channel<uint64_t> there(queue_bench_constants::spsc_capacity, blocking);
+    mstd::spsc_channel<uint64_t> back(queue_bench_constants::spsc_capacity, blocking);
+
+    std::thread echo([&]() {
+        uint64_t value;
+        while (there.pop(value)) {
+            back.push(std::move(value));
+        }
+    });
+    pin(echo, 1);
+
+    std::vector<uint64_t> samples;
+    samples.reserve(round_trips);
+    for (size_t i = 0; i < round_trips; i++) {
+        uint64_t start = bench::now_ns();
+        there.push(uint64_t(i));
+        uint64_t value;
+        back.pop(value);
+        samples.push_back((bench::now_ns() - start) / 2);
+    }
+    there.close();
+    echo.join();
+
+    std::string s = "p50 " + std::to_string(bench::percentile(samples, 0.5));
+    s += " p99 " + std::to_string(bench::percentile(samples, 0.99));
+    s += " p99.9 " + std::to_string(bench::percentile(samples, 0.999));
+    s += " max " + std::to_string(samples.back()) + " ns";
+    bench::note("spsc_channel one-way latency", blocking ? "blocking" : "non-blocking", s);
+}
+
+BENCH(spsc_channel) {
+    for (bool blocking : {true, false}) {
+        spsc_throughput(blocking, false);
+        spsc_throughput(blocking, true);
+        spsc_latency(blocking);
+    }
+}
+
+// Items per second through a source, a parallel stage and an in-order sink, on pools of increasing size, and
+// the same work done as separate passes over the whole input with wait_all() in between. The extra column is
+// the most items held at once: produced by the source (or the first pass) and not yet consumed by the sink
+BENCH(pipeline) {
+    size_t items = bench::opts().quick ? 100000 : 10000000;
+    for (int threads : bench::thread_counts()) {
+        thread_pool pool(threads);
+        std::string config = "t=" + std::to_string(threads);
+        size_t held = 0, most_held = 0;
+        double seconds = bench::measure([&]() {
+            size_t next = 0;
+            uint64_t sum = 0;
+            mstd::pipeline p(pool);
+            p.source<uint64_t>([&](mstd::vector<uint64_t> &out, size_t max) {
+                for (size_t i = 0; i < max && next < items; i++) {
+                    out.push(next++);
+                }
+                // The source and the in-order sink never run at the same time
+                held += out.size();
+                most_held = std::max(most_held, held);
+                return next < items;
+            })
+             .apply(mstd::stage_parallel, [](mstd::vector<uint64_t> &in) {
+                for (uint64_t &x : in) {
+                    x = x * 0x9e3779b97f4a7c15ULL ^ (x >> 29);
+                }
+            })
+             .apply(mstd::stage_serial_in_order, [&](mstd::vector<uint64_t> &in) {
+                for (uint64_t x : in) {
+                    sum += x;
+                }
+                held -= in.size();
+            });
+            p.run();
+            bench::do_not_optimize(sum);
+        });
+        bench::report("pipeline parallel, in-order", config, items, seconds,
+                      std::to_string(most_held) + " items held");
+
+        seconds = bench::measure([&]() {
+            std::vector<uint64_t> all(items);
+            for (size_t i = 0; i < items; i++) {
+                all[i] = i;
+            }
+            size_t chunk = (items + (size_t) threads - 1) / (size_t) threads;
+            for (size_t start = 0; start < items; start += chunk) {
+                size_t end = std::min(items, start + chunk);
+                pool.add_task([&all, start, end]() {
+                    for (size_t i = start; i < end; i++) {
+                        all[i] = all[i] * 0x9e3779b97f4a7c15ULL ^ (all[i] >> 29);
+                    }
+                });
+            }
+            pool.wait_all();
+            uint64_t sum = 0;
+            for (uint64_t x : all) {
+                sum += x;
+            }
+            bench::do_not_optimize(sum);
+        });
+        bench::report("separate passes, wait_all", config, items, seconds, std::to_string(items) + " items held");
+    }
+}
+
+// n random pushes, then n pops
+template <size_t D>
+static void heap_push_pop(const std::vector<uint64_t> &values, const std::string &config) {
+    double seconds = bench::measure([&]() {
+        mstd::priority_queue<uint64_t, std::less<uint64_t>, D> q;
+        for (uint64_t v : values) {
+            q.push(v);
+        }
+        uint64_t sum = 0;
+        while (!q.empty()) {
+            sum += q.pop();
+        }
+        bench::do_not_optimize(sum);
+    });
+    bench::report("priority_queue D=" + std::to_string(D) + " push, pop", config, 2 * values.size(), seconds);
+
+    seconds = bench::measure([&]() {
+        mstd::priority_queue<uint64_t, std::less<uint64_t>, D> q;
+        q.heapify(mstd::span<const uint64_t>(values.data(), values.size()));
+        bench::do_not_optimize(q.top());
+    });
+    bench::report("priority_queue D=" + std::to_string(D) + " heapify", config, values.size(), seconds);
+
+    // Top-k: a bounded queue with the smallest on top keeps the k largest
+    seconds = bench::measure([&]() {
+        mstd::priority_queue<uint64_t, std::greater<uint64_t>, D> q(queue_bench_constants::top_k);
+        for (uint64_t v : values) {
+            q.push(v);
+        }
+        bench::do_not_optimize(q.top());
+    });
+    bench::report("priority_queue D=" + std::to_string(D) + " top-" + std::to_string(queue_bench_constants::top_k),
+                  config, values.size(), seconds);
+}
+
+BENCH(priority_queue) {
+    for (size_t n : bench::sizes({1000, 100000, 1000000}, 2, {10000000})) {
+        std::string config = "n=" + bench::size_name(n);
+        std::vector<uint64_t> values(n);
+        for (uint64_t &v : values) {
+            v = bench::rng()();
+        }
+
+        double seconds = bench::measure([&]() {
+            std::priority_queue<uint64_t> q;
+            for (uint64_t v : values) {
+                q.push(v);
+            }
+            uint64_t sum = 0;
+            while (!q.empty()) {
+                sum += q.top();
+                q.pop();
+            }
+            bench::do_not_optimize(sum);
+        });
+        bench::report("std::priority_queue push, pop", config, 2 * n, seconds);
+
+        seconds = bench::measure([&]() {
+            std::priority_queue<uint64_t> q(std::less<uint64_t>(), values);
+            bench::do_not_optimize(q.top());
+        });
+        bench::report("std::priority_queue heapify", config, n, seconds);
+
+        seconds = bench::measure([&]() {
+            std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> q;
+            for (uint64_t v : values) {
+                if (q.size() < (size_t) queue_bench_constants::top_k) {
+                    q.push(v);
+                } else if (v > q.top()) {
+                    q.pop();
+                    q.push(v);
+                }
+            }
+            bench::do_not_optimize(q.top());
+        });
+        bench::report("std::priority_queue top-" + std::to_string(queue_bench_constants::top_k), config, n, seconds);
+
+        heap_push_pop<2>(values, config);
+        heap_push_pop<4>(values, config);
+        heap_push_pop<8>(values, config);
+    }
+}
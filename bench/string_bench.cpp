@@ -0,0 +1,67 @@
+#include <string>
+#include <vector>
+#include "helpers.hpp"
+#include "mvector.hpp"
+#include "string_view.hpp"
+#include "bench.hpp"
+#include "counting_new.hpp"
+
+namespace string_bench_constants {
+    const size_t fields = 16;
+    const size_t field_length = 20;
+    // Each line keeps the fields [keep_start, keep_end)
+    const size_t keep_start = 2;
+    const size_t keep_end = 10;
+}
+
+// Runs f on every line and reports the time and allocations (new, and the vectors' resource) per line
+template <typename F>
+static void per_line(const std::string &what, const std::vector<std::string> &lines, bench::counting_resource &resource,
+                     F f) {
+    size_t calls = counting_new::calls;
+    size_t allocations = resource.allocations();
+    size_t total = 0;
+    double seconds = bench::measure([&]() {
+        for (const std::string &line : lines) {
+            total += f(line).size();
+        }
+    });
+    bench::do_not_optimize(total);
+    double per = (double) (counting_new::calls - calls + resource.allocations() - allocations) /
+                 (double) (lines.size() * (bench::opts().repetitions + 1));
+    bench::report(what, "lines=" + bench::size_name(lines.size()), lines.size(), seconds,
+                  bench::format("%.1f allocations/line", per));
+}
+
+// Splits comma-separated lines, keeps a range of their fields and joins it back: copying the range into a new
+// vector (vector(parts, start, end)), slicing it, and slicing views of the line that split_views made
+BENCH(split_slice_join) {
+    using namespace string_bench_constants;
+    std::vector<std::string> lines(bench::opts().quick ? 1000 : 10000);
+    for (std::string &line : lines) {
+        for (size_t f = 0; f < fields; f++) {
+            if (f > 0) line += ',';
+            for (size_t c = 0; c < field_length; c++) {
+                line += (char) ('a' + bench::random(26));
+            }
+        }
+    }
+    bench::counting_resource resource;
+
+    per_line("split, copy range, join", lines, resource, [&](const std::string &line) {
+        mstd::vector<std::string> parts(fields, &resource);
+        helpers::split(line, parts, ',');
+        mstd::vector<std::string> kept(parts, keep_start, keep_end);
+        return helpers::join(kept, ',');
+    });
+    per_line("split, slice, join", lines, resource, [&](const std::string &line) {
+        mstd::vector<std::string> parts(fields, &resource);
+        helpers::split(line, parts, ',');
+        return helpers::join(parts.slice(keep_start, keep_end), ',');
+    });
+    per_line("split_views, slice, join", lines, resource, [&](const std::string &line) {
+        mstd::vector<mstd::string_view> parts(fields, &resource);
+        helpers::split_views(line, parts, ',');
+        return helpers::join(parts.slice(keep_start, keep_end), ',');
+    });
+}
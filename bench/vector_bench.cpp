@@ -0,0 +1,317 @@
+#include <string>
+#include <vector>
+#include "hash_map.hpp"
+#include "memory_resource.hpp"
+#include "mqueue.hpp"
+#include "mvector.hpp"
+#include "simd.hpp"
+#include "slab_allocator.hpp"
+#include "small_vector.hpp"
+#include "soa_vector.hpp"
+#include "bench.hpp"
+
+// Push-heavy workloads: n pushes into an empty vector, with and without reserve, against std::vector
+BENCH(vector_push) {
+    for (size_t n : bench::sizes({1000, 100000, 10000000}, 2)) {
+        std::string config = "n=" + bench::size_name(n);
+        size_t rounds = std::max((size_t) 1, (bench::opts().quick ? 100000 : 10000000) / n);
+        size_t ops = n * rounds;
+
+        double seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                std::vector<int> v;
+                for (size_t i = 0; i < n; i++) {
+                    v.push_back((int) i);
+                }
+                bench::do_not_optimize(v.data());
+            }
+        });
+        bench::report("std::vector<int> push_back", config, ops, seconds);
+
+        for (double factor : {1.5, 2.0}) {
+            seconds = bench::measure([&]() {
+                for (size_t r = 0; r < rounds; r++) {
+                    mstd::vector<int> v;
+                    v.set_growth_factor(factor);
+                    for (size_t i = 0; i < n; i++) {
+                        v.push((int) i);
+                    }
+                    bench::do_not_optimize(v.begin());
+                }
+            });
+            bench::report("mstd::vector<int> push", config + bench::format(" growth=%.1f", factor), ops, seconds);
+        }
+
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                mstd::vector<int> v;
+                v.reserve(n);
+                for (size_t i = 0; i < n; i++) {
+                    v.push((int) i);
+                }
+                bench::do_not_optimize(v.begin());
+            }
+        });
+        bench::report("mstd::vector<int> reserve, push", config, ops, seconds);
+
+        // Not trivially copyable: grows by moving elements rather than realloc
+        size_t string_rounds = std::max((size_t) 1, rounds / 10);
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < string_rounds; r++) {
+                std::vector<std::string> v;
+                for (size_t i = 0; i < n; i++) {
+                    v.push_back("element");
+                }
+                bench::do_not_optimize(v.data());
+            }
+        });
+        bench::report("std::vector<string> push_back", config, n * string_rounds, seconds);
+
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < string_rounds; r++) {
+                mstd::vector<std::string> v;
+                for (size_t i = 0; i < n; i++) {
+                    v.push("element");
+                }
+                bench::do_not_optimize(v.begin());
+            }
+        });
+        bench::report("mstd::vector<string> push", config, n * string_rounds, seconds);
+    }
+}
+
+// Builds and drops many vectors of a typical small size: time and allocations per vector
+BENCH(small_vector_sizes) {
+    const size_t vectors = bench::opts().quick ? 10000 : 1000000;
+    for (size_t size : {1, 4, 8, 16, 32}) {
+        std::string config = "size=" + std::to_string(size);
+        bench::counting_resource resource;
+
+        double seconds = bench::measure([&]() {
+            for (size_t r = 0; r < vectors; r++) {
+                mstd::vector<int> v(1, &resource);
+                for (size_t i = 0; i < size; i++) {
+                    v.push((int) i);
+                }
+                bench::do_not_optimize(v.begin());
+            }
+        });
+        double allocations = (double) resource.allocations() / (double) (vectors * (bench::opts().repetitions + 1));
+        bench::report("mstd::vector<int>", config, vectors, seconds, bench::format("%.2f allocations/vector", allocations));
+
+        bench::counting_resource small_resource;
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < vectors; r++) {
+                mstd::small_vector<int, 8> v(8, &small_resource);
+                for (size_t i = 0; i < size; i++) {
+                    v.push((int) i);
+                }
+                bench::do_not_optimize(v.begin());
+            }
+        });
+        allocations = (double) small_resource.allocations() / (double) (vectors * (bench::opts().repetitions + 1));
+        bench::report("mstd::small_vector<int, 8>", config, vectors, seconds,
+                      bench::format("%.2f allocations/vector", allocations));
+
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < vectors; r++) {
+                std::vector<int> v;
+                for (size_t i = 0; i < size; i++) {
+                    v.push_back((int) i);
+                }
+                bench::do_not_optimize(v.data());
+            }
+        });
+        bench::report("std::vector<int>", config, vectors, seconds);
+    }
+}
+
+// Every kernel on every instruction set the CPU supports, across sizes. The value searched for isn't in the
+// array, so find scans all of it. Calls are repeated until about the same number of elements is scanned at
+// every size; the reported time is per element
+template <typename T>
+static void simd_kernels(const char *type) {
+    size_t elements_per_pass = bench::opts().quick ? 100000 : 20000000;
+    mstd::simd::isa saved = mstd::simd::current_isa();
+    for (size_t n : bench::sizes({16, 64, 256, 1024, 16384, 1000000}, 3, {16000000})) {
+        std::vector<T> a(n), b(n);
+        for (size_t i = 0; i < n; i++) {
+            a[i] = b[i] = (T) (1 + bench::random(100));
+        }
+        size_t calls = std::max((size_t) 1, elements_per_pass / n);
+        size_t ops = calls * n;
+
+        for (int which = mstd::simd::isa_generic; which <= mstd::simd::detected_isa(); which++) {
+            mstd::simd::set_isa((mstd::simd::isa) which);
+            std::string config = std::string(mstd::simd::isa_name((mstd::simd::isa) which)) + " n=" +
+                                 bench::size_name(n);
+            size_t sum = 0;
+            double seconds = bench::measure([&]() {
+                for (size_t c = 0; c < calls; c++) {
+                    sum += mstd::simd::find(a.data(), n, (T) 0);
+                }
+            });
+            bench::report(std::string(type) + " find", config, ops, seconds);
+            seconds = bench::measure([&]() {
+                for (size_t c = 0; c < calls; c++) {
+                    sum += mstd::simd::count(a.data(), n, (T) 7);
+                }
+            });
+            bench::report(std::string(type) + " count", config, ops, seconds);
+            seconds = bench::measure([&]() {
+                for (size_t c = 0; c < calls; c++) {
+                    sum += mstd::simd::min_element(a.data(), n);
+                }
+            });
+            bench::report(std::string(type) + " min_element", config, ops, seconds);
+            seconds = bench::measure([&]() {
+                for (size_t c = 0; c < calls; c++) {
+                    sum += mstd::simd::equal(a.data(), b.data(), n);
+                }
+            });
+            bench::report(std::string(type) + " equal", config, ops, seconds);
+            bench::do_not_optimize(sum);
+        }
+    }
+    mstd::simd::set_isa(saved);
+}
+
+BENCH(simd_kernels) {
+    simd_kernels<int8_t>("int8");
+    simd_kernels<int32_t>("int32");
+    simd_kernels<int64_t>("int64");
+    simd_kernels<float>("float");
+    simd_kernels<double>("double");
+}
+
+struct trade {
+    int64_t id;
+    double price;
+    int32_t quantity;
+    std::string symbol;
+};
+
+// A column scan (sum of one field) and an aggregate over two fields, on records stored as an array of structs
+// and as a soa_vector
+BENCH(soa_scans) {
+    for (size_t n : bench::sizes({1000, 100000, 1000000}, 2, {10000000})) {
+        std::string config = "n=" + bench::size_name(n);
+        size_t rounds = std::max((size_t) 1, (bench::opts().quick ? 100000 : 20000000) / n);
+        std::vector<trade> aos;
+        mstd::soa_vector<int64_t, double, int32_t, std::string> soa;
+        for (size_t i = 0; i < n; i++) {
+            trade t = {(int64_t) i, (double) bench::random(10000) / 100, (int32_t) bench::random(1000), "SYM"};
+            aos.push_back(t);
+            soa.push(t.id, t.price, t.quantity, t.symbol);
+        }
+        double total = 0;
+
+        double seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                double sum = 0;
+                for (const trade &t : aos) {
+                    sum += t.price;
+                }
+                total += sum;
+            }
+        });
+        bench::report("AoS sum(price)", config, n * rounds, seconds);
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                double sum = 0;
+                for (double price : soa.column<1>()) {
+                    sum += price;
+                }
+                total += sum;
+            }
+        });
+        bench::report("SoA sum(price)", config, n * rounds, seconds);
+
+        seconds = bench::measure([&]() {
+            for (size_t r = 0; r < rounds; r++) {
+                double notional = 0;
+                for (const trade &t : aos) {
+                    notional += t.price * t.quantity;
+                }
+                total += notional;
+            }
+        });
+        bench::report("AoS sum(price * quantity)", config, n * rounds, seconds);
+        seconds = bench::measure([&]() {
+            mstd::span<const double> prices = soa.column<1>();
+            mstd::span<const int32_t> quantities = soa.column<2>();
+            for (size_t r = 0; r < rounds; r++) {
+                double notional = 0;
+                for (size_t i = 0; i < prices.size(); i++) {
+                    notional += prices[i] * quantities[i];
+                }
+                total += notional;
+            }
+        });
+        bench::report("SoA sum(price * quantity)", config, n * rounds, seconds);
+        bench::do_not_optimize(total);
+    }
+}
+
+// Allocation-heavy workloads with each memory_resource: many short-lived small vectors, a hash_map filled
+// and dropped, and a queue that keeps growing and draining. The arena is released after every round
+static void allocator_workloads(const char *name, mstd::memory_resource *resource, mstd::arena_resource *arena) {
+    size_t scale = bench::opts().quick ? 1000 : 100000;
+    std::vector<size_t> sizes(scale);
+    for (size_t &s : sizes) {
+        s = 1 + bench::random(64);
+    }
+
+    double seconds = bench::measure([&]() {
+        for (size_t s : sizes) {
+            mstd::vector<uint64_t> v(1, resource);
+            for (size_t i = 0; i < s; i++) {
+                v.push(i);
+            }
+            bench::do_not_optimize(v.begin());
+        }
+        if (arena != nullptr) arena->release();
+    });
+    bench::report("short-lived vectors", name, scale, seconds);
+
+    seconds = bench::measure([&]() {
+        {
+            hash_map<uint64_t, uint64_t> map(8, mstd::hasher<uint64_t>(), resource);
+            for (size_t i = 0; i < scale * 10; i++) {
+                map.try_emplace(i * 0x9e3779b97f4a7c15ULL, i);
+            }
+            bench::do_not_optimize(map);
+        }
+        if (arena != nullptr) arena->release();
+    });
+    bench::report("hash_map fill and drop", name, scale * 10, seconds);
+
+    seconds = bench::measure([&]() {
+        {
+            mstd::queue<uint64_t> queue(-1, resource);
+            for (size_t round = 0; round < 10; round++) {
+                for (size_t i = 0; i < scale; i++) {
+                    queue.push(i);
+                }
+                while (!queue.empty()) {
+                    bench::do_not_optimize(queue.pop());
+                }
+            }
+        }
+        if (arena != nullptr) arena->release();
+    });
+    bench::report("queue grow and drain", name, scale * 10, seconds);
+}
+
+BENCH(allocator_workloads) {
+    allocator_workloads("malloc", mstd::default_resource(), nullptr);
+    {
+        mstd::arena_resource arena;
+        allocator_workloads("arena", &arena, &arena);
+    }
+    {
+        mstd::pool_resource pool;
+        allocator_workloads("pool", &pool, nullptr);
+    }
+    allocator_workloads("slab", mstd::slab_resource(), nullptr);
+}
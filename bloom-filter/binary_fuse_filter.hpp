@@ -0,0 +1,390 @@
+#ifndef BINARY_FUSE_FILTER_HPP
+#define BINARY_FUSE_FILTER_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "mvector.hpp"
+#include "hash_functions.hpp"
+#include "thread_pool.hpp"
+
+namespace fuse_constants {
+    // Number of locations each key maps to
+    const uint32_t arity = 3;
+    const int max_iterations = 100;
+    const uint32_t max_segment_length = 262144;
+    // Below this many keys we don't bother spreading the hashing over a thread pool
+    const size_t parallel_threshold = 1 << 16;
+    const size_t parallel_chunks = 32;
+}
+
+// Static approximate membership filter (Graf & Lemire's binary fuse filter)
+// The key set is given once, at construction time, and can not be modified afterwards.
+// Compared to bloom_filter, it needs ~1.13 * sizeof(F) bytes per key and exactly 3 memory accesses per query.
+// The false positive rate is ~1 / 2^(8 * sizeof(F))
+template <typename F>
+class binary_fuse_filter {
+public:
+    // The (optional) thread pool is only used to hash the keys.
+    // Duplicate keys are allowed
+    explicit binary_fuse_filter(const mstd::vector<std::string> &keys, thread_pool *pool = nullptr);
+    binary_fuse_filter(const binary_fuse_filter &)=delete;
+    ~binary_fuse_filter();
+
+    bool check(const std::string &word) const;
+
+    // Number of keys the filter was built from (duplicates excluded)
+    size_t size() const;
+
+    size_t size_in_bytes() const;
+
+    double bits_per_key() const;
+
+    binary_fuse_filter &operator=(const binary_fuse_filter &)=delete;
+private:
+    uint64_t _seed;
+    uint32_t _size;
+    uint32_t _segment_length;
+    uint32_t _segment_length_mask;
+    uint32_t _segment_count;
+    uint32_t _segment_count_length;
+    uint32_t _array_length;
+    F *_fingerprints;
+
+    void _allocate(uint32_t size);
+
+    void _populate(uint64_t *keys, uint32_t size);
+
+    uint64_t _mix(uint64_t key) const;
+
+    uint32_t _location(int index, uint64_t hash) const;
+
+    static F _fingerprint(uint64_t hash);
+
+    static uint64_t _mulhi(uint64_t a, uint64_t b);
+
+    static uint64_t _splitmix64(uint64_t &state);
+};
+
+typedef binary_fuse_filter<uint8_t> binary_fuse8;
+typedef binary_fuse_filter<uint16_t> binary_fuse16;
+
+
+template <typename F>
+binary_fuse_filter<F>::binary_fuse_filter(const mstd::vector<std::string> &keys, thread_pool *pool)
+        : _seed(0), _fingerprints(nullptr) {
+    size_t n = keys.size();
+    if (n > UINT32_MAX) throw std::runtime_error("Too many keys for a binary fuse filter");
+
+    // Hash every key exactly once. Every construction attempt re-seeds these
+    // 64-bit hashes instead of re-hashing the strings
+    auto *hashes = new uint64_t[n + 1];
+    if (pool != nullptr && n >= fuse_constants::parallel_threshold) {
+        size_t chunk_size = (n + fuse_constants::parallel_chunks - 1) / fuse_constants::parallel_chunks;
+        for (size_t start = 0; start < n; start += chunk_size) {
+            size_t end = std::min(n, start + chunk_size);
+            pool->add_task([&keys, hashes, start, end]() {
+                for (size_t i = start; i < end; i++) {
+                    const std::string &k = keys[i];
+                    hashes[i] = mstd::murmur3_64(k.data(), k.length());
+                }
+            });
+        }
+        pool->wait_all();
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            const std::string &k = keys[i];
+            hashes[i] = mstd::murmur3_64(k.data(), k.length());
+        }
+    }
+
+    try {
+        _allocate((uint32_t) n);
+        _populate(hashes, (uint32_t) n);
+    } catch (...) {
+        delete[] hashes;
+        delete[] _fingerprints;
+        throw;
+    }
+
+    delete[] hashes;
+}
+
+template <typename F>
+binary_fuse_filter<F>::~binary_fuse_filter() {
+    delete[] _fingerprints;
+}
+
+template <typename F>
+bool binary_fuse_filter<F>::check(const std::string &word) const {
+    uint64_t hash = _mix(mstd::murmur3_64(word.data(), word.length()));
+    F f = _fingerprint(hash);
+
+    uint32_t h0 = (uint32_t) _mulhi(hash, _segment_count_length);
+    uint32_t h1 = h0 + _segment_length;
+    uint32_t h2 = h1 + _segment_length;
+    h1 ^= (uint32_t) (hash >> 18) & _segment_length_mask;
+    h2 ^= (uint32_t) hash & _segment_length_mask;
+
+    f ^= _fingerprints[h0] ^ _fingerprints[h1] ^ _fingerprints[h2];
+    return f == 0;
+}
+
+template <typename F>
+size_t binary_fuse_filter<F>::size() const {
+    return _size;
+}
+
+template <typename F>
+size_t binary_fuse_filter<F>::size_in_bytes() const {
+    return _array_length * sizeof(F) + sizeof(*this);
+}
+
+template <typename F>
+double binary_fuse_filter<F>::bits_per_key() const {
+    if (_size == 0) return 0;
+    return (double) (_array_length * sizeof(F) * 8) / _size;
+}
+
+// Sizing parameters as given by the paper's reference implementation.
+// They are very sensitive (e.g. replacing floor with round substantially affects construction time)
+template <typename F>
+void binary_fuse_filter<F>::_allocate(uint32_t size) {
+    using fuse_constants::arity;
+
+    _size = size;
+    if (size == 0) {
+        _segment_length = 4;
+    } else {
+        _segment_length = (uint32_t) 1 << (int) floor(log((double) size) / log(3.33) + 2.25);
+    }
+    if (_segment_length > fuse_constants::max_segment_length) {
+        _segment_length = fuse_constants::max_segment_length;
+    }
+    _segment_length_mask = _segment_length - 1;
+
+    double size_factor = size <= 1 ? 0 : std::max(1.125, 0.875 + 0.25 * log(1000000.0) / log((double) size));
+    auto capacity = (uint32_t) round((double) size * size_factor);
+    uint32_t init_segment_count = (capacity + _segment_length - 1) / _segment_length;
+    init_segment_count = init_segment_count > arity - 1 ? init_segment_count - (arity - 1) : 0;
+
+    _array_length = (init_segment_count + arity - 1) * _segment_length;
+    _segment_count = (_array_length + _segment_length - 1) / _segment_length;
+    if (_segment_count <= arity - 1) {
+        _segment_count = 1;
+    } else {
+        _segment_count -= arity - 1;
+    }
+    _array_length = (_segment_count + arity - 1) * _segment_length;
+    _segment_count_length = _segment_count * _segment_length;
+
+    //                                             v Initialises array to 0
+    _fingerprints = new F[_array_length]();
+}
+
+// Hypergraph peeling. keys holds one 64-bit hash per key and must have room for size + 1 entries
+template <typename F>
+void binary_fuse_filter<F>::_populate(uint64_t *keys, uint32_t size) {
+    if (size == 0) return;
+
+    uint64_t rng = 0x726b2b9d438b9d4dLLU;
+    _seed = _splitmix64(rng);
+
+    uint32_t capacity = _array_length;
+    auto *reverse_order = new uint64_t[size + 1]();
+    auto *alone = new uint32_t[capacity];
+    auto *t2count = new uint8_t[capacity]();
+    auto *reverse_h = new uint8_t[size];
+    auto *t2hash = new uint64_t[capacity]();
+
+    uint32_t block_bits = 1;
+    while (((uint32_t) 1 << block_bits) < _segment_count) {
+        block_bits++;
+    }
+    uint32_t block = (uint32_t) 1 << block_bits;
+    auto *start_pos = new uint32_t[block];
+    uint32_t h012[5];
+
+    reverse_order[size] = 1;
+    bool success = false;
+    for (int loop = 0; loop < fuse_constants::max_iterations; loop++) {
+        // Roughly sort the hashes by segment, so that the counting pass below is cache friendly
+        for (uint32_t i = 0; i < block; i++) {
+            start_pos[i] = (uint32_t) (((uint64_t) i * size) >> block_bits);
+        }
+
+        uint32_t mask_block = block - 1;
+        for (uint32_t i = 0; i < size; i++) {
+            uint64_t hash = _mix(keys[i]);
+            uint64_t segment_index = hash >> (64 - block_bits);
+            while (reverse_order[start_pos[segment_index]] != 0) {
+                segment_index++;
+                segment_index &= mask_block;
+            }
+            reverse_order[start_pos[segment_index]] = hash;
+            start_pos[segment_index]++;
+        }
+
+        bool error = false;
+        uint32_t duplicates = 0;
+        for (uint32_t i = 0; i < size; i++) {
+            uint64_t hash = reverse_order[i];
+            uint32_t h0 = _location(0, hash);
+            t2count[h0] += 4;
+            t2hash[h0] ^= hash;
+            uint32_t h1 = _location(1, hash);
+            t2count[h1] += 4;
+            t2count[h1] ^= 1;
+            t2hash[h1] ^= hash;
+            uint32_t h2 = _location(2, hash);
+            t2count[h2] += 4;
+            t2hash[h2] ^= hash;
+            t2count[h2] ^= 2;
+
+            // A hash that cancels itself out at one location is a duplicate key. Undo its insertion
+            if ((t2hash[h0] & t2hash[h1] & t2hash[h2]) == 0) {
+                if (((t2hash[h0] == 0) && (t2count[h0] == 8))
+                    || ((t2hash[h1] == 0) && (t2count[h1] == 8))
+                    || ((t2hash[h2] == 0) && (t2count[h2] == 8))) {
+                    duplicates++;
+                    t2count[h0] -= 4;
+                    t2hash[h0] ^= hash;
+                    t2count[h1] -= 4;
+                    t2count[h1] ^= 1;
+                    t2hash[h1] ^= hash;
+                    t2count[h2] -= 4;
+                    t2count[h2] ^= 2;
+                    t2hash[h2] ^= hash;
+                }
+            }
+            // The 6-bit counters overflowed
+            error = (t2count[h0] < 4) || error;
+            error = (t2count[h1] < 4) || error;
+            error = (t2count[h2] < 4) || error;
+        }
+
+        if (!error) {
+            // Queue every location that holds a single key
+            uint32_t qsize = 0;
+            for (uint32_t i = 0; i < capacity; i++) {
+                alone[qsize] = i;
+                qsize += ((t2count[i] >> 2) == 1) ? 1 : 0;
+            }
+
+            uint32_t stack_size = 0;
+            while (qsize > 0) {
+                qsize--;
+                uint32_t index = alone[qsize];
+                if ((t2count[index] >> 2) == 1) {
+                    uint64_t hash = t2hash[index];
+
+                    h012[1] = _location(1, hash);
+                    h012[2] = _location(2, hash);
+                    h012[3] = _location(0, hash);
+                    h012[4] = h012[1];
+                    uint8_t found = t2count[index] & 3;
+                    reverse_h[stack_size] = found;
+                    reverse_order[stack_size] = hash;
+                    stack_size++;
+
+                    uint32_t other_index1 = h012[found + 1];
+                    alone[qsize] = other_index1;
+                    qsize += ((t2count[other_index1] >> 2) == 2) ? 1 : 0;
+                    t2count[other_index1] -= 4;
+                    t2count[other_index1] ^= (found + 1) % 3;
+                    t2hash[other_index1] ^= hash;
+
+                    uint32_t other_index2 = h012[found + 2];
+                    alone[qsize] = other_index2;
+                    qsize += ((t2count[other_index2] >> 2) == 2) ? 1 : 0;
+                    t2count[other_index2] -= 4;
+                    t2count[other_index2] ^= (found + 2) % 3;
+                    t2hash[other_index2] ^= hash;
+                }
+            }
+
+            if (stack_size + duplicates == size) {
+                size = stack_size;
+                success = true;
+                break;
+            }
+
+            if (duplicates > 0) {
+                // Some duplicates went unnoticed. Remove them all before trying again
+                std::sort(keys, keys + size);
+                size = (uint32_t) (std::unique(keys, keys + size) - keys);
+                reverse_order[size] = 1;
+            }
+        }
+
+        memset(reverse_order, 0, sizeof(uint64_t) * size);
+        memset(t2count, 0, sizeof(uint8_t) * capacity);
+        memset(t2hash, 0, sizeof(uint64_t) * capacity);
+        _seed = _splitmix64(rng);
+    }
+
+    if (success) {
+        _size = size;
+        // Assign the fingerprints in reverse peeling order
+        for (uint32_t i = size - 1; i < size; i--) {
+            uint64_t hash = reverse_order[i];
+            uint8_t found = reverse_h[i];
+            h012[0] = _location(0, hash);
+            h012[1] = _location(1, hash);
+            h012[2] = _location(2, hash);
+            h012[3] = h012[0];
+            h012[4] = h012[1];
+            _fingerprints[h012[found]] = _fingerprint(hash)
+                                         ^ _fingerprints[h012[found + 1]]
+                                         ^ _fingerprints[h012[found + 2]];
+        }
+    }
+
+    delete[] reverse_order;
+    delete[] alone;
+    delete[] t2count;
+    delete[] reverse_h;
+    delete[] t2hash;
+    delete[] start_pos;
+
+    // This has a lower probability than a cosmic ray flipping a bit
+    if (!success) throw std::runtime_error("Could not construct binary fuse filter");
+}
+
+template <typename F>
+uint64_t binary_fuse_filter<F>::_mix(uint64_t key) const {
+    return mstd::murmur3_fmix64(key + _seed);
+}
+
+template <typename F>
+uint32_t binary_fuse_filter<F>::_location(int index, uint64_t hash) const {
+    uint64_t h = _mulhi(hash, _segment_count_length);
+    h += index * _segment_length;
+    // index 0: no xor. index 1: hash >> 18. index 2: the low bits of the hash
+    uint64_t hh = hash & ((1LLU << 36) - 1);
+    h ^= (size_t) ((hh >> (36 - 18 * index)) & _segment_length_mask);
+    return (uint32_t) h;
+}
+
+template <typename F>
+F binary_fuse_filter<F>::_fingerprint(uint64_t hash) {
+    return (F) (hash ^ (hash >> 32));
+}
+
+template <typename F>
+uint64_t binary_fuse_filter<F>::_mulhi(uint64_t a, uint64_t b) {
+    return (uint64_t) (((__uint128_t) a * b) >> 64);
+}
+
+template <typename F>
+uint64_t binary_fuse_filter<F>::_splitmix64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15LLU);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9LLU;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBLLU;
+    return z ^ (z >> 31);
+}
+
+#endif // BINARY_FUSE_FILTER_HPP
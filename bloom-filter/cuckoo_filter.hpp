@@ -0,0 +1,293 @@
+#ifndef CUCKOO_FILTER_HPP
+#define CUCKOO_FILTER_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include "hash_functions.hpp"
+
+namespace cuckoo_constants {
+    const int bucket_size = 4;
+    const int max_kicks = 500;
+    // Fingerprints that could not be placed after max_kicks relocations
+    const int stash_size = 4;
+    // Highest load a table of 4-way buckets reliably reaches
+    const double max_load = 0.95;
+}
+
+// Approximate membership filter that supports deletion (Fan et al.'s cuckoo filter)
+// Each key is reduced to a fingerprint of type F, stored in one of two 4-way buckets.
+// With F = uint8_t the filter uses ~8.4 bits per key at full load, with a false positive rate of ~3%.
+// With F = uint16_t it uses ~16.8 bits per key, with a false positive rate of ~0.01%.
+// Only remove words that were previously inserted: removing anything else may remove another word's fingerprint
+template <typename F = uint8_t>
+class cuckoo_filter {
+public:
+    // capacity is the number of keys the filter should be able to hold
+    explicit cuckoo_filter(size_t capacity);
+    cuckoo_filter(const cuckoo_filter &)=delete;
+    ~cuckoo_filter();
+
+    bool check(const std::string &word) const;
+
+    // Returns false if the filter is full (the word was not inserted)
+    bool insert(const std::string &word);
+
+    // Returns false if the word was not found
+    bool remove(const std::string &word);
+
+    size_t size() const;
+
+    // Number of fingerprint slots
+    size_t capacity() const;
+
+    double load_factor() const;
+
+    size_t size_in_bytes() const;
+
+    double bits_per_key() const;
+
+    cuckoo_filter &operator=(const cuckoo_filter &)=delete;
+private:
+    // A whole bucket, loaded as a single word so that its slots can be compared at once
+    typedef typename std::conditional<sizeof(F) == 1, uint32_t, uint64_t>::type bucket_word;
+
+    struct stash_entry {
+        F fingerprint;
+        size_t index;
+    };
+
+    F *_buckets;
+    size_t _num_buckets;
+    size_t _mask;
+    size_t _num_items;
+
+    stash_entry _stash[cuckoo_constants::stash_size];
+    int _stash_used;
+
+    void _hash(const std::string &word, size_t &index, F &fingerprint) const;
+
+    size_t _alt_index(size_t index, F fingerprint) const;
+
+    bool _bucket_contains(size_t index, F fingerprint) const;
+
+    bool _bucket_insert(size_t index, F fingerprint);
+
+    bool _bucket_remove(size_t index, F fingerprint);
+
+    bool _stash_contains(size_t index1, size_t index2, F fingerprint) const;
+
+    void _drain_stash();
+
+    static bucket_word _broadcast(F fingerprint);
+};
+
+template <typename F>
+cuckoo_filter<F>::cuckoo_filter(size_t capacity) : _num_items(0), _stash_used(0) {
+    static_assert(sizeof(F) == 1 || sizeof(F) == 2, "cuckoo_filter fingerprints must be 8 or 16 bits");
+
+    // Bucket indices come from a xor of two hashes, so the number of buckets has to be a power of 2
+    auto wanted = (size_t) (capacity / (cuckoo_constants::bucket_size * cuckoo_constants::max_load)) + 1;
+    _num_buckets = 1;
+    while (_num_buckets < wanted) {
+        _num_buckets <<= 1;
+    }
+    _mask = _num_buckets - 1;
+
+    //                                                                  v Initialises array to 0 (empty slots)
+    _buckets = new F[_num_buckets * cuckoo_constants::bucket_size]();
+}
+
+template <typename F>
+cuckoo_filter<F>::~cuckoo_filter() {
+    delete[] _buckets;
+}
+
+template <typename F>
+bool cuckoo_filter<F>::check(const std::string &word) const {
+    size_t i1;
+    F fp;
+    _hash(word, i1, fp);
+    size_t i2 = _alt_index(i1, fp);
+
+    return _bucket_contains(i1, fp) || _bucket_contains(i2, fp) || _stash_contains(i1, i2, fp);
+}
+
+template <typename F>
+bool cuckoo_filter<F>::insert(const std::string &word) {
+    // Once the stash is full, a failed relocation chain would lose a fingerprint
+    if (_stash_used == cuckoo_constants::stash_size) return false;
+
+    size_t index;
+    F fp;
+    _hash(word, index, fp);
+
+    if (_bucket_insert(index, fp) || _bucket_insert(_alt_index(index, fp), fp)) {
+        _num_items++;
+        return true;
+    }
+
+    // Both buckets are full. Kick a (pseudo-random) resident out and relocate it to its alternate bucket
+    index = (fp & 1) ? index : _alt_index(index, fp);
+    for (int kick = 0; kick < cuckoo_constants::max_kicks; kick++) {
+        size_t slot = (index + kick) % cuckoo_constants::bucket_size;
+        F &victim = _buckets[index * cuckoo_constants::bucket_size + slot];
+        F tmp = victim;
+        victim = fp;
+        fp = tmp;
+
+        index = _alt_index(index, fp);
+        if (_bucket_insert(index, fp)) {
+            _num_items++;
+            return true;
+        }
+    }
+
+    _stash[_stash_used].fingerprint = fp;
+    _stash[_stash_used].index = index;
+    _stash_used++;
+    _num_items++;
+    return true;
+}
+
+template <typename F>
+bool cuckoo_filter<F>::remove(const std::string &word) {
+    size_t i1;
+    F fp;
+    _hash(word, i1, fp);
+    size_t i2 = _alt_index(i1, fp);
+
+    if (_bucket_remove(i1, fp) || _bucket_remove(i2, fp)) {
+        _num_items--;
+        // We've just freed a slot. A stashed fingerprint may fit now
+        _drain_stash();
+        return true;
+    }
+
+    for (int i = 0; i < _stash_used; i++) {
+        stash_entry &e = _stash[i];
+        if (e.fingerprint == fp && (e.index == i1 || e.index == i2)) {
+            e = _stash[--_stash_used];
+            _num_items--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename F>
+size_t cuckoo_filter<F>::size() const {
+    return _num_items;
+}
+
+template <typename F>
+size_t cuckoo_filter<F>::capacity() const {
+    return _num_buckets * cuckoo_constants::bucket_size;
+}
+
+template <typename F>
+double cuckoo_filter<F>::load_factor() const {
+    return (double) _num_items / capacity();
+}
+
+template <typename F>
+size_t cuckoo_filter<F>::size_in_bytes() const {
+    return capacity() * sizeof(F) + sizeof(*this);
+}
+
+template <typename F>
+double cuckoo_filter<F>::bits_per_key() const {
+    if (_num_items == 0) return 0;
+    return (double) (capacity() * sizeof(F) * 8) / _num_items;
+}
+
+// The first 64 bits of the murmur3 hash pick the bucket, the second ones the fingerprint
+template <typename F>
+void cuckoo_filter<F>::_hash(const std::string &word, size_t &index, F &fingerprint) const {
+    uint64_t h[2];
+    mstd::murmur3_128(word.data(), word.length(), 0, h);
+
+    index = (size_t) (h[0] & _mask);
+    fingerprint = (F) h[1];
+    // 0 marks an empty slot
+    if (fingerprint == 0) fingerprint = 1;
+}
+
+// Partial-key cuckoo hashing: the alternate bucket only depends on the current one and the fingerprint,
+// so that relocation doesn't need the original key. Applying it twice yields the original index
+template <typename F>
+size_t cuckoo_filter<F>::_alt_index(size_t index, F fingerprint) const {
+    return (index ^ (size_t) ((uint64_t) fingerprint * 0x5bd1e995)) & _mask;
+}
+
+// Compares all of the bucket's slots at once: (x - 0x01..01) & ~x & 0x80..80 is non-zero
+// iff one of x's lanes is zero, i.e. one of the slots equals the fingerprint
+template <typename F>
+bool cuckoo_filter<F>::_bucket_contains(size_t index, F fingerprint) const {
+    bucket_word w;
+    memcpy(&w, _buckets + index * cuckoo_constants::bucket_size, sizeof(w));
+    bucket_word ones = _broadcast(1);
+    bucket_word x = w ^ _broadcast(fingerprint);
+
+    return ((x - ones) & ~x & (ones << (8 * sizeof(F) - 1))) != 0;
+}
+
+template <typename F>
+bool cuckoo_filter<F>::_bucket_insert(size_t index, F fingerprint) {
+    F *bucket = _buckets + index * cuckoo_constants::bucket_size;
+    for (int i = 0; i < cuckoo_constants::bucket_size; i++) {
+        if (bucket[i] == 0) {
+            bucket[i] = fingerprint;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename F>
+bool cuckoo_filter<F>::_bucket_remove(size_t index, F fingerprint) {
+    F *bucket = _buckets + index * cuckoo_constants::bucket_size;
+    for (int i = 0; i < cuckoo_constants::bucket_size; i++) {
+        if (bucket[i] == fingerprint) {
+            bucket[i] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename F>
+bool cuckoo_filter<F>::_stash_contains(size_t index1, size_t index2, F fingerprint) const {
+    for (int i = 0; i < _stash_used; i++) {
+        const stash_entry &e = _stash[i];
+        if (e.fingerprint == fingerprint && (e.index == index1 || e.index == index2)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename F>
+void cuckoo_filter<F>::_drain_stash() {
+    for (int i = 0; i < _stash_used; i++) {
+        stash_entry &e = _stash[i];
+        if (_bucket_insert(e.index, e.fingerprint) || _bucket_insert(_alt_index(e.index, e.fingerprint), e.fingerprint)) {
+            e = _stash[--_stash_used];
+            i--;
+        }
+    }
+}
+
+template <typename F>
+typename cuckoo_filter<F>::bucket_word cuckoo_filter<F>::_broadcast(F fingerprint) {
+    bucket_word w = 0;
+    for (int i = 0; i < cuckoo_constants::bucket_size; i++) {
+        w = (w << (8 * sizeof(F))) | fingerprint;
+    }
+    return w;
+}
+
+#endif // CUCKOO_FILTER_HPP
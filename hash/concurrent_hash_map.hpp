@@ -0,0 +1,401 @@
+#ifndef CONCURRENT_HASH_MAP_HPP
+#define CONCURRENT_HASH_MAP_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <pthread.h>
+#include "hash_functions.hpp"
+#include "epoch.hpp"
+
+namespace concurrent_hash_map_constants {
+    // Number of bucket locks. Has to be a power of 2 and at most initial_size
+    const size_t num_stripes = 64;
+    const size_t initial_size = 64;
+    // Average number of items per bucket before the table doubles
+    const size_t max_load = 1;
+    // Number of buckets a writer migrates every time it helps a resize
+    const size_t migration_chunk = 64;
+}
+
+namespace mstd {
+    // Hash map that can be shared between threads.
+    // Reads take no locks and never wait: they pin the current epoch (see epoch.hpp) and walk
+    // immutable nodes. Writers lock one of num_stripes bucket stripes, so writers only contend
+    // when they hash to the same stripe.
+    // The table doubles cooperatively: once a resize has started, every writer migrates a chunk of
+    // buckets before its own operation. Migrated buckets are copied, so readers keep using the old
+    // table undisturbed and follow a forwarding marker once a bucket has moved.
+    // Values are returned by copy, since they can be replaced concurrently.
+    // Unlike the other maps it doesn't take a memory_resource: nodes and tables are allocated by any writer
+    // and freed by whichever thread reclaims their epoch, which none of the non-malloc resources allow.
+    template <typename K, typename V, typename H = mstd::hasher<K>>
+    class concurrent_hash_map {
+    public:
+        concurrent_hash_map();
+        concurrent_hash_map(const concurrent_hash_map &)=delete;
+
+        // Must not run concurrently with any other operation
+        ~concurrent_hash_map();
+
+        // Returns false (and leaves the existing value untouched) if the key already exists
+        bool insert(const K &key, const V &value);
+
+        // Returns true if the key was inserted, false if an existing value was replaced
+        bool insert_or_assign(const K &key, const V &value);
+
+        // Copies the key's value to out. Returns false if the key doesn't exist
+        bool find(const K &key, V &out) const;
+
+        V get(const K &key) const;
+
+        bool contains(const K &key) const;
+
+        // Returns false if the key didn't exist
+        bool erase(const K &key);
+
+        // Exact only when there are no concurrent writers
+        size_t size() const;
+
+        size_t bucket_count() const;
+
+        concurrent_hash_map &operator=(const concurrent_hash_map &)=delete;
+    private:
+        struct node {
+            const K key;
+            const V value;
+            const uint64_t hash;
+            std::atomic<node *> next;
+
+            node(const K &k, const V &v, uint64_t h, node *n) : key(k), value(v), hash(h), next(n) { }
+        };
+
+        struct table {
+            size_t size;
+            size_t mask;
+            std::atomic<node *> *buckets;
+            // Set once a resize starts
+            std::atomic<table *> next;
+            std::atomic<size_t> migrate_cursor;
+            std::atomic<size_t> migrated;
+
+            explicit table(size_t size);
+            ~table();
+        };
+
+        // Bucket lock and number of items in the buckets it covers
+        struct alignas(64) stripe {
+            pthread_mutex_t mtx;
+            size_t count;
+        };
+
+        std::atomic<table *> _table;
+        mutable stripe _stripes[concurrent_hash_map_constants::num_stripes];
+        pthread_mutex_t _resize_mtx;
+        H _hasher;
+
+        // Head of a bucket that has been migrated to the next table
+        static node *_moved();
+
+        static stripe &_stripe_of(stripe *stripes, uint64_t hash);
+
+        // Called with the key's stripe locked. Returns the table that holds the key's bucket
+        table *_locate(uint64_t hash) const;
+
+        // Helps an ongoing resize of t, if there is one
+        void _help_resize(table *t);
+
+        void _start_resize(table *t);
+
+        // Called with the bucket's stripe locked
+        void _migrate_bucket(table *t, size_t index);
+
+        static void _delete_chain(node *n);
+    };
+}
+
+template <typename K, typename V, typename H>
+mstd::concurrent_hash_map<K, V, H>::table::table(size_t size) : size(size), mask(size - 1), next(nullptr),
+                                                               migrate_cursor(0), migrated(0) {
+    buckets = new std::atomic<node *>[size];
+    for (size_t i = 0; i < size; i++) {
+        buckets[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+template <typename K, typename V, typename H>
+mstd::concurrent_hash_map<K, V, H>::table::~table() {
+    delete[] buckets;
+}
+
+template <typename K, typename V, typename H>
+mstd::concurrent_hash_map<K, V, H>::concurrent_hash_map() {
+    static_assert((concurrent_hash_map_constants::num_stripes & (concurrent_hash_map_constants::num_stripes - 1)) == 0,
+                  "num_stripes must be a power of 2");
+    static_assert(concurrent_hash_map_constants::num_stripes <= concurrent_hash_map_constants::initial_size,
+                  "There must be at least as many buckets as stripes");
+
+    _table.store(new table(concurrent_hash_map_constants::initial_size));
+    for (size_t i = 0; i < concurrent_hash_map_constants::num_stripes; i++) {
+        pthread_mutex_init(&_stripes[i].mtx, nullptr);
+        _stripes[i].count = 0;
+    }
+    pthread_mutex_init(&_resize_mtx, nullptr);
+}
+
+template <typename K, typename V, typename H>
+mstd::concurrent_hash_map<K, V, H>::~concurrent_hash_map() {
+    table *t = _table.load();
+    while (t != nullptr) {
+        for (size_t i = 0; i < t->size; i++) {
+            node *n = t->buckets[i].load();
+            if (n != _moved()) {
+                _delete_chain(n);
+            }
+        }
+        table *next = t->next.load();
+        delete t;
+        t = next;
+    }
+
+    for (size_t i = 0; i < concurrent_hash_map_constants::num_stripes; i++) {
+        pthread_mutex_destroy(&_stripes[i].mtx);
+    }
+    pthread_mutex_destroy(&_resize_mtx);
+}
+
+template <typename K, typename V, typename H>
+bool mstd::concurrent_hash_map<K, V, H>::insert(const K &key, const V &value) {
+    uint64_t hash = _hasher(key);
+    stripe &s = _stripe_of(_stripes, hash);
+    epoch::guard g;
+
+    _help_resize(_table.load());
+
+    pthread_mutex_lock(&s.mtx);
+    table *t = _locate(hash);
+    std::atomic<node *> &bucket = t->buckets[hash & t->mask];
+    node *head = bucket.load(std::memory_order_relaxed);
+    for (node *n = head; n != nullptr; n = n->next.load(std::memory_order_relaxed)) {
+        if (n->hash == hash && n->key == key) {
+            pthread_mutex_unlock(&s.mtx);
+            return false;
+        }
+    }
+
+    bucket.store(new node(key, value, hash, head), std::memory_order_release);
+    size_t count = ++s.count;
+    pthread_mutex_unlock(&s.mtx);
+
+    t = _table.load();
+    if (count * concurrent_hash_map_constants::num_stripes > t->size * concurrent_hash_map_constants::max_load) {
+        _start_resize(t);
+    }
+
+    return true;
+}
+
+template <typename K, typename V, typename H>
+bool mstd::concurrent_hash_map<K, V, H>::insert_or_assign(const K &key, const V &value) {
+    uint64_t hash = _hasher(key);
+    stripe &s = _stripe_of(_stripes, hash);
+    epoch::guard g;
+
+    _help_resize(_table.load());
+
+    pthread_mutex_lock(&s.mtx);
+    table *t = _locate(hash);
+    std::atomic<node *> &bucket = t->buckets[hash & t->mask];
+    std::atomic<node *> *link = &bucket;
+    for (node *n = bucket.load(std::memory_order_relaxed); n != nullptr; n = n->next.load(std::memory_order_relaxed)) {
+        if (n->hash == hash && n->key == key) {
+            // Nodes are immutable: readers either see the old node or the new one, never a half-written value
+            link->store(new node(key, value, hash, n->next.load(std::memory_order_relaxed)), std::memory_order_release);
+            pthread_mutex_unlock(&s.mtx);
+            epoch::retire(n);
+            return false;
+        }
+        link = &n->next;
+    }
+
+    bucket.store(new node(key, value, hash, bucket.load(std::memory_order_relaxed)), std::memory_order_release);
+    size_t count = ++s.count;
+    pthread_mutex_unlock(&s.mtx);
+
+    t = _table.load();
+    if (count * concurrent_hash_map_constants::num_stripes > t->size * concurrent_hash_map_constants::max_load) {
+        _start_resize(t);
+    }
+
+    return true;
+}
+
+template <typename K, typename V, typename H>
+bool mstd::concurrent_hash_map<K, V, H>::find(const K &key, V &out) const {
+    uint64_t hash = _hasher(key);
+    epoch::guard g;
+
+    table *t = _table.load(std::memory_order_acquire);
+    node *n = t->buckets[hash & t->mask].load(std::memory_order_acquire);
+    while (n == _moved()) {
+        t = t->next.load(std::memory_order_acquire);
+        n = t->buckets[hash & t->mask].load(std::memory_order_acquire);
+    }
+
+    for (; n != nullptr; n = n->next.load(std::memory_order_acquire)) {
+        if (n->hash == hash && n->key == key) {
+            out = n->value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename K, typename V, typename H>
+V mstd::concurrent_hash_map<K, V, H>::get(const K &key) const {
+    V v;
+    if (!find(key, v)) {
+        throw std::runtime_error("Key does not exist");
+    }
+    return v;
+}
+
+template <typename K, typename V, typename H>
+bool mstd::concurrent_hash_map<K, V, H>::contains(const K &key) const {
+    V v;
+    return find(key, v);
+}
+
+template <typename K, typename V, typename H>
+bool mstd::concurrent_hash_map<K, V, H>::erase(const K &key) {
+    uint64_t hash = _hasher(key);
+    stripe &s = _stripe_of(_stripes, hash);
+    epoch::guard g;
+
+    _help_resize(_table.load());
+
+    pthread_mutex_lock(&s.mtx);
+    table *t = _locate(hash);
+    std::atomic<node *> *link = &t->buckets[hash & t->mask];
+    for (node *n = link->load(std::memory_order_relaxed); n != nullptr; n = n->next.load(std::memory_order_relaxed)) {
+        if (n->hash == hash && n->key == key) {
+            // Readers standing on n can still follow its (unchanged) next pointer
+            link->store(n->next.load(std::memory_order_relaxed), std::memory_order_release);
+            s.count--;
+            pthread_mutex_unlock(&s.mtx);
+            epoch::retire(n);
+            return true;
+        }
+        link = &n->next;
+    }
+
+    pthread_mutex_unlock(&s.mtx);
+    return false;
+}
+
+template <typename K, typename V, typename H>
+size_t mstd::concurrent_hash_map<K, V, H>::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < concurrent_hash_map_constants::num_stripes; i++) {
+        pthread_mutex_lock(&_stripes[i].mtx);
+        total += _stripes[i].count;
+        pthread_mutex_unlock(&_stripes[i].mtx);
+    }
+    return total;
+}
+
+template <typename K, typename V, typename H>
+size_t mstd::concurrent_hash_map<K, V, H>::bucket_count() const {
+    return _table.load()->size;
+}
+
+template <typename K, typename V, typename H>
+typename mstd::concurrent_hash_map<K, V, H>::node *mstd::concurrent_hash_map<K, V, H>::_moved() {
+    return reinterpret_cast<node *>(uintptr_t(1));
+}
+
+// Every table has at least num_stripes buckets, so a bucket's stripe only depends on the low bits
+// of the hash. A bucket and the two buckets it splits into are always covered by the same stripe
+template <typename K, typename V, typename H>
+typename mstd::concurrent_hash_map<K, V, H>::stripe &mstd::concurrent_hash_map<K, V, H>::_stripe_of(stripe *stripes, uint64_t hash) {
+    return stripes[hash & (concurrent_hash_map_constants::num_stripes - 1)];
+}
+
+template <typename K, typename V, typename H>
+typename mstd::concurrent_hash_map<K, V, H>::table *mstd::concurrent_hash_map<K, V, H>::_locate(uint64_t hash) const {
+    table *t = _table.load(std::memory_order_acquire);
+    while (t->buckets[hash & t->mask].load(std::memory_order_relaxed) == _moved()) {
+        t = t->next.load(std::memory_order_acquire);
+    }
+    return t;
+}
+
+template <typename K, typename V, typename H>
+void mstd::concurrent_hash_map<K, V, H>::_help_resize(table *t) {
+    table *next = t->next.load(std::memory_order_acquire);
+    if (next == nullptr) return;
+
+    size_t start = t->migrate_cursor.fetch_add(concurrent_hash_map_constants::migration_chunk);
+    if (start >= t->size) return;
+
+    size_t end = start + concurrent_hash_map_constants::migration_chunk;
+    if (end > t->size) end = t->size;
+
+    for (size_t i = start; i < end; i++) {
+        stripe &s = _stripe_of(_stripes, i);
+        pthread_mutex_lock(&s.mtx);
+        _migrate_bucket(t, i);
+        pthread_mutex_unlock(&s.mtx);
+    }
+
+    // The thread that migrates the last chunk retires the old table
+    if (t->migrated.fetch_add(end - start) + (end - start) == t->size) {
+        _table.store(next, std::memory_order_release);
+        epoch::retire(t);
+    }
+}
+
+template <typename K, typename V, typename H>
+void mstd::concurrent_hash_map<K, V, H>::_start_resize(table *t) {
+    pthread_mutex_lock(&_resize_mtx);
+    if (_table.load() == t && t->next.load() == nullptr) {
+        t->next.store(new table(t->size * 2), std::memory_order_release);
+    }
+    pthread_mutex_unlock(&_resize_mtx);
+
+    _help_resize(t);
+}
+
+// The bucket's nodes are copied, not relinked: readers may still be walking the old chain
+template <typename K, typename V, typename H>
+void mstd::concurrent_hash_map<K, V, H>::_migrate_bucket(table *t, size_t index) {
+    table *next = t->next.load(std::memory_order_relaxed);
+    node *head = t->buckets[index].load(std::memory_order_relaxed);
+
+    for (node *n = head; n != nullptr; n = n->next.load(std::memory_order_relaxed)) {
+        std::atomic<node *> &bucket = next->buckets[n->hash & next->mask];
+        bucket.store(new node(n->key, n->value, n->hash, bucket.load(std::memory_order_relaxed)),
+                     std::memory_order_relaxed);
+    }
+
+    // Publishes the new chains along with the marker
+    t->buckets[index].store(_moved(), std::memory_order_release);
+
+    for (node *n = head; n != nullptr; ) {
+        node *next_node = n->next.load(std::memory_order_relaxed);
+        epoch::retire(n);
+        n = next_node;
+    }
+}
+
+template <typename K, typename V, typename H>
+void mstd::concurrent_hash_map<K, V, H>::_delete_chain(node *n) {
+    while (n != nullptr) {
+        node *next = n->next.load(std::memory_order_relaxed);
+        delete n;
+        n = next;
+    }
+}
+
+#endif // CONCURRENT_HASH_MAP_HPP
@@ -0,0 +1,420 @@
+#ifndef FLAT_HASH_MAP_HPP
+#define FLAT_HASH_MAP_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include "hash_functions.hpp"
+#include "memory_resource.hpp"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace flat_hash_map_constants {
+    // Number of control bytes matched at once (one SSE2 register)
+    const size_t group_width = 16;
+    const size_t min_capacity = 16;
+    // Maximum load is max_load_num / max_load_den
+    const size_t max_load_num = 7;
+    const size_t max_load_den = 8;
+
+    // Control byte values. Full slots hold the low 7 bits of their hash (0..127)
+    const int8_t ctrl_empty = -128;
+    const int8_t ctrl_deleted = -2;
+}
+
+namespace mstd {
+    // Open addressing hash map, in the style of Google's Swiss tables.
+    // Keys and values are stored inline in a single slot array. A parallel array of one control byte
+    // per slot holds 7 bits of each key's hash, so a lookup tests a whole group of 16 slots with a
+    // single SSE2 comparison and (almost always) only touches the slot of the key it's looking for.
+    // Capacity is always a power of 2. Erased slots become tombstones unless no probe sequence can go through them.
+    // Pointers to values are invalidated by insertions that grow the table.
+    // The control bytes and the slots come from a memory_resource
+    template <typename K, typename V, typename H = mstd::hasher<K>>
+    class flat_hash_map {
+    public:
+        explicit flat_hash_map(size_t initial_capacity = flat_hash_map_constants::min_capacity,
+                               memory_resource *resource = default_resource());
+        flat_hash_map(const flat_hash_map &)=delete;
+        flat_hash_map(flat_hash_map &&other) noexcept;
+
+        ~flat_hash_map();
+
+        // Returns false (and leaves the existing value untouched) if the key already exists
+        bool insert(const K &key, const V &value);
+
+        // Inserts a default constructed value if the key doesn't exist
+        V &operator[](const K &key);
+
+        V &get(const K &key) const;
+
+        // Returns nullptr if the key doesn't exist
+        V *find(const K &key) const;
+
+        bool contains(const K &key) const;
+
+        // Returns false if the key didn't exist
+        bool erase(const K &key);
+
+        // Makes room for n items without any further rehashing
+        void reserve(size_t n);
+
+        void clear();
+
+        size_t size() const;
+
+        size_t capacity() const;
+
+        bool empty() const;
+
+        flat_hash_map &operator=(const flat_hash_map &)=delete;
+    private:
+        struct slot {
+            K key;
+            V value;
+
+            slot(const K &k, const V &v) : key(k), value(v) { }
+        };
+
+        int8_t *_ctrl;
+        slot *_slots;
+        size_t _capacity;
+        size_t _mask;
+        size_t _size;
+        // Number of empty slots that may still be filled before we have to rehash
+        size_t _growth_left;
+        H _hasher;
+        memory_resource *_resource;
+
+        // Bit i is set if the i-th control byte of the group starting at pos matches
+        static uint32_t _match(const int8_t *pos, int8_t h2);
+        static uint32_t _match_empty(const int8_t *pos);
+        static uint32_t _match_empty_or_deleted(const int8_t *pos);
+
+        static size_t _h1(uint64_t hash);
+        static int8_t _h2(uint64_t hash);
+
+        // Returns the slot index of the key, or _capacity if it doesn't exist
+        size_t _find_index(const K &key, uint64_t hash) const;
+
+        // Index of the first empty or deleted slot in the key's probe sequence
+        size_t _find_free(uint64_t hash) const;
+
+        void _set_ctrl(size_t index, int8_t h);
+
+        // Places a key that's known not to exist. May rehash
+        size_t _insert_new(const K &key, const V &value, uint64_t hash);
+
+        void _allocate(size_t capacity);
+
+        void _deallocate(int8_t *ctrl, slot *slots, size_t capacity);
+
+        void _rehash(size_t new_capacity);
+
+        void _destroy_slots();
+
+        static size_t _max_load(size_t capacity);
+    };
+}
+
+template <typename K, typename V, typename H>
+mstd::flat_hash_map<K, V, H>::flat_hash_map(size_t initial_capacity, memory_resource *resource)
+        : _size(0), _resource(resource) {
+    size_t capacity = flat_hash_map_constants::min_capacity;
+    while (capacity < initial_capacity) {
+        capacity <<= 1;
+    }
+    _allocate(capacity);
+}
+
+template <typename K, typename V, typename H>
+mstd::flat_hash_map<K, V, H>::flat_hash_map(flat_hash_map &&other) noexcept
+        : _ctrl(other._ctrl), _slots(other._slots), _capacity(other._capacity), _mask(other._mask),
+          _size(other._size), _growth_left(other._growth_left), _hasher(other._hasher),
+          _resource(other._resource) {
+    // Leave other in a (tiny) valid state
+    other._size = 0;
+    other._allocate(flat_hash_map_constants::min_capacity);
+}
+
+template <typename K, typename V, typename H>
+mstd::flat_hash_map<K, V, H>::~flat_hash_map() {
+    _destroy_slots();
+    _deallocate(_ctrl, _slots, _capacity);
+}
+
+template <typename K, typename V, typename H>
+bool mstd::flat_hash_map<K, V, H>::insert(const K &key, const V &value) {
+    uint64_t hash = _hasher(key);
+    if (_find_index(key, hash) != _capacity) {
+        return false;
+    }
+
+    _insert_new(key, value, hash);
+    return true;
+}
+
+template <typename K, typename V, typename H>
+V &mstd::flat_hash_map<K, V, H>::operator[](const K &key) {
+    uint64_t hash = _hasher(key);
+    size_t index = _find_index(key, hash);
+    if (index == _capacity) {
+        index = _insert_new(key, V(), hash);
+    }
+
+    return _slots[index].value;
+}
+
+template <typename K, typename V, typename H>
+V &mstd::flat_hash_map<K, V, H>::get(const K &key) const {
+    V *v = find(key);
+    if (v == nullptr) {
+        throw std::runtime_error("Key does not exist");
+    }
+
+    return *v;
+}
+
+template <typename K, typename V, typename H>
+V *mstd::flat_hash_map<K, V, H>::find(const K &key) const {
+    size_t index = _find_index(key, _hasher(key));
+    return index == _capacity ? nullptr : &_slots[index].value;
+}
+
+template <typename K, typename V, typename H>
+bool mstd::flat_hash_map<K, V, H>::contains(const K &key) const {
+    return find(key) != nullptr;
+}
+
+template <typename K, typename V, typename H>
+bool mstd::flat_hash_map<K, V, H>::erase(const K &key) {
+    using flat_hash_map_constants::group_width;
+
+    size_t index = _find_index(key, _hasher(key));
+    if (index == _capacity) {
+        return false;
+    }
+
+    _slots[index].~slot();
+    _size--;
+
+    // If the run of full slots around index is shorter than a group, no probe sequence ever
+    // went past this slot (it would have stopped at the empty slot), so it can simply become empty again
+    size_t index_before = (index - group_width) & _mask;
+    uint32_t empty_before = _match_empty(_ctrl + index_before);
+    uint32_t empty_after = _match_empty(_ctrl + index);
+    bool was_never_full = empty_before && empty_after
+                          && (size_t) (__builtin_ctz(empty_after) + __builtin_clz(empty_before << 16)) < group_width;
+
+    if (was_never_full) {
+        _set_ctrl(index, flat_hash_map_constants::ctrl_empty);
+        _growth_left++;
+    } else {
+        _set_ctrl(index, flat_hash_map_constants::ctrl_deleted);
+    }
+
+    return true;
+}
+
+template <typename K, typename V, typename H>
+void mstd::flat_hash_map<K, V, H>::reserve(size_t n) {
+    size_t capacity = _capacity;
+    while (_max_load(capacity) < n) {
+        capacity <<= 1;
+    }
+
+    if (capacity != _capacity) {
+        _rehash(capacity);
+    }
+}
+
+template <typename K, typename V, typename H>
+void mstd::flat_hash_map<K, V, H>::clear() {
+    _destroy_slots();
+    memset(_ctrl, flat_hash_map_constants::ctrl_empty, _capacity + flat_hash_map_constants::group_width);
+    _size = 0;
+    _growth_left = _max_load(_capacity);
+}
+
+template <typename K, typename V, typename H>
+size_t mstd::flat_hash_map<K, V, H>::size() const {
+    return _size;
+}
+
+template <typename K, typename V, typename H>
+size_t mstd::flat_hash_map<K, V, H>::capacity() const {
+    return _capacity;
+}
+
+template <typename K, typename V, typename H>
+bool mstd::flat_hash_map<K, V, H>::empty() const {
+    return _size == 0;
+}
+
+template <typename K, typename V, typename H>
+uint32_t mstd::flat_hash_map<K, V, H>::_match(const int8_t *pos, int8_t h2) {
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128((const __m128i *) pos);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < flat_hash_map_constants::group_width; i++) {
+        mask |= (uint32_t) (pos[i] == h2) << i;
+    }
+    return mask;
+#endif
+}
+
+template <typename K, typename V, typename H>
+uint32_t mstd::flat_hash_map<K, V, H>::_match_empty(const int8_t *pos) {
+    return _match(pos, flat_hash_map_constants::ctrl_empty);
+}
+
+// Empty and deleted are the only negative control bytes, so their sign bits are enough
+template <typename K, typename V, typename H>
+uint32_t mstd::flat_hash_map<K, V, H>::_match_empty_or_deleted(const int8_t *pos) {
+#if defined(__SSE2__)
+    return (uint32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) pos));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < flat_hash_map_constants::group_width; i++) {
+        mask |= (uint32_t) (pos[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+template <typename K, typename V, typename H>
+size_t mstd::flat_hash_map<K, V, H>::_h1(uint64_t hash) {
+    return (size_t) (hash >> 7);
+}
+
+template <typename K, typename V, typename H>
+int8_t mstd::flat_hash_map<K, V, H>::_h2(uint64_t hash) {
+    return (int8_t) (hash & 0x7f);
+}
+
+// Probes group by group (quadratic over groups) until a group with an empty slot is found
+template <typename K, typename V, typename H>
+size_t mstd::flat_hash_map<K, V, H>::_find_index(const K &key, uint64_t hash) const {
+    using flat_hash_map_constants::group_width;
+
+    int8_t h2 = _h2(hash);
+    size_t pos = _h1(hash) & _mask;
+    for (size_t step = group_width; ; step += group_width) {
+        for (uint32_t m = _match(_ctrl + pos, h2); m != 0; m &= m - 1) {
+            size_t index = (pos + __builtin_ctz(m)) & _mask;
+            if (_slots[index].key == key) {
+                return index;
+            }
+        }
+
+        if (_match_empty(_ctrl + pos)) {
+            return _capacity;
+        }
+
+        pos = (pos + step) & _mask;
+    }
+}
+
+template <typename K, typename V, typename H>
+size_t mstd::flat_hash_map<K, V, H>::_find_free(uint64_t hash) const {
+    using flat_hash_map_constants::group_width;
+
+    size_t pos = _h1(hash) & _mask;
+    for (size_t step = group_width; ; step += group_width) {
+        uint32_t m = _match_empty_or_deleted(_ctrl + pos);
+        if (m) {
+            return (pos + __builtin_ctz(m)) & _mask;
+        }
+
+        pos = (pos + step) & _mask;
+    }
+}
+
+// The first group_width control bytes are mirrored after the end of the array,
+// so that groups starting near the end can be loaded without wrapping around
+template <typename K, typename V, typename H>
+void mstd::flat_hash_map<K, V, H>::_set_ctrl(size_t index, int8_t h) {
+    _ctrl[index] = h;
+    if (index < flat_hash_map_constants::group_width) {
+        _ctrl[_capacity + index] = h;
+    }
+}
+
+template <typename K, typename V, typename H>
+size_t mstd::flat_hash_map<K, V, H>::_insert_new(const K &key, const V &value, uint64_t hash) {
+    size_t index = _find_free(hash);
+    if (_growth_left == 0 && _ctrl[index] == flat_hash_map_constants::ctrl_empty) {
+        // If tombstones take up most of the load, rehashing at the same capacity is enough
+        _rehash(_size * 2 > _max_load(_capacity) ? _capacity << 1 : _capacity);
+        index = _find_free(hash);
+    }
+
+    if (_ctrl[index] == flat_hash_map_constants::ctrl_empty) {
+        _growth_left--;
+    }
+    new (&_slots[index]) slot(key, value);
+    _set_ctrl(index, _h2(hash));
+    _size++;
+
+    return index;
+}
+
+template <typename K, typename V, typename H>
+void mstd::flat_hash_map<K, V, H>::_allocate(size_t capacity) {
+    _capacity = capacity;
+    _mask = capacity - 1;
+    _ctrl = static_cast<int8_t *>(_resource->allocate(capacity + flat_hash_map_constants::group_width));
+    memset(_ctrl, flat_hash_map_constants::ctrl_empty, capacity + flat_hash_map_constants::group_width);
+    // Slots are constructed in place on insertion
+    _slots = static_cast<slot *>(_resource->allocate(capacity * sizeof(slot), alignof(slot)));
+    _growth_left = _max_load(capacity);
+}
+
+template <typename K, typename V, typename H>
+void mstd::flat_hash_map<K, V, H>::_deallocate(int8_t *ctrl, slot *slots, size_t capacity) {
+    _resource->deallocate(ctrl, capacity + flat_hash_map_constants::group_width);
+    _resource->deallocate(slots, capacity * sizeof(slot), alignof(slot));
+}
+
+template <typename K, typename V, typename H>
+void mstd::flat_hash_map<K, V, H>::_rehash(size_t new_capacity) {
+    int8_t *old_ctrl = _ctrl;
+    slot *old_slots = _slots;
+    size_t old_capacity = _capacity;
+
+    _allocate(new_capacity);
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_ctrl[i] >= 0) {
+            slot &s = old_slots[i];
+            uint64_t hash = _hasher(s.key);
+            size_t index = _find_free(hash);
+            new (&_slots[index]) slot(std::move(s));
+            _set_ctrl(index, _h2(hash));
+            s.~slot();
+        }
+    }
+    _growth_left -= _size;
+
+    _deallocate(old_ctrl, old_slots, old_capacity);
+}
+
+template <typename K, typename V, typename H>
+void mstd::flat_hash_map<K, V, H>::_destroy_slots() {
+    for (size_t i = 0; i < _capacity; i++) {
+        if (_ctrl[i] >= 0) {
+            _slots[i].~slot();
+        }
+    }
+}
+
+template <typename K, typename V, typename H>
+size_t mstd::flat_hash_map<K, V, H>::_max_load(size_t capacity) {
+    return capacity / flat_hash_map_constants::max_load_den * flat_hash_map_constants::max_load_num;
+}
+
+#endif // FLAT_HASH_MAP_HPP
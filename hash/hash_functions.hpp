@@ -0,0 +1,314 @@
+#ifndef HASH_FUNCTIONS_HPP
+#define HASH_FUNCTIONS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "string_view.hpp"
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Hash functions shared by all of the library's containers and filters.
+// Every function reads its input in place (no copies, no allocations) and takes a seed.
+namespace mstd {
+
+    namespace hash_constants {
+        // wyhash's default secret
+        const uint64_t secret[4] = {0x2d358dccaa6c78a5LLU, 0x8bb84b93962eacc9LLU,
+                                    0x4b33a62ed433d4a3LLU, 0x4d5a2da51de1aa47LLU};
+        const uint64_t seed_mix = 0x9e3779b97f4a7c15LLU;
+    }
+
+    namespace detail {
+        inline uint64_t rotl64(uint64_t x, uint64_t r) {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        // Unaligned little-endian reads
+        inline uint64_t read64(const uint8_t *p) {
+            uint64_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline uint64_t read32(const uint8_t *p) {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        // 1 to 3 bytes
+        inline uint64_t read_small(const uint8_t *p, size_t len) {
+            return (((uint64_t) p[0]) << 16) | (((uint64_t) p[len >> 1]) << 8) | p[len - 1];
+        }
+
+        // 64x64 -> 128 bit multiplication. a and b receive the low and the high half
+        inline void mum(uint64_t &a, uint64_t &b) {
+            __uint128_t r = (__uint128_t) a * b;
+            a = (uint64_t) r;
+            b = (uint64_t) (r >> 64);
+        }
+
+        inline uint64_t mix(uint64_t a, uint64_t b) {
+            mum(a, b);
+            return a ^ b;
+        }
+    }
+
+    // murmur3's 64-bit finaliser. A bijection, so it's also a decent integer hash on its own
+    inline uint64_t murmur3_fmix64(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdLLU;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53LLU;
+        k ^= k >> 33;
+
+        return k;
+    }
+
+    // MurmurHash3 (x64, 128-bit variant). out must have room for two 64-bit words
+    inline void murmur3_128(const void *key, size_t len, uint64_t seed, uint64_t out[2]) {
+        using detail::rotl64;
+        auto *data = (const uint8_t *) key;
+        const size_t nblocks = len / 16;
+
+        uint64_t h1 = seed;
+        uint64_t h2 = seed;
+
+        const uint64_t c1 = 0x87c37b91114253d5LLU;
+        const uint64_t c2 = 0x4cf5ad432745937fLLU;
+
+        for (size_t i = 0; i < nblocks; i++) {
+            uint64_t k1 = detail::read64(data + i * 16);
+            uint64_t k2 = detail::read64(data + i * 16 + 8);
+
+            k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+
+            h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+            k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+
+            h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+        }
+
+        auto *tail = (data + nblocks * 16);
+
+        uint64_t k1 = 0;
+        uint64_t k2 = 0;
+
+        switch (len & 15) {
+            case 15: k2 ^= ((uint64_t)tail[14]) << 48; // fall through
+            case 14: k2 ^= ((uint64_t)tail[13]) << 40; // fall through
+            case 13: k2 ^= ((uint64_t)tail[12]) << 32; // fall through
+            case 12: k2 ^= ((uint64_t)tail[11]) << 24; // fall through
+            case 11: k2 ^= ((uint64_t)tail[10]) << 16; // fall through
+            case 10: k2 ^= ((uint64_t)tail[ 9]) << 8; // fall through
+            case  9: k2 ^= ((uint64_t)tail[ 8]) << 0;
+                k2 *= c2; k2  = rotl64(k2,33); k2 *= c1; h2 ^= k2; // fall through
+
+            case  8: k1 ^= ((uint64_t)tail[ 7]) << 56; // fall through
+            case  7: k1 ^= ((uint64_t)tail[ 6]) << 48; // fall through
+            case  6: k1 ^= ((uint64_t)tail[ 5]) << 40; // fall through
+            case  5: k1 ^= ((uint64_t)tail[ 4]) << 32; // fall through
+            case  4: k1 ^= ((uint64_t)tail[ 3]) << 24; // fall through
+            case  3: k1 ^= ((uint64_t)tail[ 2]) << 16; // fall through
+            case  2: k1 ^= ((uint64_t)tail[ 1]) << 8; // fall through
+            case  1: k1 ^= ((uint64_t)tail[ 0]) << 0;
+                k1 *= c1; k1 = rotl64(k1,31); k1 *= c2; h1 ^= k1;
+        }
+
+        h1 ^= len; h2 ^= len;
+        h1 += h2;
+        h2 += h1;
+
+        h1 = murmur3_fmix64(h1);
+        h2 = murmur3_fmix64(h2);
+
+        h1 += h2;
+        h2 += h1;
+
+        out[0] = h1;
+        out[1] = h2;
+    }
+
+    inline uint64_t murmur3_64(const void *key, size_t len, uint64_t seed = 0) {
+        uint64_t out[2];
+        murmur3_128(key, len, seed, out);
+        return out[0];
+    }
+
+    namespace detail {
+        // Multiply-fold hash in the xxh3 / wyhash family (this is wyhash's core loop).
+        // Leaves the last multiplication's halves in a and b, to be folded by fast_hash64/128
+        inline void fast_hash_core(const void *key, size_t len, uint64_t seed, uint64_t &a, uint64_t &b) {
+            using hash_constants::secret;
+            auto *p = (const uint8_t *) key;
+            seed ^= mix(seed ^ secret[0], secret[1]);
+
+            if (len <= 16) {
+                if (len >= 4) {
+                    a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+                    b = (read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+                } else if (len > 0) {
+                    a = read_small(p, len);
+                    b = 0;
+                } else {
+                    a = b = 0;
+                }
+            } else {
+                size_t i = len;
+                if (i > 48) {
+                    uint64_t see1 = seed, see2 = seed;
+                    do {
+                        seed = mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+                        see1 = mix(read64(p + 16) ^ secret[2], read64(p + 24) ^ see1);
+                        see2 = mix(read64(p + 32) ^ secret[3], read64(p + 40) ^ see2);
+                        p += 48;
+                        i -= 48;
+                    } while (i > 48);
+                    seed ^= see1 ^ see2;
+                }
+                while (i > 16) {
+                    seed = mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+                    i -= 16;
+                    p += 16;
+                }
+                a = read64(p + i - 16);
+                b = read64(p + i - 8);
+            }
+
+            a ^= secret[1];
+            b ^= seed;
+            mum(a, b);
+        }
+    }
+
+    // Cheaper than murmur3 on short keys: three 64x64 -> 128 bit multiplications up to 16 bytes
+    inline uint64_t fast_hash64(const void *key, size_t len, uint64_t seed = 0) {
+        uint64_t a, b;
+        detail::fast_hash_core(key, len, seed, a, b);
+        return detail::mix(a ^ hash_constants::secret[0] ^ len, b ^ hash_constants::secret[1]);
+    }
+
+    // out must have room for two 64-bit words. out[0] is equal to fast_hash64
+    inline void fast_hash128(const void *key, size_t len, uint64_t seed, uint64_t out[2]) {
+        uint64_t a, b;
+        detail::fast_hash_core(key, len, seed, a, b);
+        out[0] = detail::mix(a ^ hash_constants::secret[0] ^ len, b ^ hash_constants::secret[1]);
+        out[1] = detail::mix(a ^ hash_constants::secret[2], b ^ hash_constants::secret[3] ^ len);
+    }
+
+    // Hash of a single integer key
+    inline uint64_t hash_u64(uint64_t key, uint64_t seed = 0) {
+        return murmur3_fmix64(key ^ (seed + hash_constants::seed_mix));
+    }
+
+    namespace detail {
+#if defined(__AVX2__)
+        // 64-bit lane-wise multiplication by a constant, from three 32x32 -> 64 bit multiplications
+        inline __m256i mul64_lanes(__m256i a, uint64_t c) {
+            const __m256i c_lo = _mm256_set1_epi64x((long long) (c & 0xffffffff));
+            const __m256i c_hi = _mm256_set1_epi64x((long long) (c >> 32));
+            __m256i lo = _mm256_mul_epu32(a, c_lo);
+            __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), c_lo),
+                                             _mm256_mul_epu32(a, c_hi));
+            return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+        }
+
+        inline __m256i fmix64_lanes(__m256i k) {
+            k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+            k = mul64_lanes(k, 0xff51afd7ed558ccdLLU);
+            k = _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+            k = mul64_lanes(k, 0xc4ceb9fe1a85ec53LLU);
+            return _mm256_xor_si256(k, _mm256_srli_epi64(k, 33));
+        }
+#elif defined(__SSE2__)
+        inline __m128i mul64_lanes(__m128i a, uint64_t c) {
+            const __m128i c_lo = _mm_set1_epi64x((long long) (c & 0xffffffff));
+            const __m128i c_hi = _mm_set1_epi64x((long long) (c >> 32));
+            __m128i lo = _mm_mul_epu32(a, c_lo);
+            __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), c_lo),
+                                          _mm_mul_epu32(a, c_hi));
+            return _mm_add_epi64(lo, _mm_slli_epi64(cross, 32));
+        }
+
+        inline __m128i fmix64_lanes(__m128i k) {
+            k = _mm_xor_si128(k, _mm_srli_epi64(k, 33));
+            k = mul64_lanes(k, 0xff51afd7ed558ccdLLU);
+            k = _mm_xor_si128(k, _mm_srli_epi64(k, 33));
+            k = mul64_lanes(k, 0xc4ceb9fe1a85ec53LLU);
+            return _mm_xor_si128(k, _mm_srli_epi64(k, 33));
+        }
+#endif
+    }
+
+    // Batch versions. out[i] is always equal to the single-key hash of keys[i]
+
+    // Integer keys are hashed 4 (AVX2) or 2 (SSE2) at a time in vector lanes
+    inline void hash_batch(const uint64_t *keys, size_t n, uint64_t *out, uint64_t seed = 0) {
+        size_t i = 0;
+        const uint64_t s = seed + hash_constants::seed_mix;
+#if defined(__AVX2__)
+        const __m256i vs = _mm256_set1_epi64x((long long) s);
+        for (; i + 4 <= n; i += 4) {
+            __m256i k = _mm256_loadu_si256((const __m256i *) (keys + i));
+            _mm256_storeu_si256((__m256i *) (out + i), detail::fmix64_lanes(_mm256_xor_si256(k, vs)));
+        }
+#elif defined(__SSE2__)
+        const __m128i vs = _mm_set1_epi64x((long long) s);
+        for (; i + 2 <= n; i += 2) {
+            __m128i k = _mm_loadu_si128((const __m128i *) (keys + i));
+            _mm_storeu_si128((__m128i *) (out + i), detail::fmix64_lanes(_mm_xor_si128(k, vs)));
+        }
+#endif
+        for (; i < n; i++) {
+            out[i] = murmur3_fmix64(keys[i] ^ s);
+        }
+    }
+
+    // Variable length keys can't share vector registers without gathers, so they're hashed one by one.
+    // Their multiplication chains are independent, so consecutive keys still overlap in the pipeline
+    inline void hash_batch(const std::string *keys, size_t n, uint64_t *out, uint64_t seed = 0) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = fast_hash64(keys[i].data(), keys[i].length(), seed);
+        }
+    }
+
+    // Default hash policy of the library's containers.
+    // Types that aren't integers or strings must provide a hash() member; its result is re-mixed,
+    // so it doesn't need to be well distributed.
+    // A custom policy is any copyable type whose operator() maps a key to a well distributed uint64_t
+    template <typename T, typename Enable = void>
+    struct hasher {
+        uint64_t operator()(const T &key, uint64_t seed = 0) const {
+            return hash_u64((uint64_t) key.hash(), seed);
+        }
+    };
+
+    template <typename T>
+    struct hasher<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type> {
+        uint64_t operator()(T key, uint64_t seed = 0) const {
+            return hash_u64((uint64_t) key, seed);
+        }
+    };
+
+    template <>
+    struct hasher<std::string> {
+        uint64_t operator()(const std::string &key, uint64_t seed = 0) const {
+            return fast_hash64(key.data(), key.length(), seed);
+        }
+
+        uint64_t operator()(const char *key, uint64_t seed = 0) const {
+            return fast_hash64(key, strlen(key), seed);
+        }
+
+        uint64_t operator()(string_view key, uint64_t seed = 0) const {
+            return fast_hash64(key.data(), key.length(), seed);
+        }
+    };
+}
+
+#endif // HASH_FUNCTIONS_HPP
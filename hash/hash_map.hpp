@@ -2,69 +2,204 @@
 #define HASH_MAP_HPP
 
 #include <string>
+#include <algorithm>
+#include <new>
 #include "mvector.hpp"
+#include "small_vector.hpp"
 #include "mstack.hpp"
+#include "slab_allocator.hpp"
+#include "hash_functions.hpp"
+#include "hash_stats.hpp"
+#include "thread_pool.hpp"
 
 namespace hashmap_constants {
     const int max_bucket_size = 4;
     const int initial_size = 8;
     const int load_factor = 85;
+    // Below this load, erase merges the last bucket back into its split origin
+    const int merge_load_factor = 40;
+    // The bucket directory is made of fixed-size segments of 2^segment_bits bucket pointers
+    const size_t segment_bits = 8;
+    const size_t segment_size = 1 << segment_bits;
+    // Below this many items build() doesn't bother spreading the work over a thread pool
+    const size_t parallel_threshold = 1 << 16;
+    // Number of input chunks and of bucket ranges build() splits its work into
+    const size_t parallel_chunks = 32;
 }
 
 template <typename T, typename V>
 class entry {
 public:
     entry();
-    entry(T &&key, V &&value);
+    // Constructs the key from key and the value from args
+    template <typename KArg, typename... Args>
+    entry(uint64_t hash, KArg &&key, Args &&... args);
     entry(const entry &other);
+    entry(entry &&other)=default;
 
     ~entry()=default;
 
     entry &operator=(const entry &other); 
+    entry &operator=(entry &&other)=default;
 
     bool operator==(const entry &other); 
 
     bool operator==(const T &key); 
 
+    // Compares the (cached) hashes first, and only compares keys if they match
+    template <typename K>
+    bool matches(const K &key, uint64_t hash) const;
+
     const T &get_key();
 
     V &get_value();
+
+    uint64_t get_hash() const;
 private:
     T _key;
     V _value;
+    uint64_t _hash;
 };
 
+// Buckets hold up to max_bucket_size entries inline, so a bucket that never overflows is a single allocation
 template <typename T, typename V>
+using hash_bucket = mstd::small_vector<entry<T, V>, hashmap_constants::max_bucket_size>;
+
+// H is the hash policy (see mstd::hasher): any copyable type whose operator() maps a key to a uint64_t
+template <typename T, typename V, typename H = mstd::hasher<T>>
 class hash_map {
 public:
-    explicit hash_map(size_t initial_size = hashmap_constants::initial_size);
+    // The directory, the buckets and the buckets' overflow storage come from resource.
+    // The default, the slab allocator, serves buckets from thread-local free lists
+    explicit hash_map(size_t initial_size = hashmap_constants::initial_size, const H &hasher = H(),
+                      mstd::memory_resource *resource = mstd::slab_resource());
+    // Copies every bucket. The copy allocates from the same resource as other
     hash_map(const hash_map &other);
+    // Takes other's table over, and leaves other empty (at its initial size)
     hash_map(hash_map &&other);
 
     ~hash_map();
 
+    // Throws if the key already exists
     void insert(T ent, V value);
 
-    // If we're searching for plain trie nodes, we use bsearch_children
-    V &get(const T &key) const;
+    // Constructs the value in place from args. If the key already exists, nothing happens
+    // (and args are left untouched). Returns true if the value was inserted
+    template <typename... Args>
+    bool try_emplace(const T &key, Args &&... args);
+
+    template <typename... Args>
+    bool try_emplace(T &&key, Args &&... args);
+
+    // Constructs the key from key_arg and the value from args. Returns true if the value was inserted
+    template <typename KArg, typename... Args>
+    bool emplace(KArg &&key_arg, Args &&... args);
+
+    // Returns true if the key was inserted, false if an existing value was assigned
+    template <typename M>
+    bool insert_or_assign(const T &key, M &&value);
+
+    template <typename M>
+    bool insert_or_assign(T &&key, M &&value);
+
+    // Presizes the table so that n items fit without a single split
+    void reserve(size_t n);
+
+    // Inserts every (first, second) pair of the random access range [first, last). Keys that already
+    // exist are skipped, so the first occurrence wins. With a pool, large inputs are hashed and
+    // partitioned by bucket range across its workers. If the map's resource is_thread_safe(), the
+    // workers then fill disjoint buckets in parallel; otherwise (arena_resource, pool_resource) the
+    // calling thread does every allocation. Returns the number of inserted items
+    template <typename It>
+    size_t build(It first, It last, thread_pool *pool = nullptr);
+
+    // key can be of any type that H can hash (to the same value as the equivalent T) and that compares
+    // equal to T, so that e.g. a hash_map<std::string, V> can be searched by string_view or const char *
+    template <typename K>
+    V &get(const K &key) const;
 
-    void delete_word(const T &key);
+    // Returns nullptr if the key doesn't exist
+    template <typename K>
+    V *find(const K &key) const;
+
+    template <typename K>
+    bool contains(const K &key) const;
+
+    // Returns false if the key didn't exist. Shrinks the table (one bucket merge at a time)
+    // when its load drops under merge_load_factor
+    template <typename K>
+    bool erase(const K &key);
 
     size_t get_num_items() const;
 
     size_t size() const;
 
     bool empty() const;
+
+    // Walks every bucket: bucket sizes, chain positions and memory use
+    mstd::hash_stats stats() const;
+
+    hash_map &operator=(const hash_map &)=delete;
 private:
     // We do not keep a <current size> variable, since we can always calculate it as the
     // size of the table at the start of each run + p (the next bucket to be split)
     size_t _size;
     size_t _num_items;
     size_t _p;
+    // The table never merges below its initial size
+    size_t _initial_size;
+    size_t _num_splits;
+    size_t _num_merges;
+    H _hasher;
+    mstd::memory_resource *_resource;
+
+    // Segmented directory: a split only ever adds one bucket (and at most one segment),
+    // so existing bucket pointers never have to be copied
+    hash_bucket<T, V> ***_segments;
+    size_t _num_segments;
+    size_t _segments_capacity;
+
+    hash_bucket<T, V> *&_bucket(size_t index) const;
+
+    // Allocates an empty table of _initial_size buckets
+    void _init_table();
+
+    // Allocates bucket #index, which has to be the one right after the current last bucket
+    void _add_bucket(size_t index);
+
+    hash_bucket<T, V> *_new_bucket();
 
-    mstd::vector<entry<T, V>> **_entries;
+    void _delete_bucket(hash_bucket<T, V> *bucket);
 
-    void _resize();
+    // Arrays of (trivial) directory pointers
+    template <typename P>
+    P *_new_array(size_t n);
+
+    template <typename P>
+    void _delete_array(P *array, size_t n);
+
+    // Frees bucket #index, which has to be the last one
+    void _remove_last_bucket(size_t index);
+
+    size_t _index(uint64_t hash) const;
+
+    template <typename K>
+    entry<T, V> *_find(const K &key, uint64_t hash) const;
+
+    template <typename KArg, typename... Args>
+    bool _try_emplace(KArg &&key, Args &&... args);
+
+    template <typename KArg, typename M>
+    bool _insert_or_assign(KArg &&key, M &&value);
+
+    // Which of build()'s bucket ranges the hash falls into, for a table of num_buckets buckets
+    size_t _partition(uint64_t hash, size_t num_buckets) const;
+
+    // Splits bucket _p into _p and _size + _p
+    void _split();
+
+    // Merges the last bucket back into the one it was split from
+    void _merge();
 
     int _calculate_load() const;
 
@@ -74,10 +209,13 @@ template <typename T, typename V>
 entry<T, V>::entry() { }
 
 template <typename T, typename V>
-entry<T, V>::entry(T &&key, V &&value) : _key(key), _value(value) { }
+template <typename KArg, typename... Args>
+entry<T, V>::entry(uint64_t hash, KArg &&key, Args &&... args) : _key(std::forward<KArg>(key)),
+                                                                _value(std::forward<Args>(args)...),
+                                                                _hash(hash) { }
 
 template <typename T, typename V>
-entry<T, V>::entry(const entry<T, V> &other) : _key(other._key), _value(other._value) { }
+entry<T, V>::entry(const entry<T, V> &other) : _key(other._key), _value(other._value), _hash(other._hash) { }
 
 template <typename T, typename V>
 const T &entry<T, V>::get_key() {
@@ -89,16 +227,22 @@ V &entry<T, V>::get_value() {
     return _value;
 }
 
+template <typename T, typename V>
+uint64_t entry<T, V>::get_hash() const {
+    return _hash;
+}
+
 template <typename T, typename V>
 entry<T, V> &entry<T, V>::operator=(const entry<T, V> &other) {
     _key = other._key;
     _value = other._value;
+    _hash = other._hash;
     return *this;
 }
 
 template <typename T, typename V>
 bool entry<T, V>::operator==(const entry<T, V> &other) {
-    return _key == other._key && _value = other._value;
+    return _key == other._key && _value == other._value;
 }
 
 template <typename T, typename V>
@@ -106,136 +250,522 @@ bool entry<T, V>::operator==(const T &key) {
     return _key == key;
 }
 
+template <typename T, typename V>
+template <typename K>
+bool entry<T, V>::matches(const K &key, uint64_t hash) const {
+    return _hash == hash && _key == key;
+}
 
 
-template <typename T, typename V>
-hash_map<T, V>::hash_map(size_t initial_size) : _size(initial_size),
+
+template <typename T, typename V, typename H>
+hash_map<T, V, H>::hash_map(size_t initial_size, const H &hasher, mstd::memory_resource *resource)
+                                                 : _size(initial_size),
                                                    _num_items(0),
-                                                   _p(0)
+                                                   _p(0),
+                                                   _initial_size(initial_size),
+                                                   _num_splits(0),
+                                                   _num_merges(0),
+                                                   _hasher(hasher),
+                                                   _resource(resource)
                                                         {
-    _entries = new mstd::vector<entry<T, V>>*[_size];
-    for (size_t i = 0; i < initial_size; i++) {
-        _entries[i] = new mstd::vector<entry<T, V>>(hashmap_constants::max_bucket_size);
+    _init_table();
+}
+
+template <typename T, typename V, typename H>
+hash_map<T, V, H>::hash_map(const hash_map &other) : _size(other._size),
+                                                     _num_items(other._num_items),
+                                                     _p(other._p),
+                                                     _initial_size(other._initial_size),
+                                                     _num_splits(other._num_splits),
+                                                     _num_merges(other._num_merges),
+                                                     _hasher(other._hasher),
+                                                     _resource(other._resource),
+                                                     _num_segments(0),
+                                                     _segments_capacity(other._segments_capacity)
+                                                        {
+    _segments = _new_array<hash_bucket<T, V> **>(_segments_capacity);
+    for (size_t i = 0; i < _size + _p; i++) {
+        _add_bucket(i);
+        hash_bucket<T, V> *from = other._bucket(i);
+        hash_bucket<T, V> *to = _bucket(i);
+        for (size_t j = 0; j < from->size(); j++) {
+            to->push(from->at(j));
+        }
     }
 }
 
-template <typename T, typename V>
-hash_map<T, V>::~hash_map() {
+template <typename T, typename V, typename H>
+hash_map<T, V, H>::hash_map(hash_map &&other) : _size(other._size),
+                                                _num_items(other._num_items),
+                                                _p(other._p),
+                                                _initial_size(other._initial_size),
+                                                _num_splits(other._num_splits),
+                                                _num_merges(other._num_merges),
+                                                _hasher(other._hasher),
+                                                _resource(other._resource),
+                                                _segments(other._segments),
+                                                _num_segments(other._num_segments),
+                                                _segments_capacity(other._segments_capacity)
+                                                        {
+    // Leave other in a valid (empty) state
+    other._num_items = 0;
+    other._num_splits = 0;
+    other._num_merges = 0;
+    other._init_table();
+}
+
+template <typename T, typename V, typename H>
+hash_map<T, V, H>::~hash_map() {
     for (size_t i = 0; i < _size + _p; i++) {
-        delete _entries[i];
+        _delete_bucket(_bucket(i));
     }
-    delete[] _entries;
+    for (size_t i = 0; i < _num_segments; i++) {
+        _delete_array(_segments[i], hashmap_constants::segment_size);
+    }
+    _delete_array(_segments, _segments_capacity);
 }
 
-template <typename T, typename V>
-void hash_map<T, V>::insert(T key, V value) {
+template <typename T, typename V, typename H>
+void hash_map<T, V, H>::insert(T key, V value) {
+    if (!_try_emplace(std::move(key), std::move(value))) {
+        throw std::runtime_error("Key already exists");
+    }
+}
 
-    int hash = key.hash();
-    size_t index = hash % _size;
-    if (index < _p) {
-        index = hash % (2 * _size);
+template <typename T, typename V, typename H>
+template <typename... Args>
+bool hash_map<T, V, H>::try_emplace(const T &key, Args &&... args) {
+    return _try_emplace(key, std::forward<Args>(args)...);
+}
+
+template <typename T, typename V, typename H>
+template <typename... Args>
+bool hash_map<T, V, H>::try_emplace(T &&key, Args &&... args) {
+    return _try_emplace(std::move(key), std::forward<Args>(args)...);
+}
+
+template <typename T, typename V, typename H>
+template <typename KArg, typename... Args>
+bool hash_map<T, V, H>::emplace(KArg &&key_arg, Args &&... args) {
+    T key(std::forward<KArg>(key_arg));
+    return _try_emplace(std::move(key), std::forward<Args>(args)...);
+}
+
+template <typename T, typename V, typename H>
+template <typename M>
+bool hash_map<T, V, H>::insert_or_assign(const T &key, M &&value) {
+    return _insert_or_assign(key, std::forward<M>(value));
+}
+
+template <typename T, typename V, typename H>
+template <typename M>
+bool hash_map<T, V, H>::insert_or_assign(T &&key, M &&value) {
+    return _insert_or_assign(std::move(key), std::forward<M>(value));
+}
+
+template <typename T, typename V, typename H>
+void hash_map<T, V, H>::reserve(size_t n) {
+    // Inserting the n-th item computes the load of n + 1 items: keep it under load_factor
+    auto buckets = (size_t) ((n + 1) * 100.0 / (hashmap_constants::load_factor * hashmap_constants::max_bucket_size)) + 1;
+    while (_size + _p < buckets) {
+        _split();
     }
+}
 
-    entry<T, V> new_entry(std::move(key), std::move(value));
+template <typename T, typename V, typename H>
+template <typename It>
+size_t hash_map<T, V, H>::build(It first, It last, thread_pool *pool) {
+    size_t n = last - first;
 
-    for (int i = 0; i < _entries[index]->size(); i++) {
-        if (_entries[index]->at(i) == new_entry.get_key()) {
-            throw std::runtime_error("Key already exists");
+    // From here on the table doesn't split, so every item's bucket is known up front
+    reserve(_num_items + n);
+
+    size_t inserted = 0;
+    if (pool == nullptr || n < hashmap_constants::parallel_threshold) {
+        for (It it = first; it != last; ++it) {
+            if (try_emplace(it->first, it->second)) {
+                inserted++;
+            }
         }
+        return inserted;
     }
-    _entries[index]->push(new_entry);
 
-    int load = _calculate_load();
+    const size_t parts = hashmap_constants::parallel_chunks;
+    size_t chunk_size = (n + parts - 1) / parts;
+    size_t num_buckets = _size + _p;
+
+    auto *hashes = new uint64_t[n];
+    // Item indices, grouped by partition
+    auto *order = new size_t[n];
+    // counts[c * parts + p] is the number of items of chunk c that fall into partition p
+    auto *counts = new size_t[parts * parts]();
+    auto *part_start = new size_t[parts + 1];
+    auto *part_inserted = new size_t[parts]();
+
+    // Hash every item, and count how many of each chunk fall into each partition
+    for (size_t c = 0; c < parts; c++) {
+        size_t start = c * chunk_size;
+        size_t end = std::min(n, start + chunk_size);
+        pool->add_task([this, first, hashes, counts, parts, num_buckets, c, start, end]() {
+            for (size_t i = start; i < end; i++) {
+                hashes[i] = _hasher(first[i].first);
+                counts[c * parts + _partition(hashes[i], num_buckets)]++;
+            }
+        });
+    }
+    pool->wait_all();
+
+    // Turn the counts into offsets. Within a partition, items stay in input order
+    size_t sum = 0;
+    for (size_t p = 0; p < parts; p++) {
+        part_start[p] = sum;
+        for (size_t c = 0; c < parts; c++) {
+            size_t count = counts[c * parts + p];
+            counts[c * parts + p] = sum;
+            sum += count;
+        }
+    }
+    part_start[parts] = n;
+
+    // Scatter the item indices. Every chunk writes its own slots
+    for (size_t c = 0; c < parts; c++) {
+        size_t start = c * chunk_size;
+        size_t end = std::min(n, start + chunk_size);
+        pool->add_task([this, hashes, order, counts, parts, num_buckets, c, start, end]() {
+            for (size_t i = start; i < end; i++) {
+                order[counts[c * parts + _partition(hashes[i], num_buckets)]++] = i;
+            }
+        });
+    }
+    pool->wait_all();
+
+    // Every partition owns a disjoint range of buckets, so they can be filled without any locking
+    auto fill = [this, first, hashes, order, part_start, part_inserted](size_t p) {
+        for (size_t k = part_start[p]; k < part_start[p + 1]; k++) {
+            size_t i = order[k];
+            uint64_t hash = hashes[i];
+            if (_find(first[i].first, hash) == nullptr) {
+                _bucket(_index(hash))->emplace(hash, first[i].first, first[i].second);
+                part_inserted[p]++;
+            }
+        }
+    };
+    // Filling allocates bucket storage, so it only goes to the workers if the resource allows it.
+    // Otherwise this thread fills the buckets in order, which still only walks each range of buckets once
+    if (_resource->is_thread_safe()) {
+        for (size_t p = 0; p < parts; p++) {
+            pool->add_task([fill, p]() { fill(p); });
+        }
+        pool->wait_all();
+    } else {
+        for (size_t p = 0; p < parts; p++) {
+            fill(p);
+        }
+    }
 
-    bool split = false;
+    for (size_t p = 0; p < parts; p++) {
+        inserted += part_inserted[p];
+    }
+    _num_items += inserted;
 
-    if (load > hashmap_constants::load_factor) {
-        split = true;
-        // Load factor has been reached. Split at _p
+    delete[] hashes;
+    delete[] order;
+    delete[] counts;
+    delete[] part_start;
+    delete[] part_inserted;
 
-        mstd::vector<entry<T, V>> *tmp_storage = _entries[_p]; // Keep a temporary storage
+    return inserted;
+}
+
+template <typename T, typename V, typename H>
+template <typename K>
+V &hash_map<T, V, H>::get(const K &key) const {
+    entry<T, V> *e = _find(key, _hasher(key));
+    if (e == nullptr) {
+        throw std::runtime_error("Key does not exist");
+    }
+
+    return e->get_value();
+}
+
+template <typename T, typename V, typename H>
+template <typename K>
+V *hash_map<T, V, H>::find(const K &key) const {
+    entry<T, V> *e = _find(key, _hasher(key));
+    return e == nullptr ? nullptr : &e->get_value();
+}
+
+template <typename T, typename V, typename H>
+template <typename K>
+bool hash_map<T, V, H>::contains(const K &key) const {
+    return find(key) != nullptr;
+}
 
-        _resize(); // Allocate one more bucket at the end of the table
+template <typename T, typename V, typename H>
+template <typename K>
+bool hash_map<T, V, H>::erase(const K &key) {
+    uint64_t hash = _hasher(key);
+    hash_bucket<T, V> *bucket = _bucket(_index(hash));
+    for (size_t i = 0; i < bucket->size(); i++) {
+        if (bucket->at(i).matches(key, hash)) {
+            // Order within a bucket doesn't matter: fill the gap with the last entry
+            if (i != bucket->size() - 1) {
+                bucket->at(i) = std::move(bucket->back());
+            }
+            bucket->pop_back();
+            _num_items--;
+
+            if (_size + _p > _initial_size && _calculate_load() < hashmap_constants::merge_load_factor) {
+                _merge();
+            }
+            return true;
+        }
+    }
 
-        _entries[_p] = new mstd::vector<entry<T, V>>(hashmap_constants::max_bucket_size); // And create a new bucket
+    return false;
+}
+
+template <typename T, typename V, typename H>
+size_t hash_map<T, V, H>::get_num_items() const {
+    return _num_items;
+}
+
+template <typename T, typename V, typename H>
+size_t hash_map<T, V, H>::size() const {
+    return _size + _p;
+}
 
-        // Rehash each element in tmp_storage to either _p or _size + _p
-        for (int i = 0; i < (int) tmp_storage->size(); i++) {
-            entry<T, V> &tmp = tmp_storage->at(i);
-            int hash = tmp.get_key().hash();
+template <typename T, typename V, typename H>
+bool hash_map<T, V, H>::empty() const {
+    return _num_items == 0;
+}
 
-            int index = hash % (2 * _size);
-            _entries[index]->push(tmp);
+template <typename T, typename V, typename H>
+mstd::hash_stats hash_map<T, V, H>::stats() const {
+    mstd::hash_stats st;
+    st.num_items = _num_items;
+    st.num_buckets = _size + _p;
+    st.splits = _num_splits;
+    st.merges = _num_merges;
+    st.table_bytes = sizeof(*this)
+                     + _segments_capacity * sizeof(*_segments)
+                     + _num_segments * hashmap_constants::segment_size * sizeof(**_segments);
+
+    size_t total_probes = 0;
+    for (size_t i = 0; i < _size + _p; i++) {
+        hash_bucket<T, V> *bucket = _bucket(i);
+        mstd::detail::histogram_add(st.bucket_occupancy, bucket->size());
+        st.bucket_bytes += sizeof(*bucket) + (bucket->is_small() ? 0 : bucket->capacity() * sizeof(entry<T, V>));
+
+        // get scans a bucket from the front, so the j-th entry is found after j + 1 comparisons
+        for (size_t j = 0; j < bucket->size(); j++) {
+            mstd::detail::histogram_add(st.probe_lengths, j);
+            total_probes += j + 1;
+            st.key_bytes += mstd::detail::key_heap_bytes(bucket->at(j).get_key());
         }
+        if (bucket->size() > st.longest_probe) {
+            st.longest_probe = bucket->size();
+        }
+    }
+
+    st.total_bytes = st.table_bytes + st.bucket_bytes + st.key_bytes;
+    st.average_probe = _num_items == 0 ? 0 : (double) total_probes / _num_items;
+    st.load_factor = (double) _num_items / ((_size + _p) * hashmap_constants::max_bucket_size);
+    return st;
+}
+
+template <typename T, typename V, typename H>
+hash_bucket<T, V> *&hash_map<T, V, H>::_bucket(size_t index) const {
+    return _segments[index >> hashmap_constants::segment_bits][index & (hashmap_constants::segment_size - 1)];
+}
 
-        // Delete the temporary object
-        delete tmp_storage;
+template <typename T, typename V, typename H>
+void hash_map<T, V, H>::_init_table() {
+    _size = _initial_size;
+    _p = 0;
+    _num_segments = 0;
+    _segments_capacity = (_size >> hashmap_constants::segment_bits) + 1;
+    _segments = _new_array<hash_bucket<T, V> **>(_segments_capacity);
+    for (size_t i = 0; i < _initial_size; i++) {
+        _add_bucket(i);
+    }
+}
 
-        // Increase p after the split operation
-        if ((++_p) == _size) {
-            // Next hashing phase
-            // If the hash table has doubled in size, reset p and double the size
-            _size *= 2;
-            _p = 0;
+template <typename T, typename V, typename H>
+void hash_map<T, V, H>::_add_bucket(size_t index) {
+    size_t segment = index >> hashmap_constants::segment_bits;
+    if (segment == _num_segments) {
+        if (_num_segments == _segments_capacity) {
+            // Only the (small) array of segment pointers is copied, and its size doubles every time.
+            // That's one copy of n / segment_size pointers every n insertions
+            auto tmp = _new_array<hash_bucket<T, V> **>(_segments_capacity * 2);
+            for (size_t i = 0; i < _num_segments; i++) {
+                tmp[i] = _segments[i];
+            }
+            _delete_array(_segments, _segments_capacity);
+            _segments = tmp;
+            _segments_capacity *= 2;
         }
+        _segments[_num_segments++] = _new_array<hash_bucket<T, V> *>(hashmap_constants::segment_size);
     }
 
-    _num_items++;
+    // Initialise the newly created bucket
+    _bucket(index) = _new_bucket();
 }
 
-template <typename T, typename V>
-V &hash_map<T, V>::get(const T &key) const {
+template <typename T, typename V, typename H>
+hash_bucket<T, V> *hash_map<T, V, H>::_new_bucket() {
+    void *p = _resource->allocate(sizeof(hash_bucket<T, V>), alignof(hash_bucket<T, V>));
+    return new (p) hash_bucket<T, V>(hashmap_constants::max_bucket_size, _resource);
+}
+
+template <typename T, typename V, typename H>
+void hash_map<T, V, H>::_delete_bucket(hash_bucket<T, V> *bucket) {
+    typedef hash_bucket<T, V> bucket_type;
+    bucket->~bucket_type();
+    _resource->deallocate(bucket, sizeof(hash_bucket<T, V>), alignof(hash_bucket<T, V>));
+}
+
+template <typename T, typename V, typename H>
+template <typename P>
+P *hash_map<T, V, H>::_new_array(size_t n) {
+    return static_cast<P *>(_resource->allocate(n * sizeof(P), alignof(P)));
+}
+
+template <typename T, typename V, typename H>
+template <typename P>
+void hash_map<T, V, H>::_delete_array(P *array, size_t n) {
+    _resource->deallocate(array, n * sizeof(P), alignof(P));
+}
 
-    int hash = key.hash();
-    
+template <typename T, typename V, typename H>
+void hash_map<T, V, H>::_remove_last_bucket(size_t index) {
+    _delete_bucket(_bucket(index));
+
+    // Free the segment once its first bucket is gone
+    if ((index & (hashmap_constants::segment_size - 1)) == 0) {
+        _delete_array(_segments[--_num_segments], hashmap_constants::segment_size);
+    }
+}
+
+template <typename T, typename V, typename H>
+size_t hash_map<T, V, H>::_index(uint64_t hash) const {
     size_t index = hash % _size;
     if (index < _p) {
-        index = hash % (_size * 2);
+        index = hash % (2 * _size);
     }
+    return index;
+}
 
-    int child_index;
-    mstd::vector<entry<T, V>> *v = _entries[index];
-    for (size_t i = 0; i < v->size(); i++) {
-        if (v->at(i) == key) {
-            return v->at((size_t) i).get_value();
+template <typename T, typename V, typename H>
+template <typename K>
+entry<T, V> *hash_map<T, V, H>::_find(const K &key, uint64_t hash) const {
+    hash_bucket<T, V> *bucket = _bucket(_index(hash));
+    for (size_t i = 0; i < bucket->size(); i++) {
+        if (bucket->at(i).matches(key, hash)) {
+            return &bucket->at(i);
         }
     }
 
-    throw std::runtime_error("Key does not exist");
+    return nullptr;
+}
+
+template <typename T, typename V, typename H>
+template <typename KArg, typename... Args>
+bool hash_map<T, V, H>::_try_emplace(KArg &&key, Args &&... args) {
+    uint64_t hash = _hasher(key);
+    if (_find(key, hash) != nullptr) {
+        return false;
+    }
 
+    // The entry is constructed directly in its bucket
+    _bucket(_index(hash))->emplace(hash, std::forward<KArg>(key), std::forward<Args>(args)...);
+
+    if (_calculate_load() > hashmap_constants::load_factor) {
+        // Load factor has been reached. Split at _p
+        _split();
+    }
+
+    _num_items++;
+    return true;
 }
 
-template <typename T, typename V>
-size_t hash_map<T, V>::get_num_items() const {
-    return _num_items;
+template <typename T, typename V, typename H>
+template <typename KArg, typename M>
+bool hash_map<T, V, H>::_insert_or_assign(KArg &&key, M &&value) {
+    entry<T, V> *e = _find(key, _hasher(key));
+    if (e != nullptr) {
+        e->get_value() = std::forward<M>(value);
+        return false;
+    }
+
+    return _try_emplace(std::forward<KArg>(key), std::forward<M>(value));
 }
 
-template <typename T, typename V>
-size_t hash_map<T, V>::size() const {
-    return _size + _p;
+template <typename T, typename V, typename H>
+size_t hash_map<T, V, H>::_partition(uint64_t hash, size_t num_buckets) const {
+    return _index(hash) * hashmap_constants::parallel_chunks / num_buckets;
 }
 
-template <typename T, typename V>
-bool hash_map<T, V>::empty() const {
-    return _num_items == 0;
+template <typename T, typename V, typename H>
+void hash_map<T, V, H>::_split() {
+    hash_bucket<T, V> *origin = _bucket(_p);
+
+    _add_bucket(_size + _p); // Allocate one more bucket at the end of the table
+    hash_bucket<T, V> *image = _bucket(_size + _p);
+
+    // Move the entries that now hash to _size + _p, and compact the others in place. Their hashes are cached
+    size_t kept = 0;
+    for (size_t i = 0; i < origin->size(); i++) {
+        entry<T, V> &tmp = origin->at(i);
+
+        if (tmp.get_hash() % (2 * _size) == _p) {
+            if (kept != i) {
+                origin->at(kept) = std::move(tmp);
+            }
+            kept++;
+        } else {
+            image->push(std::move(tmp));
+        }
+    }
+    while (origin->size() > kept) {
+        origin->pop_back();
+    }
+
+    _num_splits++;
+
+    // Increase p after the split operation
+    if ((++_p) == _size) {
+        // Next hashing phase
+        // If the hash table has doubled in size, reset p and double the size
+        _size *= 2;
+        _p = 0;
+    }
 }
 
-template <typename T, typename V>
-void hash_map<T, V>::_resize() {
-    auto tmp = new mstd::vector<entry<T, V>>*[_size + _p + 1];
-    for (size_t i = 0; i < _size + _p; i++) {
-        tmp[i] = _entries[i];
+// The exact reverse of _split
+template <typename T, typename V, typename H>
+void hash_map<T, V, H>::_merge() {
+    if (_p == 0) {
+        // Go back to the previous hashing phase
+        _size /= 2;
+        _p = _size;
     }
+    _p--;
 
-    // Initialise the newly created bucket
-    tmp[_size + _p] = new mstd::vector<entry<T, V>>(hashmap_constants::max_bucket_size);
+    hash_bucket<T, V> *image = _bucket(_size + _p);
+    hash_bucket<T, V> *origin = _bucket(_p);
+    for (size_t i = 0; i < image->size(); i++) {
+        origin->push(std::move(image->at(i)));
+    }
 
-    delete[] _entries;
-    _entries = tmp;
+    _remove_last_bucket(_size + _p);
+    _num_merges++;
 }
 
-template <typename T, typename V>
-int hash_map<T, V>::_calculate_load() const {
+template <typename T, typename V, typename H>
+int hash_map<T, V, H>::_calculate_load() const {
     return (int) ((_num_items + 1) / (double) ((_size + _p) * hashmap_constants::max_bucket_size) * 100);
 }
 
@@ -0,0 +1,90 @@
+#ifndef HASH_STATS_HPP
+#define HASH_STATS_HPP
+
+#include <cstddef>
+#include <string>
+#include <sstream>
+#include "mvector.hpp"
+
+namespace mstd {
+    // Snapshot of a hash table's shape, returned by hash_map::stats() and hash_table::stats().
+    // Computing it walks the whole table, so it's meant for diagnostics, not for hot paths.
+    // In open addressing tables (hash_table) every slot is a bucket of capacity 1
+    struct hash_stats {
+        size_t num_items = 0;
+        size_t num_buckets = 0;
+
+        // bucket_occupancy[k] is the number of buckets holding k items
+        mstd::vector<size_t> bucket_occupancy;
+        // probe_lengths[k] is the number of items a successful lookup finds after inspecting k + 1 entries
+        mstd::vector<size_t> probe_lengths;
+        // Most entries a successful lookup inspects (the longest chain, or the longest probe sequence)
+        size_t longest_probe = 0;
+        double average_probe = 0;
+
+        // hash_map: bucket splits (and merges) since construction. hash_table: table doublings
+        size_t splits = 0;
+        size_t merges = 0;
+
+        // Bucket directory, or slot array
+        size_t table_bytes = 0;
+        // Bucket storage outside of the table (hash_map's bucket vectors)
+        size_t bucket_bytes = 0;
+        // Key storage outside of the buckets: interned keys, or heap-allocated string keys
+        size_t key_bytes = 0;
+        size_t total_bytes = 0;
+
+        // num_items over the number of places items can be stored
+        double load_factor = 0;
+
+        std::string to_string() const;
+    };
+
+    namespace detail {
+        // Heap bytes owned by a key, on top of its own size
+        template <typename T>
+        size_t key_heap_bytes(const T &) {
+            return 0;
+        }
+
+        // Short strings are stored inside the string object itself
+        inline size_t key_heap_bytes(const std::string &key) {
+            const char *begin = (const char *) &key;
+            if (key.data() >= begin && key.data() < begin + sizeof(key)) {
+                return 0;
+            }
+            return key.capacity() + 1;
+        }
+
+        // Counts one more item at index k of a histogram, growing it as needed
+        inline void histogram_add(mstd::vector<size_t> &histogram, size_t k) {
+            while (histogram.size() <= k) {
+                histogram.push(0);
+            }
+            histogram[k]++;
+        }
+    }
+}
+
+inline std::string mstd::hash_stats::to_string() const {
+    std::ostringstream out;
+    out << "items: " << num_items << ", buckets: " << num_buckets << ", load factor: " << load_factor << "\n";
+    out << "probes: average " << average_probe << ", longest " << longest_probe << "\n";
+    out << "splits: " << splits << ", merges: " << merges << "\n";
+    out << "bytes: " << total_bytes << " (table " << table_bytes << ", buckets " << bucket_bytes
+        << ", keys " << key_bytes << ")\n";
+
+    out << "bucket occupancy:";
+    for (size_t k = 0; k < bucket_occupancy.size(); k++) {
+        out << " " << k << ":" << bucket_occupancy[k];
+    }
+    out << "\nprobe lengths:";
+    for (size_t k = 0; k < probe_lengths.size(); k++) {
+        out << " " << k + 1 << ":" << probe_lengths[k];
+    }
+    out << "\n";
+
+    return out.str();
+}
+
+#endif // HASH_STATS_HPP
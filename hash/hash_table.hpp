@@ -4,66 +4,279 @@
 #include <cstdio>
 #include <cstring>
 #include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <new>
 #include <mvector.hpp>
+#include "hash_functions.hpp"
+#include "string_view.hpp"
+#include "hash_stats.hpp"
+
+namespace hash_table_constants {
+    // Keys are interned into blocks of this many bytes (longer keys get a block of their own)
+    const size_t arena_block_size = 64 * 1024;
+    // The table starts growing once it's 3/4 full
+    const size_t max_load_num = 3;
+    const size_t max_load_den = 4;
+    // Old slots moved to the new table by every put while growing. With a load of 3/4 and a doubling,
+    // 4 per put finishes the move long before the new table needs to grow in turn
+    const size_t migrate_step = 4;
+}
 
 namespace mstd {
 
+    // String-keyed table. Keys are interned into an arena owned by the table, and lookups take a
+    // string_view: a get neither allocates nor copies.
+    // Open addressing with linear probing. The table grows incrementally: when it's full, a table twice
+    // as big is allocated and every put moves a few slots of the old one, so no put pays for a whole rehash.
+    // Slot arrays and key blocks come from a memory_resource
     template<typename B>
     class hash_table {
     private:
-        template<typename V>
-        struct hash_entry {
-            std::string _key;
-            V _value;
+        struct slot {
+            uint64_t hash;
+            // nullptr marks an empty slot. Points into the arena, and is null terminated
+            const char *key;
+            size_t length;
+            B value;
+        };
+
+        struct table {
+            slot *slots;
+            size_t capacity;
+            size_t mask;
         };
 
-        mstd::vector<hash_entry<B>> *_entries;
-        size_t _size;
+        table _table;
+        // The table being moved into _table while growing, whose slots below _migrated are already moved
+        table _old;
+        size_t _migrated;
+        size_t _num_items;
+        size_t _num_grows;
+
+        struct arena_block {
+            char *data;
+            size_t size;
+        };
+
+        memory_resource *_resource;
+        mstd::vector<arena_block> _arena_blocks;
+        char *_arena_ptr;
+        size_t _arena_left;
+        size_t _arena_bytes;
+
+        static uint64_t _hash_function(string_view key) {
+            return mstd::fast_hash64(key.data(), key.length());
+        }
+
+        table _make_table(size_t capacity) {
+            table t;
+            t.slots = static_cast<slot *>(_resource->allocate(capacity * sizeof(slot), alignof(slot)));
+            for (size_t i = 0; i < capacity; i++) {
+                new (&t.slots[i]) slot();
+            }
+            t.capacity = capacity;
+            t.mask = capacity - 1;
+            return t;
+        }
+
+        void _free_table(table &t) {
+            if (t.slots == nullptr) return;
+            for (size_t i = 0; i < t.capacity; i++) {
+                t.slots[i].~slot();
+            }
+            _resource->deallocate(t.slots, t.capacity * sizeof(slot), alignof(slot));
+            t.slots = nullptr;
+            t.capacity = 0;
+        }
+
+        static slot *_find(const table &t, string_view key, uint64_t hash) {
+            if (t.slots == nullptr) return nullptr;
+            for (size_t i = hash & t.mask;; i = (i + 1) & t.mask) {
+                slot &s = t.slots[i];
+                if (s.key == nullptr) return nullptr;
+                if (s.hash == hash && s.length == key.length() && memcmp(s.key, key.data(), s.length) == 0) {
+                    return &s;
+                }
+            }
+        }
+
+        // The key is known not to be in t
+        static slot &_free_slot(const table &t, uint64_t hash) {
+            size_t i = hash & t.mask;
+            while (t.slots[i].key != nullptr) {
+                i = (i + 1) & t.mask;
+            }
+            return t.slots[i];
+        }
+
+        const char *_intern(string_view key) {
+            size_t needed = key.length() + 1;
+            if (needed > _arena_left) {
+                size_t block_size = std::max(needed, hash_table_constants::arena_block_size);
+                _arena_ptr = static_cast<char *>(_resource->allocate(block_size, 1));
+                _arena_left = block_size;
+                _arena_blocks.push(arena_block{_arena_ptr, block_size});
+                _arena_bytes += block_size;
+            }
+
+            char *interned = _arena_ptr;
+            memcpy(interned, key.data(), key.length());
+            interned[key.length()] = '\0';
+            _arena_ptr += needed;
+            _arena_left -= needed;
+            return interned;
+        }
+
+        void _migrate(size_t count) {
+            for (; count > 0 && _migrated < _old.capacity; count--, _migrated++) {
+                slot &s = _old.slots[_migrated];
+                if (s.key != nullptr) {
+                    slot &dst = _free_slot(_table, s.hash);
+                    dst.hash = s.hash;
+                    dst.key = s.key;
+                    dst.length = s.length;
+                    dst.value = std::move(s.value);
+                }
+            }
+
+            if (_migrated == _old.capacity) {
+                _free_table(_old);
+            }
+        }
 
-        int _hash_function(const std::string &key) const {
-            auto *str = new char[key.length() + 1];
-            auto *tmp = str;
-            strcpy(str, key.c_str());
-            int hash = 5381;
-            int c;
+        void _grow() {
+            // Never happens with migrate_step, but a growing table can't start growing again
+            if (_old.slots != nullptr) {
+                _migrate(_old.capacity);
+            }
 
-            while ((c = *tmp++))
-                hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+            _old = _table;
+            _migrated = 0;
+            _table = _make_table(_old.capacity * 2);
+            _num_grows++;
+        }
 
-            // If we get a negative result, return -result
-            delete[] str;
-            return hash > 0 ? hash : -hash;
+        // Adds the slots of t that hold live items to st
+        void _add_stats(mstd::hash_stats &st, const table &t, size_t first) const {
+            for (size_t i = first; i < t.capacity; i++) {
+                const slot &s = t.slots[i];
+                mstd::detail::histogram_add(st.bucket_occupancy, s.key != nullptr);
+                if (s.key == nullptr) continue;
 
+                // Distance from the key's home slot, wrapping around the end of the table
+                size_t probe = (i - (s.hash & t.mask)) & t.mask;
+                mstd::detail::histogram_add(st.probe_lengths, probe);
+                st.average_probe += probe + 1;
+                if (probe + 1 > st.longest_probe) {
+                    st.longest_probe = probe + 1;
+                }
+            }
         }
 
     public:
-        explicit hash_table(size_t size = 30) : _size(size) {
-            _entries = new mstd::vector<hash_entry<B>>[size];
+        explicit hash_table(size_t size = 30, memory_resource *resource = default_resource())
+                : _migrated(0), _num_items(0), _num_grows(0), _resource(resource), _arena_blocks(1, resource),
+                  _arena_ptr(nullptr), _arena_left(0), _arena_bytes(0) {
+            size_t capacity = 8;
+            while (capacity * hash_table_constants::max_load_num < size * hash_table_constants::max_load_den) {
+                capacity <<= 1;
+            }
+            _table = _make_table(capacity);
+            _old.slots = nullptr;
+            _old.capacity = 0;
+            _old.mask = 0;
         }
 
         hash_table(const hash_table &)=delete;
 
         ~hash_table() {
-            delete[] _entries;
+            _free_table(_table);
+            _free_table(_old);
+            for (size_t i = 0; i < _arena_blocks.size(); i++) {
+                _resource->deallocate(_arena_blocks[i].data, _arena_blocks[i].size, 1);
+            }
+        }
+
+        // Overwrites the value of an existing key
+        void put(string_view key, B val) {
+            uint64_t hash = _hash_function(key);
+            if (_old.slots != nullptr) {
+                _migrate(hash_table_constants::migrate_step);
+            }
+
+            // Moved slots are left in the old table, so that its probe sequences stay intact. A key found
+            // there but not in the new table hasn't been moved yet: it's updated in place, and moved later
+            slot *s = _find(_table, key, hash);
+            if (s == nullptr) {
+                s = _find(_old, key, hash);
+            }
+            if (s != nullptr) {
+                s->value = std::move(val);
+                return;
+            }
+
+            if ((_num_items + 1) * hash_table_constants::max_load_den > _table.capacity * hash_table_constants::max_load_num) {
+                _grow();
+            }
+
+            slot &dst = _free_slot(_table, hash);
+            dst.hash = hash;
+            dst.key = _intern(key);
+            dst.length = key.length();
+            dst.value = std::move(val);
+            _num_items++;
         }
 
-        void put(std::string key, B val) {
-            hash_entry<B> tmp;
-            tmp._key = key;
-            tmp._value = val;
-            size_t index = _hash_function(key) % _size;
-            _entries[index].add(tmp);
+        // Returns nullptr if the key doesn't exist
+        const B *find(string_view key) const {
+            uint64_t hash = _hash_function(key);
+            slot *s = _find(_table, key, hash);
+            if (s == nullptr) {
+                s = _find(_old, key, hash);
+            }
+            return s == nullptr ? nullptr : &s->value;
         }
 
-        B get(const std::string &key) const {
-            size_t index = _hash_function(key) % _size;
-            mstd::vector<hash_entry<B>> v = _entries[index];
-            for (int i = 0; i < v.size(); i++) {
-                if (v.get(i)._key == key) {
-                    return v.get(i)._value;
-                }
+        const B &get(string_view key) const {
+            const B *value = find(key);
+            if (value == nullptr) {
+                throw std::runtime_error("Unknown key");
             }
-            throw std::runtime_error("Unknown key");
+            return *value;
+        }
+
+        bool contains(string_view key) const {
+            return find(key) != nullptr;
+        }
+
+        size_t size() const {
+            return _num_items;
+        }
+
+        size_t capacity() const {
+            return _table.capacity;
+        }
+
+        // Walks every slot (of both tables while growing): probe distances and memory use
+        mstd::hash_stats stats() const {
+            mstd::hash_stats st;
+            st.num_items = _num_items;
+            st.num_buckets = _table.capacity + _old.capacity;
+            st.splits = _num_grows;
+
+            _add_stats(st, _table, 0);
+            if (_old.slots != nullptr) {
+                // Slots below _migrated have been moved already
+                _add_stats(st, _old, _migrated);
+            }
+
+            st.table_bytes = sizeof(*this) + (_table.capacity + _old.capacity) * sizeof(slot);
+            st.key_bytes = _arena_bytes + _arena_blocks.capacity() * sizeof(arena_block);
+            st.total_bytes = st.table_bytes + st.key_bytes;
+            st.average_probe = _num_items == 0 ? 0 : st.average_probe / _num_items;
+            st.load_factor = (double) _num_items / _table.capacity;
+            return st;
         }
     };
 }
@@ -0,0 +1,391 @@
+#ifndef PERFECT_HASH_INDEX_HPP
+#define PERFECT_HASH_INDEX_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+#include <utility>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mvector.hpp"
+#include "string_view.hpp"
+#include "hash_functions.hpp"
+
+namespace perfect_hash_constants {
+    // Version 2: positions are mixed before being reduced (version 1 files don't map the same way)
+    const char magic[8] = {'M', 'S', 'T', 'D', 'P', 'H', 'I', '2'};
+    // Average number of keys per bucket. Each bucket costs one 32-bit pilot, i.e. ~8 bits per key
+    const double keys_per_bucket = 4.0;
+    // Skewed bucket assignment (PTHash): 60% of the keys go to the first 30% of the buckets,
+    // so that the big buckets are placed first, while the table is still mostly empty
+    const double dense_keys = 0.6;
+    const double dense_buckets = 0.3;
+    // Pilots tried per bucket before giving up on a seed: at least min_pilots, and pilots_per_key times the
+    // number of keys (the last buckets look for one free slot among num_keys, i.e. ~num_keys tries)
+    const uint64_t min_pilots = 1 << 16;
+    const uint64_t pilots_per_key = 32;
+    // Seeds tried before write() gives up
+    const int max_seeds = 8;
+}
+
+namespace mstd {
+    // Everything the builder and the index need to agree on. The file is laid out as:
+    // header | pilots (uint32_t, one per bucket, padded to 8 bytes) | slots (one per key)
+    struct perfect_hash_header {
+        char magic[8];
+        uint64_t num_keys;
+        uint64_t num_buckets;
+        uint64_t num_dense_buckets;
+        uint64_t value_size;
+        uint64_t slot_size;
+        uint64_t seed;
+    };
+
+    namespace detail {
+        // Where a key's hashes go, shared by the builder and the index. h is the key's first 64 bits of hash
+        inline uint64_t phf_bucket(uint64_t h, const perfect_hash_header &header) {
+            const auto dense_threshold = (uint64_t) (perfect_hash_constants::dense_keys * (double) UINT32_MAX);
+            uint64_t high = h >> 32;
+            if ((h & UINT32_MAX) < dense_threshold) {
+                return high % header.num_dense_buckets;
+            }
+            return header.num_dense_buckets + high % (header.num_buckets - header.num_dense_buckets);
+        }
+
+        // Mixed again before the reduction: % num_keys only keeps the low bits of h when num_keys is a power of 2,
+        // and keys of a bucket whose low bits match would then collide for every pilot
+        inline uint64_t phf_position(uint64_t h, uint32_t pilot, const perfect_hash_header &header) {
+            return murmur3_fmix64(h ^ murmur3_fmix64(pilot + header.seed)) % header.num_keys;
+        }
+
+        inline size_t phf_pilots_bytes(uint64_t num_buckets) {
+            return (num_buckets * sizeof(uint32_t) + 7) & ~(size_t) 7;
+        }
+    }
+
+    // One entry of the flat value array. The fingerprint (the key's second 64 bits of hash) tells apart
+    // keys of the set from keys that merely map to the same slot
+    template <typename V>
+    struct perfect_hash_slot {
+        uint64_t fingerprint;
+        V value;
+    };
+
+    // Offline side: collects a static key-value set and writes it as a minimal perfect hash index
+    // (PTHash-style: every bucket of keys gets a pilot, searched so that its keys land on free slots).
+    // V has to be trivially copyable: the file is the in-memory representation
+    template <typename V>
+    class perfect_hash_builder {
+    public:
+        perfect_hash_builder()=default;
+        perfect_hash_builder(const perfect_hash_builder &)=delete;
+
+        void add(string_view key, const V &value);
+
+        size_t size() const;
+
+        // Throws if a key was added twice, or if the file can't be written
+        void write(const std::string &path) const;
+
+        perfect_hash_builder &operator=(const perfect_hash_builder &)=delete;
+    private:
+        struct item {
+            uint64_t hash;
+            uint64_t fingerprint;
+            V value;
+        };
+
+        mstd::vector<item> _items;
+
+        // Searches a pilot for every bucket (given as [start, end) ranges of order, biggest first), with
+        // header's seed. Returns false if a bucket found none within max_pilots
+        bool _place(const size_t *order, const uint64_t *bucket_of,
+                    const mstd::vector<std::pair<size_t, size_t>> &buckets, const perfect_hash_header &header,
+                    uint64_t max_pilots, uint32_t *pilots, bool *taken) const;
+    };
+
+    // Runtime side: maps a file written by perfect_hash_builder. Nothing is parsed or copied, so opening
+    // is O(1) and processes that map the same file share its pages.
+    // A lookup is one hash, a read of the key's bucket pilot and a read of its slot.
+    // A key outside the set is rejected by its 64-bit fingerprint, i.e. with a 2^-64 error rate
+    template <typename V>
+    class perfect_hash_index {
+    public:
+        // Throws if the file can't be mapped or wasn't built for this V
+        explicit perfect_hash_index(const std::string &path);
+        perfect_hash_index(const perfect_hash_index &)=delete;
+        ~perfect_hash_index();
+
+        // Returns nullptr if the key doesn't exist
+        const V *find(string_view key) const;
+
+        const V &get(string_view key) const;
+
+        bool contains(string_view key) const;
+
+        size_t size() const;
+
+        size_t size_in_bytes() const;
+
+        perfect_hash_index &operator=(const perfect_hash_index &)=delete;
+    private:
+        void *_map;
+        size_t _map_size;
+        perfect_hash_header _header;
+        const uint32_t *_pilots;
+        const perfect_hash_slot<V> *_slots;
+    };
+}
+
+/* -- Builder -- */
+
+template <typename V>
+void mstd::perfect_hash_builder<V>::add(string_view key, const V &value) {
+    static_assert(std::is_trivially_copyable<V>::value, "perfect_hash_index values must be trivially copyable");
+    // Slots start 8-aligned in the file (and so in the mapping)
+    static_assert(alignof(V) <= 8, "perfect_hash_index values can't need more than 8-byte alignment");
+
+    uint64_t h[2];
+    murmur3_128(key.data(), key.length(), 0, h);
+
+    item it;
+    it.hash = h[0];
+    it.fingerprint = h[1];
+    it.value = value;
+    _items.push(it);
+}
+
+template <typename V>
+size_t mstd::perfect_hash_builder<V>::size() const {
+    return _items.size();
+}
+
+template <typename V>
+void mstd::perfect_hash_builder<V>::write(const std::string &path) const {
+    size_t n = _items.size();
+
+    perfect_hash_header header;
+    memcpy(header.magic, perfect_hash_constants::magic, sizeof(header.magic));
+    header.num_keys = n;
+    header.num_buckets = n == 0 ? 0 : (uint64_t) ((double) n / perfect_hash_constants::keys_per_bucket) + 1;
+    header.num_dense_buckets = n == 0 ? 0 : (uint64_t) (perfect_hash_constants::dense_buckets * (double) header.num_buckets) + 1;
+    if (header.num_dense_buckets >= header.num_buckets) header.num_buckets = header.num_dense_buckets + 1;
+    header.value_size = sizeof(V);
+    header.slot_size = sizeof(perfect_hash_slot<V>);
+
+    // Sort the items by bucket, then the buckets by decreasing size
+    auto *bucket_of = new uint64_t[n];
+    auto *order = new size_t[n];
+    for (size_t i = 0; i < n; i++) {
+        bucket_of[i] = detail::phf_bucket(_items[i].hash, header);
+        order[i] = i;
+    }
+    std::sort(order, order + n, [this, bucket_of](size_t a, size_t b) {
+        if (bucket_of[a] != bucket_of[b]) return bucket_of[a] < bucket_of[b];
+        return _items[a].hash < _items[b].hash;
+    });
+
+    // [start, end) ranges of order, one per non-empty bucket
+    mstd::vector<std::pair<size_t, size_t>> buckets;
+    for (size_t i = 0; i < n;) {
+        size_t j = i + 1;
+        while (j < n && bucket_of[order[j]] == bucket_of[order[i]]) {
+            // Items of a bucket are sorted by hash, so duplicates are neighbours
+            if (_items[order[j]].hash == _items[order[j - 1]].hash) {
+                delete[] bucket_of;
+                delete[] order;
+                throw std::runtime_error("Key added twice (or 64-bit hash collision)");
+            }
+            j++;
+        }
+        buckets.push(std::make_pair(i, j));
+        i = j;
+    }
+    std::stable_sort(buckets.begin(), buckets.end(), [](const std::pair<size_t, size_t> &a,
+                                                        const std::pair<size_t, size_t> &b) {
+        return a.second - a.first > b.second - b.first;
+    });
+
+    for (size_t b = 0; b < buckets.size(); b++) {
+        if (buckets[b].second - buckets[b].first > 64) {
+            // Practically impossible with ~4 keys per bucket
+            delete[] bucket_of;
+            delete[] order;
+            throw std::runtime_error("Perfect hash bucket overflow");
+        }
+    }
+
+    uint64_t max_pilots = std::max(perfect_hash_constants::min_pilots, perfect_hash_constants::pilots_per_key * n);
+    max_pilots = std::min(max_pilots, (uint64_t) UINT32_MAX + 1);
+    auto *pilots = new uint32_t[header.num_buckets]();
+    auto *taken = new bool[n]();
+    // Bucket assignment doesn't depend on the seed: only the pilot search starts over with a new one
+    bool placed = false;
+    for (int attempt = 0; attempt < perfect_hash_constants::max_seeds && !placed; attempt++) {
+        header.seed = murmur3_fmix64(hash_constants::seed_mix + (uint64_t) attempt);
+        std::fill(pilots, pilots + header.num_buckets, 0);
+        std::fill(taken, taken + n, false);
+        placed = _place(order, bucket_of, buckets, header, max_pilots, pilots, taken);
+    }
+    if (!placed) {
+        delete[] bucket_of;
+        delete[] order;
+        delete[] pilots;
+        delete[] taken;
+        throw std::runtime_error("No pilot found for a perfect hash bucket");
+    }
+
+    auto *slots = new perfect_hash_slot<V>[n];
+    // Slots go to the file byte for byte: zero the padding after small values, so the output is deterministic
+    memset((void *) slots, 0, n * sizeof(perfect_hash_slot<V>));
+    for (size_t i = 0; i < n; i++) {
+        const item &it = _items[i];
+        uint64_t pos = detail::phf_position(it.hash, pilots[bucket_of[i]], header);
+        slots[pos].fingerprint = it.fingerprint;
+        slots[pos].value = it.value;
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char *) &header, sizeof(header));
+    size_t pilots_bytes = detail::phf_pilots_bytes(header.num_buckets);
+    out.write((const char *) pilots, header.num_buckets * sizeof(uint32_t));
+    const char padding[8] = {0};
+    out.write(padding, pilots_bytes - header.num_buckets * sizeof(uint32_t));
+    out.write((const char *) slots, n * sizeof(perfect_hash_slot<V>));
+    out.close();
+
+    delete[] bucket_of;
+    delete[] order;
+    delete[] pilots;
+    delete[] taken;
+    delete[] slots;
+
+    if (!out) {
+        throw std::runtime_error("Could not write " + path);
+    }
+}
+
+template <typename V>
+bool mstd::perfect_hash_builder<V>::_place(const size_t *order, const uint64_t *bucket_of,
+                                           const mstd::vector<std::pair<size_t, size_t>> &buckets,
+                                           const perfect_hash_header &header, uint64_t max_pilots, uint32_t *pilots,
+                                           bool *taken) const {
+    uint64_t positions[64];
+    for (size_t b = 0; b < buckets.size(); b++) {
+        size_t start = buckets[b].first;
+        size_t count = buckets[b].second - start;
+
+        // Search the first pilot that sends every key of the bucket to a distinct free slot
+        bool found = false;
+        for (uint64_t pilot = 0; pilot < max_pilots && !found; pilot++) {
+            size_t placed = 0;
+            for (; placed < count; placed++) {
+                uint64_t pos = detail::phf_position(_items[order[start + placed]].hash, (uint32_t) pilot, header);
+                if (taken[pos]) break;
+                taken[pos] = true;
+                positions[placed] = pos;
+            }
+            if (placed == count) {
+                pilots[bucket_of[order[start]]] = (uint32_t) pilot;
+                found = true;
+                break;
+            }
+            // Undo the partial placement
+            for (size_t k = 0; k < placed; k++) {
+                taken[positions[k]] = false;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* -- Index -- */
+
+template <typename V>
+mstd::perfect_hash_index<V>::perfect_hash_index(const std::string &path) {
+    static_assert(alignof(V) <= 8, "perfect_hash_index values can't need more than 8-byte alignment");
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(perfect_hash_header)) {
+        close(fd);
+        throw std::runtime_error("Not a perfect hash index: " + path);
+    }
+
+    _map_size = (size_t) st.st_size;
+    _map = mmap(nullptr, _map_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping outlives the descriptor
+    close(fd);
+    if (_map == MAP_FAILED) {
+        throw std::runtime_error("Could not map " + path);
+    }
+
+    memcpy(&_header, _map, sizeof(_header));
+    size_t pilots_bytes = detail::phf_pilots_bytes(_header.num_buckets);
+    if (memcmp(_header.magic, perfect_hash_constants::magic, sizeof(_header.magic)) != 0
+        || _header.value_size != sizeof(V)
+        || _header.slot_size != sizeof(perfect_hash_slot<V>)
+        || _map_size != sizeof(perfect_hash_header) + pilots_bytes + _header.num_keys * _header.slot_size) {
+        munmap(_map, _map_size);
+        throw std::runtime_error("Not a perfect hash index of this value type: " + path);
+    }
+
+    const char *base = (const char *) _map;
+    _pilots = (const uint32_t *) (base + sizeof(perfect_hash_header));
+    _slots = (const perfect_hash_slot<V> *) (base + sizeof(perfect_hash_header) + pilots_bytes);
+}
+
+template <typename V>
+mstd::perfect_hash_index<V>::~perfect_hash_index() {
+    munmap(_map, _map_size);
+}
+
+template <typename V>
+const V *mstd::perfect_hash_index<V>::find(string_view key) const {
+    if (_header.num_keys == 0) return nullptr;
+
+    uint64_t h[2];
+    murmur3_128(key.data(), key.length(), 0, h);
+
+    const perfect_hash_slot<V> &slot = _slots[detail::phf_position(h[0], _pilots[detail::phf_bucket(h[0], _header)], _header)];
+    return slot.fingerprint == h[1] ? &slot.value : nullptr;
+}
+
+template <typename V>
+const V &mstd::perfect_hash_index<V>::get(string_view key) const {
+    const V *value = find(key);
+    if (value == nullptr) {
+        throw std::runtime_error("Key does not exist");
+    }
+    return *value;
+}
+
+template <typename V>
+bool mstd::perfect_hash_index<V>::contains(string_view key) const {
+    return find(key) != nullptr;
+}
+
+template <typename V>
+size_t mstd::perfect_hash_index<V>::size() const {
+    return _header.num_keys;
+}
+
+template <typename V>
+size_t mstd::perfect_hash_index<V>::size_in_bytes() const {
+    return _map_size;
+}
+
+#endif // PERFECT_HASH_INDEX_HPP
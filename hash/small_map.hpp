@@ -0,0 +1,272 @@
+#ifndef SMALL_MAP_HPP
+#define SMALL_MAP_HPP
+
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "hash_functions.hpp"
+#include "flat_hash_map.hpp"
+#include "memory_resource.hpp"
+
+namespace small_map_constants {
+    const size_t default_inline_capacity = 8;
+}
+
+namespace mstd {
+    // Map for (mostly) tiny key sets. Up to N entries live inline, inside the map object itself: keys in one
+    // contiguous array, values in another, so that a lookup is a linear scan over a cache line or two of keys
+    // and an empty or small map doesn't allocate at all.
+    // The (N+1)-th distinct key moves every entry into a flat_hash_map, which the map keeps using until clear().
+    // Pointers to values are invalidated by insertions that cause that switch, and by erase while small.
+    // The flat_hash_map, and its storage, come from a memory_resource
+    template <typename K, typename V, size_t N = small_map_constants::default_inline_capacity,
+              typename H = mstd::hasher<K>>
+    class small_map {
+    public:
+        explicit small_map(memory_resource *resource = default_resource());
+        small_map(const small_map &)=delete;
+        small_map(small_map &&other) noexcept;
+
+        ~small_map();
+
+        // Returns false (and leaves the existing value untouched) if the key already exists
+        bool insert(const K &key, const V &value);
+
+        // Inserts a default constructed value if the key doesn't exist
+        V &operator[](const K &key);
+
+        V &get(const K &key) const;
+
+        // Returns nullptr if the key doesn't exist
+        V *find(const K &key) const;
+
+        bool contains(const K &key) const;
+
+        // Returns false if the key didn't exist
+        bool erase(const K &key);
+
+        // Frees the hash table (if any) and goes back to inline storage
+        void clear();
+
+        size_t size() const;
+
+        bool empty() const;
+
+        // True while the entries are stored inline
+        bool is_small() const;
+
+        small_map &operator=(const small_map &)=delete;
+    private:
+        typedef typename std::aligned_storage<sizeof(K), alignof(K)>::type key_storage;
+        typedef typename std::aligned_storage<sizeof(V), alignof(V)>::type value_storage;
+
+        key_storage _keys[N];
+        value_storage _values[N];
+        size_t _size;
+        // nullptr while the map is small
+        flat_hash_map<K, V, H> *_large;
+        memory_resource *_resource;
+
+        K &_key(size_t index) const;
+        V &_value(size_t index) const;
+
+        // Returns the inline index of the key, or _size if it doesn't exist
+        size_t _find_index(const K &key) const;
+
+        void _destroy_inline();
+
+        // Moves the inline entries into a new flat_hash_map
+        void _grow();
+
+        void _free_large();
+    };
+}
+
+template <typename K, typename V, size_t N, typename H>
+mstd::small_map<K, V, N, H>::small_map(memory_resource *resource) : _size(0), _large(nullptr), _resource(resource) {
+    static_assert(N > 0, "small_map needs room for at least one inline entry");
+}
+
+template <typename K, typename V, size_t N, typename H>
+mstd::small_map<K, V, N, H>::small_map(small_map &&other) noexcept
+        : _size(other._size), _large(other._large), _resource(other._resource) {
+    if (_large == nullptr) {
+        for (size_t i = 0; i < _size; i++) {
+            new (&_keys[i]) K(std::move(other._key(i)));
+            new (&_values[i]) V(std::move(other._value(i)));
+        }
+        other._destroy_inline();
+    }
+    other._size = 0;
+    other._large = nullptr;
+}
+
+template <typename K, typename V, size_t N, typename H>
+mstd::small_map<K, V, N, H>::~small_map() {
+    _destroy_inline();
+    _free_large();
+}
+
+template <typename K, typename V, size_t N, typename H>
+bool mstd::small_map<K, V, N, H>::insert(const K &key, const V &value) {
+    if (_large != nullptr) {
+        return _large->insert(key, value);
+    }
+
+    if (_find_index(key) != _size) {
+        return false;
+    }
+
+    if (_size == N) {
+        _grow();
+        return _large->insert(key, value);
+    }
+
+    new (&_keys[_size]) K(key);
+    new (&_values[_size]) V(value);
+    _size++;
+    return true;
+}
+
+template <typename K, typename V, size_t N, typename H>
+V &mstd::small_map<K, V, N, H>::operator[](const K &key) {
+    if (_large == nullptr) {
+        size_t index = _find_index(key);
+        if (index != _size) {
+            return _value(index);
+        }
+        if (_size < N) {
+            new (&_keys[_size]) K(key);
+            new (&_values[_size]) V();
+            return _value(_size++);
+        }
+        _grow();
+    }
+
+    return (*_large)[key];
+}
+
+template <typename K, typename V, size_t N, typename H>
+V &mstd::small_map<K, V, N, H>::get(const K &key) const {
+    V *v = find(key);
+    if (v == nullptr) {
+        throw std::runtime_error("Key does not exist");
+    }
+
+    return *v;
+}
+
+template <typename K, typename V, size_t N, typename H>
+V *mstd::small_map<K, V, N, H>::find(const K &key) const {
+    if (_large != nullptr) {
+        return _large->find(key);
+    }
+
+    size_t index = _find_index(key);
+    return index == _size ? nullptr : &_value(index);
+}
+
+template <typename K, typename V, size_t N, typename H>
+bool mstd::small_map<K, V, N, H>::contains(const K &key) const {
+    return find(key) != nullptr;
+}
+
+template <typename K, typename V, size_t N, typename H>
+bool mstd::small_map<K, V, N, H>::erase(const K &key) {
+    if (_large != nullptr) {
+        return _large->erase(key);
+    }
+
+    size_t index = _find_index(key);
+    if (index == _size) {
+        return false;
+    }
+
+    // Order doesn't matter: fill the gap with the last entry
+    size_t last = _size - 1;
+    if (index != last) {
+        _key(index) = std::move(_key(last));
+        _value(index) = std::move(_value(last));
+    }
+    _key(last).~K();
+    _value(last).~V();
+    _size--;
+
+    return true;
+}
+
+template <typename K, typename V, size_t N, typename H>
+void mstd::small_map<K, V, N, H>::clear() {
+    _destroy_inline();
+    _free_large();
+}
+
+template <typename K, typename V, size_t N, typename H>
+size_t mstd::small_map<K, V, N, H>::size() const {
+    return _large != nullptr ? _large->size() : _size;
+}
+
+template <typename K, typename V, size_t N, typename H>
+bool mstd::small_map<K, V, N, H>::empty() const {
+    return size() == 0;
+}
+
+template <typename K, typename V, size_t N, typename H>
+bool mstd::small_map<K, V, N, H>::is_small() const {
+    return _large == nullptr;
+}
+
+template <typename K, typename V, size_t N, typename H>
+K &mstd::small_map<K, V, N, H>::_key(size_t index) const {
+    return *reinterpret_cast<K *>(const_cast<key_storage *>(&_keys[index]));
+}
+
+template <typename K, typename V, size_t N, typename H>
+V &mstd::small_map<K, V, N, H>::_value(size_t index) const {
+    return *reinterpret_cast<V *>(const_cast<value_storage *>(&_values[index]));
+}
+
+// Keys are contiguous, so for small integral keys this loop is a handful of cache-resident compares
+template <typename K, typename V, size_t N, typename H>
+size_t mstd::small_map<K, V, N, H>::_find_index(const K &key) const {
+    for (size_t i = 0; i < _size; i++) {
+        if (_key(i) == key) {
+            return i;
+        }
+    }
+
+    return _size;
+}
+
+template <typename K, typename V, size_t N, typename H>
+void mstd::small_map<K, V, N, H>::_destroy_inline() {
+    for (size_t i = 0; i < _size; i++) {
+        _key(i).~K();
+        _value(i).~V();
+    }
+    _size = 0;
+}
+
+template <typename K, typename V, size_t N, typename H>
+void mstd::small_map<K, V, N, H>::_grow() {
+    void *p = _resource->allocate(sizeof(flat_hash_map<K, V, H>), alignof(flat_hash_map<K, V, H>));
+    _large = new (p) flat_hash_map<K, V, H>(2 * N, _resource);
+    for (size_t i = 0; i < _size; i++) {
+        _large->insert(_key(i), _value(i));
+    }
+    _destroy_inline();
+}
+
+template <typename K, typename V, size_t N, typename H>
+void mstd::small_map<K, V, N, H>::_free_large() {
+    if (_large == nullptr) return;
+
+    typedef flat_hash_map<K, V, H> large_type;
+    _large->~large_type();
+    _resource->deallocate(_large, sizeof(large_type), alignof(large_type));
+    _large = nullptr;
+}
+
+#endif // SMALL_MAP_HPP
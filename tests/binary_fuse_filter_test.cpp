@@ -0,0 +1,87 @@
+#include <string>
+#include "binary_fuse_filter.hpp"
+#include "thread_pool.hpp"
+#include "test.hpp"
+
+static mstd::vector<std::string> to_mvector(const std::vector<std::string> &keys) {
+    mstd::vector<std::string> v(keys.size());
+    for (const std::string &key : keys) {
+        v.push(key);
+    }
+    return v;
+}
+
+// Fraction of n keys that were never added and still pass
+template <typename F>
+static double false_positive_rate(const binary_fuse_filter<F> &filter, size_t n) {
+    std::vector<std::string> others = test::distinct_strings(n, "other");
+    size_t positives = 0;
+    for (const std::string &key : others) {
+        positives += filter.check(key);
+    }
+    return (double) positives / n;
+}
+
+TEST(no_false_negatives) {
+    const size_t sizes[] = {1, 2, 3, 10, 100, 1000, 4096, 50000};
+    for (size_t n : sizes) {
+        std::vector<std::string> keys = test::distinct_strings(n);
+        binary_fuse_filter<uint8_t> filter(to_mvector(keys));
+        CHECK(filter.size() == n);
+        size_t missing = 0;
+        for (const std::string &key : keys) {
+            missing += !filter.check(key);
+        }
+        CHECK(missing == 0);
+    }
+}
+
+TEST(empty_key_set) {
+    mstd::vector<std::string> none;
+    binary_fuse_filter<uint8_t> filter(none);
+    CHECK(filter.size() == 0);
+    CHECK(!filter.check("anything"));
+}
+
+TEST(duplicates_are_ignored) {
+    std::vector<std::string> keys = test::distinct_strings(5000);
+    std::vector<std::string> with_duplicates = keys;
+    for (size_t i = 0; i < 2000; i++) {
+        with_duplicates.push_back(keys[test::random(keys.size())]);
+    }
+    binary_fuse_filter<uint8_t> filter(to_mvector(with_duplicates));
+    CHECK(filter.size() == keys.size());
+    for (const std::string &key : keys) {
+        REQUIRE(filter.check(key));
+    }
+}
+
+TEST(false_positive_rate_8_bits) {
+    binary_fuse_filter<uint8_t> filter(to_mvector(test::distinct_strings(20000)));
+    // ~1 / 256
+    CHECK(false_positive_rate(filter, 100000) < 0.008);
+    CHECK(filter.bits_per_key() < 8 * 1.25);
+}
+
+TEST(false_positive_rate_16_bits) {
+    binary_fuse_filter<uint16_t> filter(to_mvector(test::distinct_strings(20000)));
+    CHECK(false_positive_rate(filter, 100000) < 0.0005);
+    CHECK(filter.bits_per_key() < 16 * 1.25);
+}
+
+TEST(parallel_build_matches_serial) {
+    // Above fuse_constants::parallel_threshold, so that the pool hashes the keys
+    std::vector<std::string> keys = test::distinct_strings(fuse_constants::parallel_threshold + 1000);
+    mstd::vector<std::string> v = to_mvector(keys);
+    thread_pool pool(4);
+    binary_fuse_filter<uint8_t> parallel(v, &pool);
+    binary_fuse_filter<uint8_t> serial(v);
+    CHECK(parallel.size() == serial.size());
+    for (const std::string &key : keys) {
+        REQUIRE(parallel.check(key));
+    }
+    std::vector<std::string> others = test::distinct_strings(20000, "other");
+    for (const std::string &key : others) {
+        REQUIRE(parallel.check(key) == serial.check(key));
+    }
+}
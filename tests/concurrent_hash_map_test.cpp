@@ -0,0 +1,156 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "concurrent_hash_map.hpp"
+#include "test.hpp"
+
+const int num_threads = 4;
+
+TEST(random_operations_against_unordered_map) {
+    mstd::concurrent_hash_map<int, int> map;
+    std::unordered_map<int, int> model;
+    for (int op = 0; op < 100000; op++) {
+        int key = (int) test::random(10000);
+        int value = (int) test::random(1000000);
+        switch (test::random(4)) {
+            case 0:
+                REQUIRE(map.insert(key, value) == model.emplace(key, value).second);
+                break;
+            case 1:
+                REQUIRE(map.insert_or_assign(key, value) == (model.count(key) == 0));
+                model[key] = value;
+                break;
+            case 2:
+                REQUIRE(map.erase(key) == (model.erase(key) == 1));
+                break;
+            default: {
+                int out = -1;
+                REQUIRE(map.find(key, out) == (model.count(key) == 1));
+                if (model.count(key) == 1) REQUIRE(out == model[key]);
+                break;
+            }
+        }
+    }
+    CHECK(map.size() == model.size());
+    for (const auto &item : model) {
+        REQUIRE(map.get(item.first) == item.second);
+    }
+    CHECK_THROWS(map.get(-1), std::runtime_error);
+}
+
+// Writers fill disjoint key ranges (resizing the table as they go) while readers look keys up
+TEST(concurrent_inserts_and_reads) {
+    const int per_thread = 20000;
+    mstd::concurrent_hash_map<int, std::string> map;
+    std::atomic<bool> done(false);
+    std::atomic<int> bad_reads(0);
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; t++) {
+        readers.emplace_back([&map, &done, &bad_reads]() {
+            int key = 0;
+            while (!done.load()) {
+                std::string value;
+                // A key is either missing or has its full value: never a torn one
+                if (map.find(key, value) && value != std::to_string(key)) {
+                    bad_reads++;
+                }
+                key = (key + 7919) % (num_threads * per_thread);
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < num_threads; t++) {
+        writers.emplace_back([&map, t]() {
+            for (int i = t * per_thread; i < (t + 1) * per_thread; i++) {
+                map.insert(i, std::to_string(i));
+            }
+        });
+    }
+    for (std::thread &w : writers) w.join();
+    done.store(true);
+    for (std::thread &r : readers) r.join();
+
+    CHECK(bad_reads.load() == 0);
+    CHECK(map.size() == (size_t) (num_threads * per_thread));
+    CHECK(map.bucket_count() >= map.size());
+    for (int i = 0; i < num_threads * per_thread; i++) {
+        REQUIRE(map.get(i) == std::to_string(i));
+    }
+}
+
+// Every thread tries to insert every key: each key is inserted by exactly one of them
+TEST(racing_inserts_of_the_same_keys) {
+    const int keys = 20000;
+    mstd::concurrent_hash_map<int, int> map;
+    std::atomic<int> inserted(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&map, &inserted, t]() {
+            for (int i = 0; i < keys; i++) {
+                if (map.insert(i, t)) inserted++;
+            }
+        });
+    }
+    for (std::thread &t : threads) t.join();
+
+    CHECK(inserted.load() == keys);
+    CHECK(map.size() == (size_t) keys);
+}
+
+// Threads update, erase and re-insert their own keys while others read them: at the end every key holds
+// exactly what its owner wrote last
+TEST(concurrent_updates_and_erases) {
+    const int per_thread = 2000;
+    mstd::concurrent_hash_map<int, int> map;
+    std::vector<std::vector<int>> expected(num_threads, std::vector<int>(per_thread, -1));
+    std::vector<uint64_t> seeds;
+    for (int t = 0; t < num_threads; t++) {
+        seeds.push_back(test::rng()());
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&map, &expected, &seeds, t]() {
+            std::mt19937_64 rng(seeds[t]);
+            std::vector<int> &mine = expected[t];
+            for (int op = 0; op < 50000; op++) {
+                int i = (int) (rng() % per_thread);
+                int key = t * per_thread + i;
+                int value = (int) (rng() % 1000);
+                switch (rng() % 3) {
+                    case 0:
+                        map.insert_or_assign(key, value);
+                        mine[i] = value;
+                        break;
+                    case 1:
+                        map.erase(key);
+                        mine[i] = -1;
+                        break;
+                    default: {
+                        // Someone else's key: only checks that reading doesn't crash
+                        int out;
+                        map.find((int) (rng() % (num_threads * per_thread)), out);
+                        break;
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread &t : threads) t.join();
+
+    size_t live = 0;
+    for (int t = 0; t < num_threads; t++) {
+        for (int i = 0; i < per_thread; i++) {
+            int out = -1;
+            bool found = map.find(t * per_thread + i, out);
+            REQUIRE(found == (expected[t][i] != -1));
+            if (found) REQUIRE(out == expected[t][i]);
+            live += found;
+        }
+    }
+    CHECK(map.size() == live);
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "concurrent_stack.hpp"
+#include "epoch.hpp"
+#include "test.hpp"
+
+const int num_threads = 4;
+
+TEST(single_thread_order) {
+    mstd::concurrent_stack<int> stack;
+    CHECK(stack.empty());
+    int out;
+    CHECK(!stack.try_pop(out));
+    CHECK_THROWS(stack.pop(), std::runtime_error);
+
+    stack.push(1);
+    std::vector<int> batch = {2, 3, 4};
+    stack.push_all(batch.begin(), batch.end());
+    stack.push(5);
+    CHECK(stack.pop() == 5);
+    CHECK(stack.try_pop(out) && out == 4);
+
+    mstd::vector<int> rest;
+    CHECK(stack.pop_all(rest) == 3);
+    CHECK(rest.size() == 3);
+    CHECK(rest[0] == 3 && rest[1] == 2 && rest[2] == 1);
+    CHECK(stack.empty());
+}
+
+// Threads push disjoint values (one by one and in batches) while others pop: every value comes out exactly once
+TEST(every_value_popped_once) {
+    const int per_thread = 50000;
+    mstd::concurrent_stack<int> stack;
+    std::atomic<int> producers_left(num_threads);
+    std::vector<std::vector<int>> popped(num_threads);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&stack, &producers_left, t]() {
+            int i = t * per_thread;
+            while (i < (t + 1) * per_thread) {
+                if (i % 7 == 0) {
+                    std::vector<int> batch;
+                    for (int k = 0; k < 10 && i < (t + 1) * per_thread; k++) {
+                        batch.push_back(i++);
+                    }
+                    stack.push_all(batch.begin(), batch.end());
+                } else {
+                    stack.push(i++);
+                }
+            }
+            producers_left--;
+        });
+    }
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&stack, &producers_left, &popped, t]() {
+            std::vector<int> &mine = popped[t];
+            int value;
+            mstd::vector<int> chunk;
+            for (;;) {
+                bool done = producers_left.load() == 0;
+                if (mine.size() % 101 == 0) {
+                    chunk.clear();
+                    stack.pop_all(chunk);
+                    mine.insert(mine.end(), chunk.begin(), chunk.end());
+                }
+                if (stack.try_pop(value)) {
+                    mine.push_back(value);
+                } else if (done) {
+                    break;
+                }
+            }
+        });
+    }
+    for (std::thread &t : threads) t.join();
+
+    std::vector<int> all;
+    for (const std::vector<int> &p : popped) {
+        all.insert(all.end(), p.begin(), p.end());
+    }
+    std::sort(all.begin(), all.end());
+    REQUIRE(all.size() == (size_t) (num_threads * per_thread));
+    for (int i = 0; i < num_threads * per_thread; i++) {
+        REQUIRE(all[i] == i);
+    }
+    CHECK(stack.empty());
+}
+
+// Values left on the stack are destroyed with it, and popped nodes are freed once the epoch moves on
+TEST(nodes_are_freed) {
+    long live = test::tracked::live();
+    {
+        mstd::concurrent_stack<test::tracked> stack;
+        for (int i = 0; i < 1000; i++) {
+            stack.push(test::tracked(i));
+        }
+        for (int i = 0; i < 500; i++) {
+            REQUIRE(stack.pop().value == 999 - i);
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        mstd::epoch::collect();
+    }
+    CHECK(test::tracked::live() == live);
+}
+
+TEST(epoch_defers_deletion_while_pinned) {
+    long live = test::tracked::live();
+    uint64_t start = mstd::epoch::current();
+    {
+        mstd::epoch::guard g;
+        mstd::epoch::retire(new test::tracked(1));
+        // Another thread can't free it either while we're pinned
+        std::thread other([]() {
+            for (int i = 0; i < 4; i++) {
+                mstd::epoch::collect();
+            }
+        });
+        other.join();
+        for (int i = 0; i < 4; i++) {
+            mstd::epoch::collect();
+        }
+        CHECK(test::tracked::live() == live + 1);
+        CHECK(mstd::epoch::current() <= start + 1);
+    }
+    for (int i = 0; i < 4; i++) {
+        mstd::epoch::collect();
+    }
+    CHECK(test::tracked::live() == live);
+}
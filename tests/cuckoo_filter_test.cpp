@@ -0,0 +1,113 @@
+#include <string>
+#include <unordered_map>
+#include "cuckoo_filter.hpp"
+#include "test.hpp"
+
+// Fraction of n keys that were never inserted and still pass
+template <typename F>
+static double false_positive_rate(const cuckoo_filter<F> &filter, size_t n) {
+    std::vector<std::string> others = test::distinct_strings(n, "other");
+    size_t positives = 0;
+    for (const std::string &key : others) {
+        positives += filter.check(key);
+    }
+    return (double) positives / n;
+}
+
+TEST(no_false_negatives) {
+    const size_t sizes[] = {1, 10, 1000, 50000};
+    for (size_t n : sizes) {
+        cuckoo_filter<uint8_t> filter(n);
+        std::vector<std::string> keys = test::distinct_strings(n);
+        for (const std::string &key : keys) {
+            REQUIRE(filter.insert(key));
+        }
+        CHECK(filter.size() == n);
+        for (const std::string &key : keys) {
+            REQUIRE(filter.check(key));
+        }
+    }
+}
+
+// Random inserts (with duplicates) and removes of inserted words: every word still inserted at least once passes.
+// A word's copies all go to the same two buckets, so it's inserted at most max_copies times
+TEST(random_inserts_and_removes) {
+    const size_t capacity = 20000;
+    const int max_copies = 3;
+    cuckoo_filter<uint16_t> filter(capacity);
+    std::vector<std::string> words = test::distinct_strings(capacity / 2);
+    std::unordered_map<std::string, int> copies;
+    size_t total = 0;
+
+    for (size_t op = 0; op < 100000; op++) {
+        const std::string &word = words[test::random(words.size())];
+        int &n = copies[word];
+        if (test::random(3) != 0 && total < capacity && n < max_copies) {
+            REQUIRE(filter.insert(word));
+            n++;
+            total++;
+        } else if (n > 0) {
+            REQUIRE(filter.remove(word));
+            n--;
+            total--;
+        }
+    }
+
+    CHECK(filter.size() == total);
+    for (const auto &item : copies) {
+        if (item.second > 0) {
+            REQUIRE(filter.check(item.first));
+        }
+    }
+
+    // Removing every copy empties the filter
+    for (const auto &item : copies) {
+        for (int i = 0; i < item.second; i++) {
+            REQUIRE(filter.remove(item.first));
+        }
+    }
+    CHECK(filter.size() == 0);
+}
+
+TEST(remove_of_missing_word) {
+    cuckoo_filter<uint16_t> filter(100);
+    CHECK(!filter.remove("missing"));
+    CHECK(filter.insert("present"));
+    CHECK(filter.remove("present"));
+    CHECK(!filter.remove("present"));
+}
+
+TEST(false_positive_rate_8_bits) {
+    const size_t n = 20000;
+    cuckoo_filter<uint8_t> filter(n);
+    for (const std::string &key : test::distinct_strings(n)) {
+        REQUIRE(filter.insert(key));
+    }
+    // ~3% at full load
+    CHECK(false_positive_rate(filter, 100000) < 0.05);
+}
+
+TEST(false_positive_rate_16_bits) {
+    const size_t n = 20000;
+    cuckoo_filter<uint16_t> filter(n);
+    for (const std::string &key : test::distinct_strings(n)) {
+        REQUIRE(filter.insert(key));
+    }
+    CHECK(false_positive_rate(filter, 100000) < 0.001);
+}
+
+// Past its capacity the filter eventually refuses words, and never loses the ones it accepted
+TEST(full_filter) {
+    cuckoo_filter<uint8_t> filter(1000);
+    std::vector<std::string> keys = test::distinct_strings(filter.capacity() * 2);
+    size_t accepted = 0;
+    for (; accepted < keys.size(); accepted++) {
+        if (!filter.insert(keys[accepted])) break;
+    }
+    CHECK(accepted < keys.size());
+    CHECK(accepted >= 1000);
+    CHECK(filter.load_factor() <= 1.0);
+    for (size_t i = 0; i < accepted; i++) {
+        REQUIRE(filter.check(keys[i]));
+    }
+}
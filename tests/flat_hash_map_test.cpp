@@ -0,0 +1,129 @@
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "flat_hash_map.hpp"
+#include "test.hpp"
+
+// Sends every key to one of a handful of hashes: long probe sequences, and groups full of tombstones
+struct colliding_hasher {
+    uint64_t operator()(int key) const {
+        return mstd::hash_u64((uint64_t) (key % 5));
+    }
+};
+
+template <typename M, typename K, typename V>
+static void check_same(const M &map, const std::unordered_map<K, V> &model) {
+    REQUIRE(map.size() == model.size());
+    for (const auto &item : model) {
+        V *v = map.find(item.first);
+        REQUIRE(v != nullptr);
+        REQUIRE(*v == item.second);
+    }
+}
+
+// Random inserts, updates and erases against std::unordered_map
+template <typename H>
+static void random_operations(size_t key_range, size_t ops) {
+    test::counting_resource resource;
+    {
+        mstd::flat_hash_map<int, int, H> map(16, &resource);
+        std::unordered_map<int, int> model;
+        for (size_t op = 0; op < ops; op++) {
+            int key = (int) test::random(key_range);
+            int value = (int) test::random(1000000);
+            switch (test::random(5)) {
+                case 0:
+                case 1:
+                    REQUIRE(map.insert(key, value) == model.emplace(key, value).second);
+                    break;
+                case 2:
+                    map[key] = value;
+                    model[key] = value;
+                    break;
+                case 3:
+                    REQUIRE(map.erase(key) == (model.erase(key) == 1));
+                    break;
+                default:
+                    REQUIRE(map.contains(key) == (model.count(key) == 1));
+                    break;
+            }
+            REQUIRE(map.size() == model.size());
+        }
+        check_same(map, model);
+        for (size_t key = 0; key < key_range; key++) {
+            REQUIRE(map.contains((int) key) == (model.count((int) key) == 1));
+        }
+    }
+    CHECK(resource.allocations() == 0);
+}
+
+TEST(random_operations_against_unordered_map) {
+    random_operations<mstd::hasher<int>>(5000, 200000);
+}
+
+TEST(random_operations_with_colliding_hashes) {
+    random_operations<colliding_hasher>(300, 30000);
+}
+
+// Erase-heavy use with a steady size: tombstones have to be reclaimed, not accumulated forever
+TEST(insert_erase_churn) {
+    mstd::flat_hash_map<int, int> map;
+    for (int round = 0; round < 100000; round++) {
+        REQUIRE(map.insert(round, round));
+        if (round >= 100) {
+            REQUIRE(map.erase(round - 100));
+        }
+    }
+    CHECK(map.size() == 100);
+    CHECK(map.capacity() <= 1024);
+    for (int key = 100000 - 100; key < 100000; key++) {
+        REQUIRE(map.get(key) == key);
+    }
+}
+
+TEST(string_keys) {
+    std::vector<std::string> keys = test::distinct_strings(20000);
+    mstd::flat_hash_map<std::string, size_t> map;
+    for (size_t i = 0; i < keys.size(); i++) {
+        REQUIRE(map.insert(keys[i], i));
+        REQUIRE(!map.insert(keys[i], i + 1));
+    }
+    for (size_t i = 0; i < keys.size(); i += 2) {
+        REQUIRE(map.erase(keys[i]));
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+        REQUIRE(map.contains(keys[i]) == (i % 2 == 1));
+    }
+    CHECK_THROWS(map.get(keys[0]), std::runtime_error);
+}
+
+TEST(reserve_avoids_rehashing) {
+    mstd::flat_hash_map<int, int> map;
+    map.reserve(10000);
+    size_t capacity = map.capacity();
+    for (int i = 0; i < 10000; i++) {
+        map.insert(i, i);
+    }
+    CHECK(map.capacity() == capacity);
+}
+
+TEST(clear_and_move) {
+    test::counting_resource resource;
+    {
+        mstd::flat_hash_map<std::string, std::string> map(16, &resource);
+        for (int i = 0; i < 1000; i++) {
+            map[std::to_string(i)] = std::string(40, 'x');
+        }
+        map.clear();
+        CHECK(map.empty());
+        CHECK(!map.contains("1"));
+        map["a"] = "b";
+
+        mstd::flat_hash_map<std::string, std::string> moved(std::move(map));
+        CHECK(moved.get("a") == "b");
+        CHECK(map.empty());
+        map["c"] = "d";
+        CHECK(map.get("c") == "d");
+    }
+    CHECK(resource.allocations() == 0);
+}
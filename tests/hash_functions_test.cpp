@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include "hash_functions.hpp"
+#include "test.hpp"
+
+static std::string random_bytes(size_t length) {
+    std::string s(length, '\0');
+    for (size_t i = 0; i < length; i++) {
+        s[i] = (char) test::random(256);
+    }
+    return s;
+}
+
+static int popcount(uint64_t x) {
+    return __builtin_popcountll(x);
+}
+
+// Published MurmurHash3_x64_128 results
+TEST(murmur3_reference_values) {
+    uint64_t out[2];
+    const char *fox = "The quick brown fox jumps over the lazy dog";
+    mstd::murmur3_128(fox, strlen(fox), 0, out);
+    CHECK(out[0] == 0xe34bbc7bbc071b6cLLU);
+    CHECK(out[1] == 0x7a433ca9c49a9347LLU);
+
+    mstd::murmur3_128("hello", 5, 0, out);
+    CHECK(out[0] == 0xcbd8a7b341bd9b02LLU);
+    CHECK(out[1] == 0x5b1e906a48ae1d19LLU);
+
+    mstd::murmur3_128("", 0, 0, out);
+    CHECK(out[0] == 0 && out[1] == 0);
+    CHECK(mstd::murmur3_64(fox, strlen(fox)) == 0xe34bbc7bbc071b6cLLU);
+}
+
+// Keys are read in place: the hash can't depend on where the key is
+TEST(hash_is_independent_of_alignment) {
+    char buffer[256 + 16];
+    for (size_t length = 0; length <= 256; length++) {
+        std::string key = random_bytes(length);
+        uint64_t expected = mstd::fast_hash64(key.data(), length, 7);
+        uint64_t expected_murmur = mstd::murmur3_64(key.data(), length, 7);
+        for (size_t offset = 0; offset < 16; offset++) {
+            memcpy(buffer + offset, key.data(), length);
+            REQUIRE(mstd::fast_hash64(buffer + offset, length, 7) == expected);
+            REQUIRE(mstd::murmur3_64(buffer + offset, length, 7) == expected_murmur);
+        }
+    }
+}
+
+TEST(fast_hash128_extends_fast_hash64) {
+    for (size_t length = 0; length <= 200; length++) {
+        std::string key = random_bytes(length);
+        uint64_t out[2];
+        mstd::fast_hash128(key.data(), length, 3, out);
+        REQUIRE(out[0] == mstd::fast_hash64(key.data(), length, 3));
+    }
+}
+
+// Every length goes through a different read pattern: check each one for collisions and seed sensitivity
+TEST(no_collisions_across_lengths) {
+    std::unordered_set<uint64_t> seen;
+    size_t inserted = 0;
+    for (size_t length = 0; length <= 100; length++) {
+        for (int i = 0; i < 200; i++) {
+            std::string key = random_bytes(length);
+            uint64_t h = mstd::fast_hash64(key.data(), length);
+            if (seen.insert(h).second) inserted++;
+            REQUIRE(h != mstd::fast_hash64(key.data(), length, 1) || length == 0);
+        }
+    }
+    // Short random keys repeat themselves (there are only 256 one-byte keys): allow for those
+    CHECK(inserted > 100 * 200 - 1000);
+}
+
+// Flipping any input bit flips about half of the output bits
+TEST(avalanche) {
+    const int trials = 200;
+    for (size_t length : {1, 3, 8, 16, 17, 33, 64, 100}) {
+        double total = 0;
+        int worst = 64;
+        for (int t = 0; t < trials; t++) {
+            std::string key = random_bytes(length);
+            uint64_t h = mstd::fast_hash64(key.data(), length);
+            size_t bit = test::random(length * 8);
+            key[bit / 8] ^= (char) (1 << (bit % 8));
+            int changed = popcount(h ^ mstd::fast_hash64(key.data(), length));
+            total += changed;
+            worst = std::min(worst, changed);
+        }
+        CHECK(total / trials > 28 && total / trials < 36);
+        CHECK(worst > 8);
+    }
+}
+
+TEST(integer_hash_avalanche) {
+    double total = 0;
+    for (int t = 0; t < 1000; t++) {
+        uint64_t key = test::rng()();
+        int bit = (int) test::random(64);
+        total += popcount(mstd::hash_u64(key) ^ mstd::hash_u64(key ^ (1LLU << bit)));
+    }
+    CHECK(total / 1000 > 30 && total / 1000 < 34);
+}
+
+// The vectorised integer kernel and the string loop give the same hashes as one key at a time
+TEST(hash_batch_matches_single_keys) {
+    for (size_t n = 0; n <= 67; n++) {
+        std::vector<uint64_t> keys(n);
+        std::vector<std::string> strings(n);
+        for (size_t i = 0; i < n; i++) {
+            keys[i] = test::rng()();
+            strings[i] = test::random_string(0, 40);
+        }
+        for (uint64_t seed : {0LLU, 42LLU}) {
+            std::vector<uint64_t> out(n + 1, 0xdead);
+            mstd::hash_batch(keys.data(), n, out.data(), seed);
+            for (size_t i = 0; i < n; i++) {
+                REQUIRE(out[i] == mstd::hash_u64(keys[i], seed));
+            }
+            // Nothing is written past out[n - 1]
+            REQUIRE(out[n] == 0xdead);
+
+            mstd::hash_batch(strings.data(), n, out.data(), seed);
+            for (size_t i = 0; i < n; i++) {
+                REQUIRE(out[i] == mstd::fast_hash64(strings[i].data(), strings[i].length(), seed));
+            }
+        }
+    }
+}
+
+// Heterogeneous lookups rely on every form of a string hashing the same
+TEST(string_hasher_overloads_agree) {
+    mstd::hasher<std::string> h;
+    for (int i = 0; i < 1000; i++) {
+        std::string s = test::random_string(0, 50);
+        REQUIRE(h(s) == h(s.c_str()));
+        REQUIRE(h(s) == h(mstd::string_view(s.data(), s.length())));
+        REQUIRE(h(s, 9) == h(mstd::string_view(s.data(), s.length()), 9));
+    }
+}
+
+TEST(integer_hasher) {
+    mstd::hasher<int> h;
+    mstd::hasher<uint64_t> h64;
+    CHECK(h(5) == mstd::hash_u64(5));
+    CHECK(h64(5) == h(5));
+    CHECK(h(-1) == mstd::hash_u64((uint64_t) -1));
+    CHECK(h(1) != h(1, 1));
+}
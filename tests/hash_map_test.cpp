@@ -0,0 +1,269 @@
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "hash_map.hpp"
+#include "memory_resource.hpp"
+#include "string_view.hpp"
+#include "thread_pool.hpp"
+#include "test.hpp"
+
+template <typename T, typename V, typename H>
+static void check_same(const hash_map<T, V, H> &map, const std::unordered_map<T, V> &model) {
+    REQUIRE(map.get_num_items() == model.size());
+    for (const auto &item : model) {
+        REQUIRE(map.get(item.first) == item.second);
+        REQUIRE(map.contains(item.first));
+        REQUIRE(*map.find(item.first) == item.second);
+    }
+}
+
+// Shape invariants of stats(): every bucket and every item is counted exactly once
+template <typename T, typename V, typename H>
+static void check_stats(const hash_map<T, V, H> &map) {
+    mstd::hash_stats st = map.stats();
+    REQUIRE(st.num_items == map.get_num_items());
+    REQUIRE(st.num_buckets == map.size());
+
+    size_t buckets = 0, items = 0, probed = 0;
+    for (size_t k = 0; k < st.bucket_occupancy.size(); k++) {
+        buckets += st.bucket_occupancy[k];
+        items += k * st.bucket_occupancy[k];
+    }
+    for (size_t k = 0; k < st.probe_lengths.size(); k++) {
+        probed += st.probe_lengths[k];
+    }
+    CHECK(buckets == st.num_buckets);
+    CHECK(items == st.num_items);
+    CHECK(probed == st.num_items);
+    CHECK(st.total_bytes == st.table_bytes + st.bucket_bytes + st.key_bytes);
+}
+
+// Enough splits to fill many directory segments, and to double the segment array several times
+TEST(grows_across_segments) {
+    hash_map<uint64_t, uint64_t> map(8);
+    std::unordered_map<uint64_t, uint64_t> model;
+    for (uint64_t i = 0; i < 200000; i++) {
+        // Distinct, and spread over the whole range
+        uint64_t key = i * 0x9e3779b97f4a7c15ULL;
+        map.insert(key, i);
+        model[key] = i;
+    }
+    CHECK(map.size() > 64 * hashmap_constants::segment_size);
+    check_same(map, model);
+}
+
+TEST(insert_throws_on_existing_key) {
+    hash_map<int, std::string> map;
+    map.insert(1, "one");
+    CHECK_THROWS(map.insert(1, "uno"), std::runtime_error);
+    CHECK(map.get(1) == "one");
+    CHECK_THROWS(map.get(2), std::runtime_error);
+    CHECK(map.find(2) == nullptr);
+    CHECK(!map.contains(2));
+}
+
+TEST(heterogeneous_lookup) {
+    hash_map<std::string, int> map;
+    map.insert("alpha", 1);
+    map.insert(std::string(100, 'b'), 2);
+    CHECK(map.get("alpha") == 1);
+    CHECK(map.get(mstd::string_view("alpha")) == 1);
+    std::string long_key(100, 'b');
+    CHECK(map.get(mstd::string_view(long_key.data(), long_key.length())) == 2);
+    CHECK(map.erase(mstd::string_view("alpha")));
+    CHECK_THROWS(map.get("alpha"), std::runtime_error);
+}
+
+TEST(custom_hasher) {
+    struct constant_hasher {
+        uint64_t operator()(int) const { return 42; }
+    };
+    // Every key in the same bucket: the map still works, just slowly
+    hash_map<int, int, constant_hasher> map;
+    for (int i = 0; i < 300; i++) {
+        map.insert(i, i * 2);
+    }
+    for (int i = 0; i < 300; i++) {
+        REQUIRE(map.get(i) == i * 2);
+    }
+    CHECK(map.stats().longest_probe == 300);
+}
+
+// Inserts, updates and erases against std::unordered_map. Erasing most of the map makes it merge buckets
+TEST(random_operations_against_unordered_map) {
+    test::counting_resource resource;
+    {
+        hash_map<int, int> map(8, mstd::hasher<int>(), &resource);
+        std::unordered_map<int, int> model;
+        for (int phase = 0; phase < 4; phase++) {
+            // Grow, then shrink back down
+            bool growing = phase % 2 == 0;
+            for (int op = 0; op < 30000; op++) {
+                int key = (int) test::random(20000);
+                int value = (int) test::random(1000000);
+                switch (test::random(growing ? 4 : 16)) {
+                    case 0:
+                        REQUIRE(map.try_emplace(key, value) == model.emplace(key, value).second);
+                        break;
+                    case 1:
+                        REQUIRE(map.insert_or_assign(key, value) == (model.count(key) == 0));
+                        model[key] = value;
+                        break;
+                    case 2:
+                        REQUIRE(map.emplace(key, value) == model.emplace(key, value).second);
+                        break;
+                    default:
+                        REQUIRE(map.erase(key) == (model.erase(key) == 1));
+                        break;
+                }
+            }
+            check_same(map, model);
+            check_stats(map);
+        }
+        CHECK(map.stats().merges > 0);
+    }
+    CHECK(resource.allocations() == 0);
+}
+
+// A map that empties completely goes back to its initial size
+TEST(erase_everything) {
+    hash_map<std::string, int> map(8);
+    std::vector<std::string> keys = test::distinct_strings(10000);
+    for (size_t i = 0; i < keys.size(); i++) {
+        map.insert(keys[i], (int) i);
+    }
+    CHECK(map.size() > 1000);
+    for (const std::string &key : keys) {
+        REQUIRE(map.erase(key));
+    }
+    CHECK(map.empty());
+    CHECK(map.size() == 8);
+    CHECK(!map.erase(keys[0]));
+    map.insert(keys[0], 1);
+    CHECK(map.get(keys[0]) == 1);
+}
+
+// Values are constructed in place, and left alone when the key exists
+TEST(try_emplace_does_not_move_from_args_on_existing_key) {
+    hash_map<int, std::string> map;
+    std::string value(50, 'v');
+    CHECK(map.try_emplace(1, std::move(value)));
+    std::string other(50, 'w');
+    CHECK(!map.try_emplace(1, std::move(other)));
+    CHECK(other == std::string(50, 'w'));
+    CHECK(map.get(1) == std::string(50, 'v'));
+}
+
+TEST(reserve_avoids_splits) {
+    hash_map<int, int> map;
+    map.reserve(50000);
+    size_t buckets = map.size();
+    size_t splits = map.stats().splits;
+    for (int i = 0; i < 50000; i++) {
+        map.insert(i, i);
+    }
+    CHECK(map.size() == buckets);
+    CHECK(map.stats().splits == splits);
+}
+
+static std::vector<std::pair<std::string, int>> random_pairs(size_t n, size_t distinct) {
+    std::vector<std::string> keys = test::distinct_strings(distinct);
+    std::vector<std::pair<std::string, int>> pairs;
+    for (size_t i = 0; i < n; i++) {
+        pairs.push_back(std::make_pair(keys[test::random(distinct)], (int) i));
+    }
+    return pairs;
+}
+
+// build() keeps the first occurrence of every key, whether it runs serially or on a pool
+static void check_build(mstd::memory_resource *resource, thread_pool *pool) {
+    size_t n = hashmap_constants::parallel_threshold * 2;
+    std::vector<std::pair<std::string, int>> pairs = random_pairs(n, n / 2);
+    std::unordered_map<std::string, int> model;
+    // Keys the map already holds are skipped too
+    hash_map<std::string, int> map(8, mstd::hasher<std::string>(), resource);
+    for (size_t i = 0; i < 1000; i++) {
+        map.try_emplace(pairs[i].first + "+", -1);
+        model.emplace(pairs[i].first + "+", -1);
+        map.try_emplace(pairs[i].first, -2);
+        model.emplace(pairs[i].first, -2);
+    }
+    size_t before = model.size();
+    for (const auto &p : pairs) {
+        model.emplace(p.first, p.second);
+    }
+
+    CHECK(map.build(pairs.begin(), pairs.end(), pool) == model.size() - before);
+    check_same(map, model);
+    check_stats(map);
+
+    // The map keeps working normally afterwards
+    map.insert("after build", 1);
+    CHECK(map.get("after build") == 1);
+}
+
+TEST(build_serial) {
+    check_build(mstd::slab_resource(), nullptr);
+}
+
+TEST(build_parallel) {
+    thread_pool pool(4);
+    check_build(mstd::slab_resource(), &pool);
+}
+
+
+// A hash with few distinct values shows up as long chains
+TEST(stats_reflect_hash_quality) {
+    struct few_values_hasher {
+        uint64_t operator()(int key) const { return mstd::hash_u64((uint64_t) (key % 64)); }
+    };
+    hash_map<int, int> good;
+    hash_map<int, int, few_values_hasher> poor;
+    for (int i = 0; i < 5000; i++) {
+        good.insert(i, i);
+        poor.insert(i, i);
+    }
+    check_stats(good);
+    check_stats(poor);
+    CHECK(good.stats().splits > 0);
+    CHECK(poor.stats().longest_probe > 2 * good.stats().longest_probe);
+    CHECK(poor.stats().average_probe > 2 * good.stats().average_probe);
+}
+// Neither resource is thread safe: build() has to do every allocation on the calling thread
+TEST(build_parallel_with_arena) {
+    thread_pool pool(4);
+    mstd::arena_resource arena;
+    check_build(&arena, &pool);
+}
+
+TEST(build_parallel_with_pool_resource) {
+    thread_pool pool(4);
+    mstd::pool_resource resource;
+    check_build(&resource, &pool);
+}
+
+TEST(copy_and_move) {
+    mstd::arena_resource arena;
+    hash_map<std::string, int> map(8, mstd::hasher<std::string>(), &arena);
+    std::unordered_map<std::string, int> model;
+    std::vector<std::string> keys = test::distinct_strings(5000);
+    for (size_t i = 0; i < keys.size(); i++) {
+        map.insert(keys[i], (int) i);
+        model.emplace(keys[i], (int) i);
+    }
+
+    hash_map<std::string, int> copy(map);
+    copy.insert("only in the copy", 0);
+    copy.erase(keys[0]);
+    check_same(map, model);
+    CHECK(copy.get_num_items() == map.get_num_items());
+    CHECK_THROWS(map.get("only in the copy"), std::runtime_error);
+
+    hash_map<std::string, int> moved(std::move(map));
+    check_same(moved, model);
+    CHECK(map.empty());
+    map.insert("reused", 1);
+    CHECK(map.get("reused") == 1);
+    check_stats(map);
+}
@@ -0,0 +1,74 @@
+#include <string>
+#include <unordered_map>
+#include "hash_table.hpp"
+#include "test.hpp"
+
+// Puts and lookups against std::unordered_map, checked in the middle of incremental growths too
+TEST(random_operations_against_unordered_map) {
+    test::counting_resource resource;
+    {
+        mstd::hash_table<int> table(8, &resource);
+        std::unordered_map<std::string, int> model;
+        std::vector<std::string> keys = test::distinct_strings(30000);
+        for (int op = 0; op < 100000; op++) {
+            const std::string &key = keys[test::random(op < 50000 ? keys.size() : 1000)];
+            if (test::random(2) == 0) {
+                int value = (int) test::random(1000000);
+                table.put(key, value);
+                model[key] = value;
+            } else {
+                const int *v = table.find(key);
+                REQUIRE((v != nullptr) == (model.count(key) == 1));
+                if (v != nullptr) REQUIRE(*v == model[key]);
+            }
+            REQUIRE(table.size() == model.size());
+        }
+        for (const auto &item : model) {
+            REQUIRE(table.get(item.first) == item.second);
+        }
+        CHECK(table.stats().splits > 0);
+    }
+    CHECK(resource.allocations() == 0);
+}
+
+TEST(lookups_take_string_views) {
+    mstd::hash_table<std::string> table;
+    std::string key = "some key";
+    table.put(key, "value");
+    key[0] = 'S';
+    // The table interned its own copy of the key
+    CHECK(table.contains("some key"));
+    CHECK(!table.contains(mstd::string_view(key.data(), key.length())));
+    const char text[] = "some key and more";
+    CHECK(table.get(mstd::string_view(text, 8)) == "value");
+    CHECK(table.find(mstd::string_view(text, 9)) == nullptr);
+    CHECK_THROWS(table.get("missing"), std::runtime_error);
+}
+
+TEST(empty_and_long_keys) {
+    mstd::hash_table<int> table;
+    std::string long_key(hash_table_constants::arena_block_size * 2, 'k');
+    table.put("", 1);
+    table.put(long_key, 2);
+    CHECK(table.get("") == 1);
+    CHECK(table.get(long_key) == 2);
+    CHECK(table.size() == 2);
+}
+
+TEST(stats_count_every_item) {
+    mstd::hash_table<int> table;
+    std::vector<std::string> keys = test::distinct_strings(5000);
+    for (size_t i = 0; i < keys.size(); i++) {
+        table.put(keys[i], (int) i);
+    }
+    mstd::hash_stats st = table.stats();
+    CHECK(st.num_items == keys.size());
+    size_t probed = 0;
+    for (size_t k = 0; k < st.probe_lengths.size(); k++) {
+        probed += st.probe_lengths[k];
+    }
+    CHECK(probed == keys.size());
+    CHECK(st.load_factor <= 0.75);
+    CHECK(st.key_bytes > 0);
+    CHECK(!st.to_string().empty());
+}
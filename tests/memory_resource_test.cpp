@@ -0,0 +1,132 @@
+#include <cstring>
+#include <set>
+#include <vector>
+#include "memory_resource.hpp"
+#include "slab_allocator.hpp"
+#include "test.hpp"
+
+static bool aligned(void *p, size_t alignment) {
+    return (uintptr_t) p % alignment == 0;
+}
+
+// Random allocations of random sizes and alignments: every block is aligned, and none overlap
+// (each is filled with its own byte, checked before it is freed)
+static void check_random_blocks(mstd::memory_resource &resource, bool frees) {
+    struct block {
+        unsigned char *p;
+        size_t bytes;
+        size_t alignment;
+        unsigned char fill;
+    };
+    std::vector<block> live;
+    for (int op = 0; op < 20000; op++) {
+        if (live.empty() || test::random(3) != 0) {
+            size_t bytes = test::random(4) == 0 ? test::random(5000) : test::random(200);
+            size_t alignment = (size_t) 1 << test::random(8);
+            block b = {static_cast<unsigned char *>(resource.allocate(bytes, alignment)), bytes, alignment,
+                       (unsigned char) test::random(256)};
+            REQUIRE(aligned(b.p, alignment));
+            memset(b.p, b.fill, bytes);
+            live.push_back(b);
+        } else {
+            size_t i = test::random(live.size());
+            block b = live[i];
+            for (size_t k = 0; k < b.bytes; k++) {
+                REQUIRE(b.p[k] == b.fill);
+            }
+            if (frees) resource.deallocate(b.p, b.bytes, b.alignment);
+            live[i] = live.back();
+            live.pop_back();
+        }
+    }
+    for (const block &b : live) {
+        for (size_t k = 0; k < b.bytes; k++) {
+            REQUIRE(b.p[k] == b.fill);
+        }
+        if (frees) resource.deallocate(b.p, b.bytes, b.alignment);
+    }
+}
+
+TEST(malloc_resource_blocks) {
+    mstd::malloc_resource resource;
+    check_random_blocks(resource, true);
+}
+
+TEST(arena_resource_blocks) {
+    test::counting_resource upstream;
+    {
+        mstd::arena_resource arena(4096, &upstream);
+        check_random_blocks(arena, false);
+        CHECK(upstream.allocations() > 0);
+        arena.release();
+        CHECK(upstream.allocations() == 0);
+        CHECK(arena.bytes_allocated() == 0);
+        check_random_blocks(arena, true);
+    }
+    CHECK(upstream.allocations() == 0);
+}
+
+TEST(pool_resource_blocks) {
+    test::counting_resource upstream;
+    {
+        mstd::pool_resource pool(&upstream);
+        check_random_blocks(pool, true);
+    }
+    CHECK(upstream.allocations() == 0);
+}
+
+// The most recent allocation grows (and is freed) in place, anything else is copied
+TEST(arena_reallocate) {
+    mstd::arena_resource arena(4096);
+    char *a = static_cast<char *>(arena.allocate(16));
+    strcpy(a, "first");
+    char *b = static_cast<char *>(arena.allocate(16));
+    strcpy(b, "second");
+    CHECK(arena.reallocate(b, 16, 1000) == b);
+
+    char *moved = static_cast<char *>(arena.reallocate(a, 16, 32));
+    CHECK(moved != a);
+    CHECK(strcmp(moved, "first") == 0);
+    CHECK(strcmp(b, "second") == 0);
+
+    // Too big for what is left of the block
+    char *big = static_cast<char *>(arena.reallocate(moved, 32, 10000));
+    CHECK(strcmp(big, "first") == 0);
+
+    arena.deallocate(big, 10000);
+    CHECK(arena.allocate(10000) == big);
+}
+
+// Freed blocks are handed out again before the pool asks upstream for more
+TEST(pool_reuses_blocks) {
+    test::counting_resource upstream;
+    mstd::pool_resource pool(&upstream);
+    std::set<void *> first;
+    for (int i = 0; i < 100; i++) {
+        first.insert(pool.allocate(40));
+    }
+    long chunks = upstream.allocations();
+    for (void *p : first) {
+        pool.deallocate(p, 40);
+    }
+    for (int i = 0; i < 100; i++) {
+        REQUIRE(first.count(pool.allocate(33)) == 1);
+    }
+    CHECK(upstream.allocations() == chunks);
+
+    // Larger than any class: straight upstream
+    void *big = pool.allocate(pool_constants::max_block_size + 1);
+    CHECK(upstream.allocations() == chunks + 1);
+    pool.deallocate(big, pool_constants::max_block_size + 1);
+    CHECK(upstream.allocations() == chunks);
+}
+
+TEST(thread_safety_flags) {
+    mstd::arena_resource arena;
+    mstd::pool_resource pool;
+    CHECK(mstd::default_resource()->is_thread_safe());
+    CHECK(mstd::slab_resource()->is_thread_safe());
+    CHECK(!arena.is_thread_safe());
+    CHECK(!pool.is_thread_safe());
+    CHECK(!mstd::pool_resource::for_this_thread().is_thread_safe());
+}
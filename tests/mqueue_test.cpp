@@ -0,0 +1,103 @@
+#include <deque>
+#include <string>
+#include "mqueue.hpp"
+#include "mstack.hpp"
+#include "test.hpp"
+
+// Pushes and pops against std::deque. The size wanders over several blocks, so the queue keeps moving
+// into fresh blocks, recycling spare ones and handing extra ones back
+template <typename T, typename Make>
+static void check_random_operations(Make make) {
+    test::counting_resource resource;
+    {
+        mstd::queue<T> queue(-1, &resource);
+        std::deque<T> model;
+        size_t target = 0;
+        for (int op = 0; op < 200000; op++) {
+            if (op % 5000 == 0) target = test::random(3000);
+            bool grow = model.size() < target ? test::random(4) != 0 : test::random(4) == 0;
+            if (grow) {
+                T value = make((int) test::random(1000000));
+                if (test::random(2) == 0) queue.push(value);
+                else queue.emplace(value);
+                model.push_back(value);
+            } else if (!model.empty()) {
+                REQUIRE(queue.peek() == model.front());
+                REQUIRE(queue.pop() == model.front());
+                model.pop_front();
+            }
+            REQUIRE(queue.size() == model.size());
+            REQUIRE(queue.empty() == model.empty());
+            if (op % 1000 == 0 && !model.empty()) {
+                size_t i = test::random(model.size());
+                REQUIRE(queue.get_element_at((int) i) == model[i]);
+            }
+        }
+        queue.clear();
+        CHECK(queue.empty());
+        CHECK(resource.allocations() == 0);
+        queue.push(make(1));
+        CHECK(queue.pop() == make(1));
+    }
+    CHECK(resource.allocations() == 0);
+}
+
+TEST(random_operations_trivial) {
+    check_random_operations<long>([](int i) { return (long) i; });
+}
+
+TEST(random_operations_strings) {
+    check_random_operations<std::string>([](int i) { return std::to_string(i) + std::string(i % 30, 's'); });
+}
+
+TEST(random_operations_tracked) {
+    long live = test::tracked::live();
+    check_random_operations<test::tracked>([](int i) { return test::tracked(i); });
+    CHECK(test::tracked::live() == live);
+}
+
+TEST(queue_limits) {
+    mstd::queue<int> queue(3);
+    CHECK_THROWS(queue.pop(), std::runtime_error);
+    CHECK_THROWS(queue.peek(), std::runtime_error);
+    for (int i = 0; i < 3; i++) {
+        queue.push(i);
+    }
+    CHECK(queue.full());
+    CHECK_THROWS(queue.push(3), std::runtime_error);
+    CHECK_THROWS(queue.get_element_at(3), std::out_of_range);
+    CHECK(queue.pop() == 0);
+    CHECK(!queue.full());
+}
+
+TEST(stack_against_model) {
+    long live = test::tracked::live();
+    test::counting_resource resource;
+    {
+        mstd::stack<test::tracked> stack(-1, &resource);
+        std::deque<int> model;
+        for (int op = 0; op < 50000; op++) {
+            if (model.empty() || test::random(3) != 0) {
+                int value = (int) test::random(1000);
+                stack.push(test::tracked(value));
+                model.push_back(value);
+            } else {
+                REQUIRE(stack.peek().value == model.back());
+                REQUIRE(stack.pop().value == model.back());
+                model.pop_back();
+            }
+            REQUIRE(stack.size() == model.size());
+        }
+        CHECK(stack.get_element_at(0).value == model.back());
+    }
+    CHECK(resource.allocations() == 0);
+    CHECK(test::tracked::live() == live);
+
+    mstd::stack<int> small(2);
+    small.push(1);
+    small.push(2);
+    CHECK(small.full());
+    CHECK_THROWS(small.push(3), std::runtime_error);
+    small.clear();
+    CHECK_THROWS(small.pop(), std::runtime_error);
+}
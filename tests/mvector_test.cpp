@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mvector.hpp"
+#include "test.hpp"
+
+template <typename T>
+static void check_same(const mstd::vector<T> &vec, const std::vector<T> &model) {
+    REQUIRE(vec.size() == model.size());
+    REQUIRE(vec.capacity() >= vec.size());
+    for (size_t i = 0; i < model.size(); i++) {
+        REQUIRE(vec[i] == model[i]);
+    }
+}
+
+// Pushes, inserts, removals and pops against std::vector. make(i) turns a random number into an element
+template <typename T, typename Make>
+static void check_random_operations(Make make) {
+    test::counting_resource resource;
+    {
+        mstd::vector<T> vec(1, &resource);
+        std::vector<T> model;
+        for (int op = 0; op < 20000; op++) {
+            T value = make((int) test::random(100));
+            switch (test::random(op < 10000 ? 6 : 9)) {
+                case 0:
+                    vec.push(value);
+                    model.push_back(value);
+                    break;
+                case 1:
+                    vec.emplace(value);
+                    model.push_back(value);
+                    break;
+                case 2: {
+                    int index = (int) test::random(model.size() + 1);
+                    T copy(value);
+                    vec.m_insert_at(index, copy);
+                    model.insert(model.begin() + index, value);
+                    break;
+                }
+                case 3:
+                    if (!model.empty()) {
+                        REQUIRE(vec.back() == model.back());
+                        vec.pop_back();
+                        model.pop_back();
+                    }
+                    break;
+                case 4:
+                    REQUIRE(vec.in(value) == (std::find(model.begin(), model.end(), value) != model.end()));
+                    REQUIRE(vec.find(value) == (size_t) (std::find(model.begin(), model.end(), value) - model.begin()));
+                    REQUIRE(vec.count(value) == (size_t) std::count(model.begin(), model.end(), value));
+                    break;
+                default:
+                    if (!model.empty()) {
+                        size_t index = test::random(model.size());
+                        vec.remove_at(index);
+                        model.erase(model.begin() + (long) index);
+                    }
+                    break;
+            }
+            if (op % 1000 == 0) check_same(vec, model);
+        }
+        check_same(vec, model);
+
+        mstd::vector<T> copy(vec);
+        check_same(copy, model);
+        CHECK(copy.equal(vec));
+        mstd::vector<T> moved(std::move(copy));
+        check_same(moved, model);
+        vec.clear();
+        CHECK(vec.size() == 0);
+        vec.shrink_to_size();
+    }
+    CHECK(resource.allocations() == 0);
+}
+
+TEST(random_operations_trivial) {
+    check_random_operations<int>([](int i) { return i; });
+}
+
+TEST(random_operations_strings) {
+    check_random_operations<std::string>([](int i) { return std::string(i % 40, (char) ('a' + i % 26)); });
+}
+
+TEST(random_operations_tracked) {
+    long live = test::tracked::live();
+    check_random_operations<test::tracked>([](int i) { return test::tracked(i); });
+    CHECK(test::tracked::live() == live);
+}
+
+// Pushing an element of the vector itself while it reallocates
+TEST(push_own_element) {
+    mstd::vector<std::string> vec(1);
+    vec.push(std::string(30, 'x'));
+    for (int i = 0; i < 100; i++) {
+        vec.push(vec[0]);
+        vec.emplace(vec.back());
+    }
+    for (const std::string &s : vec) {
+        REQUIRE(s == std::string(30, 'x'));
+    }
+}
+
+TEST(bounds_and_arguments) {
+    mstd::vector<int> vec;
+    CHECK_THROWS(vec.at(0), std::out_of_range);
+    CHECK_THROWS(vec.back(), std::out_of_range);
+    CHECK_THROWS(vec.remove_at(0), std::out_of_range);
+    CHECK_THROWS(vec.set_at(0, 1), std::out_of_range);
+    int v = 1;
+    CHECK_THROWS(vec.m_insert_at(1, v), std::out_of_range);
+    CHECK_THROWS(vec.m_insert_at(-1, v), std::out_of_range);
+    CHECK_THROWS(vec.set_growth_factor(1.0), std::invalid_argument);
+    vec.pop_back();
+    CHECK(vec.size() == 0);
+}
+
+TEST(growth_factor_and_reserve) {
+    mstd::vector<int> vec(1);
+    vec.set_growth_factor(1.01);
+    for (int i = 0; i < 1000; i++) {
+        vec.push(i);
+    }
+    CHECK(vec.size() == 1000);
+    vec.reserve(5000);
+    CHECK(vec.capacity() == 5000);
+    vec.reserve(10);
+    CHECK(vec.capacity() == 5000);
+    vec.shrink_to_size();
+    CHECK(vec.capacity() == 1000);
+    CHECK(vec[999] == 999);
+}
+
+TEST(min_max_and_equal) {
+    mstd::vector<double> vec;
+    CHECK(vec.min_element() == 0);
+    CHECK(vec.max_element() == 0);
+    for (int i = 0; i < 100; i++) {
+        vec.push((double) ((i * 37) % 101));
+    }
+    std::vector<double> model(vec.begin(), vec.end());
+    CHECK(vec.min_element() == (size_t) (std::min_element(model.begin(), model.end()) - model.begin()));
+    CHECK(vec.max_element() == (size_t) (std::max_element(model.begin(), model.end()) - model.begin()));
+
+    mstd::vector<double> other(vec);
+    CHECK(vec.equal(other));
+    other.set_at(50, -1);
+    CHECK(!vec.equal(other));
+    other.pop_back();
+    CHECK(!vec.equal(other));
+}
+
+TEST(slices_and_spans) {
+    mstd::vector<int> vec;
+    for (int i = 0; i < 10; i++) {
+        vec.push(i);
+    }
+    mstd::span<int> s = vec.slice(2, 5);
+    CHECK(s.size() == 3);
+    s[0] = 20;
+    CHECK(vec[2] == 20);
+    CHECK(vec.slice(10, 10).size() == 0);
+    CHECK_THROWS(vec.slice(5, 2), std::out_of_range);
+    CHECK_THROWS(vec.slice(0, 11), std::out_of_range);
+
+    const mstd::vector<int> &cvec = vec;
+    mstd::span<const int> all = cvec;
+    CHECK(all.size() == 10);
+    CHECK(cvec.slice(2, 3)[0] == 20);
+
+    mstd::vector<int> part(vec, 2, 5);
+    CHECK(part.size() == 3);
+    CHECK(part[0] == 20);
+}
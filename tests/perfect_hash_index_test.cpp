@@ -0,0 +1,133 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include "perfect_hash_index.hpp"
+#include "test.hpp"
+
+// A file name of our own in TMPDIR, removed when it goes out of scope
+class temp_file {
+public:
+    temp_file() {
+        const char *dir = getenv("TMPDIR");
+        std::string pattern = std::string(dir != nullptr ? dir : "/tmp") + "/perfect_hash_index_test.XXXXXX";
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        int fd = mkstemp(name.data());
+        if (fd >= 0) close(fd);
+        _path = name.data();
+    }
+
+    ~temp_file() {
+        remove(_path.c_str());
+    }
+
+    const std::string &path() const { return _path; }
+
+private:
+    std::string _path;
+};
+
+struct record {
+    uint32_t id;
+    float score;
+};
+
+// Every key reads back its own value, and keys outside the set are rejected
+static void check_round_trip(size_t n) {
+    std::vector<std::string> keys = test::distinct_strings(n);
+    mstd::perfect_hash_builder<uint64_t> builder;
+    for (size_t i = 0; i < n; i++) {
+        builder.add(keys[i], i * 3);
+    }
+    CHECK(builder.size() == n);
+
+    temp_file file;
+    builder.write(file.path());
+    mstd::perfect_hash_index<uint64_t> index(file.path());
+    REQUIRE(index.size() == n);
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t *v = index.find(keys[i]);
+        REQUIRE(v != nullptr);
+        REQUIRE(*v == i * 3);
+    }
+    for (const std::string &other : test::distinct_strings(1000, "other")) {
+        REQUIRE(!index.contains(other));
+    }
+}
+
+// Powers of two used to make the pilot search loop forever: cover them, their neighbours and odd sizes
+TEST(round_trip_sizes) {
+    const size_t sizes[] = {0, 1, 2, 3, 7, 8, 9, 63, 64, 65, 255, 256, 1000, 1023, 1024, 1025, 4096, 10007, 65536};
+    for (size_t n : sizes) {
+        check_round_trip(n);
+    }
+}
+
+TEST(round_trip_large) {
+    check_round_trip(200000);
+}
+
+TEST(struct_values_and_get) {
+    mstd::perfect_hash_builder<record> builder;
+    builder.add("alpha", record{1, 0.5f});
+    builder.add("beta", record{2, 1.5f});
+    temp_file file;
+    builder.write(file.path());
+
+    mstd::perfect_hash_index<record> index(file.path());
+    CHECK(index.get("alpha").id == 1);
+    CHECK(index.get("beta").score == 1.5f);
+    CHECK(index.find("gamma") == nullptr);
+    CHECK_THROWS(index.get("gamma"), std::runtime_error);
+    CHECK(index.size_in_bytes() > 0);
+}
+
+TEST(duplicate_keys_are_rejected) {
+    mstd::perfect_hash_builder<int> builder;
+    builder.add("same", 1);
+    builder.add("other", 2);
+    builder.add("same", 3);
+    temp_file file;
+    CHECK_THROWS(builder.write(file.path()), std::runtime_error);
+}
+
+TEST(bad_files_are_rejected) {
+    CHECK_THROWS(mstd::perfect_hash_index<int>("/nonexistent/perfect_hash_index"), std::runtime_error);
+
+    temp_file garbage;
+    {
+        std::ofstream out(garbage.path().c_str(), std::ios::binary);
+        out << std::string(4096, 'x');
+    }
+    CHECK_THROWS(mstd::perfect_hash_index<int>(garbage.path()), std::runtime_error);
+
+    // Built for another value type
+    mstd::perfect_hash_builder<uint64_t> builder;
+    builder.add("key", 1);
+    temp_file file;
+    builder.write(file.path());
+    CHECK_THROWS(mstd::perfect_hash_index<uint32_t>(file.path()), std::runtime_error);
+}
+
+static std::string read_file(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+// Slots are written byte for byte: the padding after values smaller than 8 bytes mustn't carry garbage
+TEST(output_is_deterministic) {
+    std::vector<std::string> keys = test::distinct_strings(1000);
+    temp_file first, second;
+    for (const temp_file *file : {&first, &second}) {
+        mstd::perfect_hash_builder<uint32_t> builder;
+        for (size_t i = 0; i < keys.size(); i++) {
+            builder.add(keys[i], (uint32_t) i);
+        }
+        builder.write(file->path());
+    }
+    std::string bytes = read_file(first.path());
+    REQUIRE(!bytes.empty());
+    CHECK(bytes == read_file(second.path()));
+}
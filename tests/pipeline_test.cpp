@@ -0,0 +1,95 @@
+#include <atomic>
+#include <vector>
+#include "pipeline.hpp"
+#include "thread_pool.hpp"
+#include "test.hpp"
+
+// Updates max to the largest value it's been given
+static void record_max(std::atomic<int> &max, int value) {
+    int seen = max.load();
+    while (value > seen && !max.compare_exchange_weak(seen, value)) { }
+}
+
+// The source counts up to n; a parallel stage squares, a parallel filter drops multiples of 3, a serial stage
+// checks it's never entered twice at once, and the in-order sink collects everything
+static void check_pipeline(thread_pool &pool, long n, size_t batch_size, size_t max_in_flight) {
+    long next = 0;
+    std::atomic<int> in_flight(0), max_in_flight_seen(0);
+    std::atomic<int> in_serial(0), max_in_serial(0);
+    std::vector<long> out;
+    long serial_sum = 0;
+
+    mstd::pipeline p(pool, batch_size, max_in_flight);
+    p.source<long>([&](mstd::vector<long> &items, size_t max) {
+        record_max(max_in_flight_seen, ++in_flight);
+        for (size_t i = 0; i < max && next < n; i++) {
+            items.push(next++);
+        }
+        return next < n;
+    })
+     .then<long>(mstd::stage_parallel, [](mstd::vector<long> &in, mstd::vector<long> &squares) {
+        for (long x : in) {
+            squares.push(x * x);
+        }
+    })
+     .apply(mstd::stage_parallel, [](mstd::vector<long> &in) {
+        mstd::vector<long> kept;
+        for (long x : in) {
+            if (x % 3 != 0) kept.push(x);
+        }
+        in = kept;
+    })
+     .apply(mstd::stage_serial, [&](mstd::vector<long> &in) {
+        record_max(max_in_serial, ++in_serial);
+        for (long x : in) {
+            serial_sum += x;
+        }
+        in_serial--;
+    })
+     .apply(mstd::stage_serial_in_order, [&](mstd::vector<long> &in) {
+        out.insert(out.end(), in.begin(), in.end());
+        in_flight--;
+    });
+    p.run();
+
+    std::vector<long> expected;
+    long expected_sum = 0;
+    for (long x = 0; x < n; x++) {
+        if ((x * x) % 3 != 0) {
+            expected.push_back(x * x);
+            expected_sum += x * x;
+        }
+    }
+    CHECK(out == expected);
+    CHECK(serial_sum == expected_sum);
+    CHECK(max_in_serial.load() <= 1);
+    CHECK(max_in_flight_seen.load() <= (int) max_in_flight);
+}
+
+TEST(stages_and_order) {
+    thread_pool pool(4);
+    check_pipeline(pool, 100000, 100, 8);
+    check_pipeline(pool, 100000, 1000, 1);
+    check_pipeline(pool, 12345, 7, 3);
+}
+
+TEST(empty_and_tiny_inputs) {
+    thread_pool pool(2);
+    check_pipeline(pool, 0, 16, 4);
+    check_pipeline(pool, 1, 16, 4);
+    check_pipeline(pool, 16, 16, 4);
+    check_pipeline(pool, 17, 16, 4);
+}
+
+TEST(random_batch_sizes) {
+    thread_pool pool(3);
+    for (int i = 0; i < 20; i++) {
+        check_pipeline(pool, (long) test::random(20000), 1 + test::random(500), 1 + test::random(10));
+    }
+}
+
+// No task ever blocks, so a single worker carries every batch through
+TEST(single_worker) {
+    thread_pool pool(1);
+    check_pipeline(pool, 50000, 64, 16);
+}
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+#include "priority_queue.hpp"
+#include "test.hpp"
+
+// Pushes, pops and replace_tops against std::priority_queue
+template <typename Compare, size_t D>
+static void check_random_operations() {
+    test::counting_resource resource;
+    {
+        mstd::priority_queue<int, Compare, D> queue(-1, Compare(), &resource);
+        std::priority_queue<int, std::vector<int>, Compare> model;
+        for (int op = 0; op < 50000; op++) {
+            int value = (int) test::random(op < 25000 ? 1000 : 100000);
+            switch (test::random(model.size() < 500 ? 3 : 5)) {
+                case 0:
+                case 1:
+                    REQUIRE(test::random(2) == 0 ? queue.push(value) : queue.emplace(value));
+                    model.push(value);
+                    break;
+                case 2:
+                    if (!model.empty()) {
+                        REQUIRE(queue.replace_top(value) == model.top());
+                        model.pop();
+                        model.push(value);
+                    }
+                    break;
+                default:
+                    REQUIRE(queue.pop() == model.top());
+                    model.pop();
+                    break;
+            }
+            REQUIRE(queue.size() == model.size());
+            if (!model.empty()) REQUIRE(queue.top() == model.top());
+        }
+        mstd::vector<int> rest;
+        queue.pop_all(rest);
+        REQUIRE(rest.size() == model.size());
+        for (size_t i = 0; i < rest.size(); i++) {
+            REQUIRE(rest[i] == model.top());
+            model.pop();
+        }
+        CHECK(queue.empty());
+    }
+    CHECK(resource.allocations() == 0);
+}
+
+TEST(random_operations_binary) {
+    check_random_operations<std::less<int>, 2>();
+    check_random_operations<std::greater<int>, 2>();
+}
+
+TEST(random_operations_ternary) {
+    check_random_operations<std::less<int>, 3>();
+}
+
+TEST(random_operations_quaternary) {
+    check_random_operations<std::less<int>, 4>();
+    check_random_operations<std::greater<int>, 4>();
+}
+
+TEST(random_operations_octonary) {
+    check_random_operations<std::less<int>, 8>();
+}
+
+// Bounded with std::greater, the queue keeps the k largest values, the k-th largest on top
+TEST(bounded_top_k) {
+    for (int limit : {1, 2, 7, 100, 1000}) {
+        mstd::priority_queue<int, std::greater<int>> top(limit);
+        CHECK(top.limit() == limit);
+        std::vector<int> all;
+        for (int i = 0; i < 5000; i++) {
+            int value = (int) test::random(3000);
+            bool kept = top.push(value);
+            all.push_back(value);
+            // Discarded values would have been the new top, popped first
+            if (!kept) REQUIRE(top.size() == (size_t) limit && value <= top.top());
+            REQUIRE(top.size() == std::min(all.size(), (size_t) limit));
+        }
+        std::sort(all.begin(), all.end(), std::greater<int>());
+        CHECK(top.top() == all[limit - 1]);
+        mstd::vector<int> kept;
+        top.pop_all(kept);
+        for (int i = 0; i < limit; i++) {
+            REQUIRE(kept[i] == all[limit - 1 - i]);
+        }
+    }
+}
+
+// heapify adds to whatever is already in the queue, bounded or not
+TEST(heapify) {
+    for (size_t existing : {0, 1, 50}) {
+        for (size_t added : {0, 1, 10, 5000}) {
+            for (int limit : {-1, 20}) {
+                mstd::priority_queue<long, std::greater<long>, 4> queue(limit);
+                std::vector<long> all;
+                for (size_t i = 0; i < existing; i++) {
+                    long value = (long) test::random(10000);
+                    queue.push(value);
+                    all.push_back(value);
+                }
+                std::vector<long> items;
+                for (size_t i = 0; i < added; i++) {
+                    items.push_back((long) test::random(10000));
+                }
+                queue.heapify(mstd::span<const long>(items.data(), items.size()));
+                all.insert(all.end(), items.begin(), items.end());
+
+                // Largest first, cut at the limit, then back to the order pop returns them in
+                std::sort(all.begin(), all.end(), std::greater<long>());
+                if (limit > 0 && all.size() > (size_t) limit) all.resize(limit);
+                std::reverse(all.begin(), all.end());
+                REQUIRE(queue.size() == all.size());
+                for (long expected : all) {
+                    REQUIRE(queue.pop() == expected);
+                }
+            }
+        }
+    }
+}
+
+TEST(build_from_vector) {
+    mstd::vector<std::string> items;
+    for (int i = 0; i < 1000; i++) {
+        items.push(test::random_string(0, 8));
+    }
+    std::vector<std::string> sorted(items.begin(), items.end());
+    std::sort(sorted.begin(), sorted.end());
+    mstd::priority_queue<std::string> queue(std::move(items));
+    CHECK(queue.size() == 1000);
+    for (size_t i = sorted.size(); i-- > 0;) {
+        REQUIRE(queue.pop() == sorted[i]);
+    }
+}
+
+TEST(empty_queue) {
+    mstd::priority_queue<int> queue;
+    CHECK(queue.empty());
+    CHECK_THROWS(queue.pop(), std::runtime_error);
+    CHECK_THROWS(queue.top(), std::runtime_error);
+    CHECK_THROWS(queue.replace_top(1), std::runtime_error);
+    queue.push(1);
+    queue.clear();
+    CHECK(queue.empty());
+
+    long live = test::tracked::live();
+    {
+        mstd::priority_queue<test::tracked, std::less<test::tracked>, 3> tracked;
+        for (int i = 0; i < 100; i++) {
+            tracked.emplace((int) test::random(50));
+        }
+        tracked.pop();
+        tracked.replace_top(test::tracked(3));
+    }
+    CHECK(test::tracked::live() == live);
+}
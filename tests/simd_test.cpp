@@ -0,0 +1,141 @@
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "simd.hpp"
+#include "test.hpp"
+
+using namespace mstd::simd;
+
+// Sets the instruction set for the lifetime of the object
+class isa_scope {
+public:
+    explicit isa_scope(isa which) : _saved(current_isa()) { set_isa(which); }
+    ~isa_scope() { set_isa(_saved); }
+
+private:
+    isa _saved;
+};
+
+// A random value of T out of a small pool, so that arrays hold repeats and searches find matches.
+// The pool includes the type's extremes, and NaN, infinities and both zeros for floating point types
+template <typename T>
+static T random_value(bool wide) {
+    typedef std::numeric_limits<T> limits;
+    if (std::is_floating_point<T>::value) {
+        switch (test::random(wide ? 12 : 24)) {
+            case 0: return limits::quiet_NaN();
+            case 1: return -limits::quiet_NaN();
+            case 2: return (T) -0.0;
+            case 3: return (T) 0.0;
+            case 4: return limits::infinity();
+            case 5: return -limits::infinity();
+            case 6: return limits::max();
+            case 7: return limits::lowest();
+            case 8: return limits::denorm_min();
+            default: return (T) ((double) test::random(wide ? 2000 : 20) - (wide ? 1000 : 10)) / 4;
+        }
+    }
+    switch (test::random(16)) {
+        case 0: return limits::min();
+        case 1: return limits::max();
+        case 2: return (T) (limits::min() + 1);
+        case 3: return (T) (limits::max() - 1);
+        default: return (T) (wide ? test::rng()() : test::random(20));
+    }
+}
+
+// Same answers as the generic loops, on every length up to max_n and at every alignment of the first
+// element, with the match (or the extreme) anywhere, including in the unaligned tail
+template <typename T>
+static void check_against_generic(size_t max_n) {
+    std::vector<T> buffer(max_n + 8), other(max_n + 8);
+    for (size_t n = 0; n <= max_n; n++) {
+        for (size_t offset = 0; offset < 4; offset++) {
+            bool wide = test::random(2) == 0;
+            T *data = buffer.data() + offset;
+            for (size_t i = 0; i < n; i++) {
+                data[i] = random_value<T>(wide);
+            }
+            T value = test::random(3) == 0 || n == 0 ? random_value<T>(wide) : data[test::random(n)];
+
+            REQUIRE(find(data, n, value) == detail::find_generic(data, n, value));
+            REQUIRE(count(data, n, value) == detail::count_generic(data, n, value));
+            REQUIRE(min_element(data, n) == (n == 0 ? 0 : detail::min_generic(data, n)));
+            REQUIRE(max_element(data, n) == (n == 0 ? 0 : detail::max_generic(data, n)));
+
+            T *copy = other.data() + (offset + 1) % 4;
+            for (size_t i = 0; i < n; i++) {
+                copy[i] = data[i];
+            }
+            REQUIRE(equal(data, copy, n) == detail::equal_generic(data, copy, n));
+            if (n > 0) {
+                copy[test::random(n)] = random_value<T>(wide);
+                REQUIRE(equal(data, copy, n) == detail::equal_generic(data, copy, n));
+            }
+        }
+    }
+}
+
+template <typename T>
+static void check_type() {
+    for (int which = isa_generic; which <= detected_isa(); which++) {
+        isa_scope scope((isa) which);
+        REQUIRE(current_isa() == which);
+        check_against_generic<T>(200);
+        // A few long arrays, to go through the unrolled main loops many times
+        for (int i = 0; i < 5; i++) {
+            size_t n = 1000 + test::random(5000);
+            std::vector<T> data(n);
+            for (size_t k = 0; k < n; k++) {
+                data[k] = random_value<T>(true);
+            }
+            T value = data[test::random(n)];
+            REQUIRE(find(data.data(), n, value) == detail::find_generic(data.data(), n, value));
+            REQUIRE(count(data.data(), n, value) == detail::count_generic(data.data(), n, value));
+            REQUIRE(min_element(data.data(), n) == detail::min_generic(data.data(), n));
+            REQUIRE(max_element(data.data(), n) == detail::max_generic(data.data(), n));
+        }
+    }
+}
+
+TEST(int8) { check_type<int8_t>(); }
+TEST(uint8) { check_type<uint8_t>(); }
+TEST(int16) { check_type<int16_t>(); }
+TEST(uint16) { check_type<uint16_t>(); }
+TEST(int32) { check_type<int32_t>(); }
+TEST(uint32) { check_type<uint32_t>(); }
+TEST(int64) { check_type<int64_t>(); }
+TEST(uint64) { check_type<uint64_t>(); }
+TEST(float32) { check_type<float>(); }
+TEST(float64) { check_type<double>(); }
+TEST(plain_char) { check_type<char>(); }
+TEST(long_long) { check_type<long long>(); }
+
+TEST(isa_selection) {
+    isa_scope scope(current_isa());
+    CHECK(detected_isa() < isa_count);
+    set_isa(isa_count);
+    CHECK(current_isa() == detected_isa());
+    set_isa(isa_generic);
+    CHECK(current_isa() == isa_generic);
+    for (int which = isa_generic; which < isa_count; which++) {
+        CHECK(isa_name((isa) which) != nullptr);
+    }
+    CHECK(is_vectorizable<int>::value);
+    CHECK(!is_vectorizable<bool>::value);
+    CHECK(!is_vectorizable<long double>::value);
+}
+
+// NaN matches nothing, not even itself, and -0.0 matches +0.0 (as with ==)
+TEST(floating_point_semantics) {
+    std::vector<double> data(64, 1.0);
+    data[40] = std::numeric_limits<double>::quiet_NaN();
+    data[50] = 0.0;
+    for (int which = isa_generic; which <= detected_isa(); which++) {
+        isa_scope scope((isa) which);
+        CHECK(find(data.data(), data.size(), std::numeric_limits<double>::quiet_NaN()) == data.size());
+        CHECK(find(data.data(), data.size(), -0.0) == 50);
+        CHECK(count(data.data(), data.size(), 1.0) == 62);
+        CHECK(!equal(data.data(), data.data(), data.size()));
+    }
+}
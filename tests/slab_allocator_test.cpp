@@ -0,0 +1,147 @@
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "slab_allocator.hpp"
+#include "test.hpp"
+
+struct object {
+    unsigned char *p;
+    size_t bytes;
+    unsigned char fill;
+};
+
+static object allocate_filled(size_t bytes, unsigned char fill) {
+    object o = {static_cast<unsigned char *>(mstd::slab_allocator::allocate(bytes)), bytes, fill};
+    memset(o.p, fill, bytes);
+    return o;
+}
+
+// Still holds its own fill byte, i.e. no other live object overlaps it
+static bool intact(const object &o) {
+    for (size_t k = 0; k < o.bytes; k++) {
+        if (o.p[k] != o.fill) return false;
+    }
+    return true;
+}
+
+// Every size up to (and past) max_object_size, allocated and freed in random order
+TEST(random_sizes) {
+    std::vector<object> live;
+    for (int op = 0; op < 50000; op++) {
+        if (live.empty() || test::random(2) == 0) {
+            size_t bytes = 1 + test::random(slab_constants::max_object_size + 64);
+            object o = allocate_filled(bytes, (unsigned char) test::random(256));
+            REQUIRE((uintptr_t) o.p % alignof(std::max_align_t) == 0);
+            live.push_back(o);
+        } else {
+            size_t i = test::random(live.size());
+            REQUIRE(intact(live[i]));
+            mstd::slab_allocator::deallocate(live[i].p, live[i].bytes);
+            live[i] = live.back();
+            live.pop_back();
+        }
+    }
+    for (const object &o : live) {
+        REQUIRE(intact(o));
+        mstd::slab_allocator::deallocate(o.p, o.bytes);
+    }
+}
+
+// Objects allocated on one thread and freed on another (through the depot), with every thread doing both
+TEST(cross_thread_frees) {
+    const int num_threads = 4;
+    const int rounds = 20;
+    const int per_round = 2000;
+    std::vector<std::vector<object>> handoff(num_threads);
+    std::vector<std::mutex> locks(num_threads);
+    std::vector<uint64_t> seeds;
+    for (int t = 0; t < num_threads; t++) {
+        seeds.push_back(test::rng()());
+    }
+    std::vector<int> corrupted(num_threads, 0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937_64 rng(seeds[t]);
+            for (int r = 0; r < rounds; r++) {
+                std::vector<object> made;
+                for (int i = 0; i < per_round; i++) {
+                    made.push_back(allocate_filled(1 + rng() % slab_constants::max_object_size,
+                                                   (unsigned char) (t * 16 + r)));
+                }
+                // Hand them to the next thread, and free whatever was handed to us
+                {
+                    std::lock_guard<std::mutex> lock(locks[(t + 1) % num_threads]);
+                    std::vector<object> &next = handoff[(t + 1) % num_threads];
+                    next.insert(next.end(), made.begin(), made.end());
+                }
+                std::vector<object> mine;
+                {
+                    std::lock_guard<std::mutex> lock(locks[t]);
+                    mine.swap(handoff[t]);
+                }
+                for (const object &o : mine) {
+                    if (!intact(o)) corrupted[t]++;
+                    mstd::slab_allocator::deallocate(o.p, o.bytes);
+                }
+            }
+        });
+    }
+    for (std::thread &t : threads) t.join();
+    for (int t = 0; t < num_threads; t++) {
+        for (const object &o : handoff[t]) {
+            REQUIRE(intact(o));
+            mstd::slab_allocator::deallocate(o.p, o.bytes);
+        }
+        CHECK(corrupted[t] == 0);
+    }
+}
+
+// Counters of an idle allocator add up
+TEST(stats) {
+    mstd::slab_stats before = mstd::slab_allocator::stats();
+    std::vector<void *> objects;
+    for (int i = 0; i < 1000; i++) {
+        objects.push_back(mstd::slab_allocator::allocate(48));
+    }
+    void *large = mstd::slab_allocator::allocate(slab_constants::max_object_size + 1);
+    mstd::slab_stats during = mstd::slab_allocator::stats();
+
+    REQUIRE(during.classes.size() == slab_constants::num_classes);
+    const mstd::slab_class_stats &c = during.classes[48 / slab_constants::granularity - 1];
+    CHECK(c.object_size == 48);
+    CHECK(c.in_use >= 1000);
+    CHECK(c.allocations >= before.classes[48 / slab_constants::granularity - 1].allocations + 1000);
+    CHECK(during.large_allocations == before.large_allocations + 1);
+    for (const mstd::slab_class_stats &s : during.classes) {
+        REQUIRE(s.objects == s.in_use + s.in_depot + s.in_caches);
+        REQUIRE(s.objects <= s.slabs * (slab_constants::slab_bytes / s.object_size));
+    }
+    CHECK(!during.to_string().empty());
+
+    for (void *p : objects) {
+        mstd::slab_allocator::deallocate(p, 48);
+    }
+    mstd::slab_allocator::deallocate(large, slab_constants::max_object_size + 1);
+    mstd::slab_stats after = mstd::slab_allocator::stats();
+    CHECK(after.classes[48 / slab_constants::granularity - 1].in_use ==
+          before.classes[48 / slab_constants::granularity - 1].in_use);
+}
+
+TEST(memory_resource_interface) {
+    mstd::memory_resource *resource = mstd::slab_resource();
+    void *p = resource->allocate(24);
+    memset(p, 7, 24);
+    // Same class: stays put
+    void *q = resource->reallocate(p, 24, 30);
+    CHECK(q == p);
+    void *r = resource->reallocate(q, 30, 1000);
+    CHECK(static_cast<unsigned char *>(r)[23] == 7);
+    resource->deallocate(r, 1000);
+
+    void *aligned = resource->allocate(64, 128);
+    CHECK((uintptr_t) aligned % 128 == 0);
+    resource->deallocate(aligned, 64, 128);
+}
@@ -0,0 +1,99 @@
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "small_map.hpp"
+#include "test.hpp"
+
+// Operations against std::unordered_map on key ranges just below and above the inline capacity,
+// so that maps keep switching between inline storage and a hash table (through clear)
+TEST(random_operations_against_unordered_map) {
+    test::counting_resource resource;
+    {
+        for (size_t key_range : {4, 8, 9, 12, 40}) {
+            mstd::small_map<int, std::string, 8> map(&resource);
+            std::unordered_map<int, std::string> model;
+            for (int op = 0; op < 20000; op++) {
+                int key = (int) test::random(key_range);
+                std::string value = std::to_string(test::random(1000));
+                switch (test::random(6)) {
+                    case 0:
+                    case 1:
+                        REQUIRE(map.insert(key, value) == model.emplace(key, value).second);
+                        break;
+                    case 2:
+                        map[key] = value;
+                        model[key] = value;
+                        break;
+                    case 3:
+                        REQUIRE(map.erase(key) == (model.erase(key) == 1));
+                        break;
+                    case 4: {
+                        std::string *v = map.find(key);
+                        REQUIRE((v != nullptr) == (model.count(key) == 1));
+                        if (v != nullptr) REQUIRE(*v == model[key]);
+                        break;
+                    }
+                    default:
+                        if (test::random(100) == 0) {
+                            map.clear();
+                            model.clear();
+                            REQUIRE(map.is_small());
+                        }
+                        break;
+                }
+                REQUIRE(map.size() == model.size());
+                if (model.size() > 8) REQUIRE(!map.is_small());
+            }
+            for (const auto &item : model) {
+                REQUIRE(map.get(item.first) == item.second);
+            }
+        }
+    }
+    CHECK(resource.allocations() == 0);
+}
+
+// A map that never outgrows its inline storage never allocates
+TEST(small_maps_do_not_allocate) {
+    test::counting_resource resource;
+    mstd::small_map<int, int, 8> map(&resource);
+    for (int i = 0; i < 8; i++) {
+        map.insert(i, i);
+    }
+    CHECK(map.is_small());
+    CHECK(resource.allocations() == 0);
+    map.insert(8, 8);
+    CHECK(!map.is_small());
+    CHECK(resource.allocations() > 0);
+    for (int i = 0; i <= 8; i++) {
+        REQUIRE(map.get(i) == i);
+    }
+}
+
+TEST(inline_elements_are_destroyed) {
+    long live = test::tracked::live();
+    {
+        mstd::small_map<int, test::tracked, 4> map;
+        for (int i = 0; i < 4; i++) {
+            map.insert(i, test::tracked(i));
+        }
+        map.erase(1);
+        CHECK(map.get(3).value == 3);
+        mstd::small_map<int, test::tracked, 4> moved(std::move(map));
+        CHECK(moved.get(2).value == 2);
+        CHECK(map.empty());
+        for (int i = 10; i < 20; i++) {
+            moved.insert(i, test::tracked(i));
+        }
+    }
+    CHECK(test::tracked::live() == live);
+}
+
+TEST(missing_keys) {
+    mstd::small_map<std::string, int> map;
+    CHECK(!map.contains("a"));
+    CHECK(map.find("a") == nullptr);
+    CHECK_THROWS(map.get("a"), std::runtime_error);
+    CHECK(!map.erase("a"));
+    CHECK(map[std::string("a")] == 0);
+    CHECK(map.contains("a"));
+}
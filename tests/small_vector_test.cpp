@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "small_vector.hpp"
+#include "test.hpp"
+
+template <typename T, size_t N>
+static void check_same(const mstd::small_vector<T, N> &vec, const std::vector<T> &model) {
+    REQUIRE(vec.size() == model.size());
+    REQUIRE(vec.capacity() >= vec.size());
+    if (model.size() > N) REQUIRE(!vec.is_small());
+    for (size_t i = 0; i < model.size(); i++) {
+        REQUIRE(vec[i] == model[i]);
+    }
+}
+
+// Pushes, inserts and removals against std::vector, with the size moving back and forth across N.
+// Copies and moves are taken along the way, from inline and heap vectors alike
+template <typename T, size_t N, typename Make>
+static void check_random_operations(Make make) {
+    test::counting_resource resource;
+    {
+        mstd::small_vector<T, N> vec(N, &resource);
+        std::vector<T> model;
+        for (int op = 0; op < 20000; op++) {
+            T value = make((int) test::random(100));
+            // Drifts between about 0 and 3N elements
+            bool grow = model.size() < N * 3 / 2 ? test::random(3) != 0 : test::random(3) == 0;
+            switch (test::random(4)) {
+                case 0:
+                    if (grow) {
+                        vec.push(value);
+                        model.push_back(value);
+                    } else if (!model.empty()) {
+                        REQUIRE(vec.back() == model.back());
+                        vec.pop_back();
+                        model.pop_back();
+                    }
+                    break;
+                case 1:
+                    if (grow) {
+                        int index = (int) test::random(model.size() + 1);
+                        T copy(value);
+                        vec.m_insert_at(index, copy);
+                        model.insert(model.begin() + index, value);
+                    } else if (!model.empty()) {
+                        size_t index = test::random(model.size());
+                        vec.remove_at(index);
+                        model.erase(model.begin() + (long) index);
+                    }
+                    break;
+                case 2:
+                    REQUIRE(vec.find(value) == (size_t) (std::find(model.begin(), model.end(), value) - model.begin()));
+                    REQUIRE(vec.count(value) == (size_t) std::count(model.begin(), model.end(), value));
+                    break;
+                default:
+                    switch (test::random(20)) {
+                        case 0: {
+                            mstd::small_vector<T, N> copy(vec);
+                            check_same(copy, model);
+                            REQUIRE(copy.equal(vec));
+                            vec = std::move(copy);
+                            break;
+                        }
+                        case 1: {
+                            mstd::small_vector<T, N> moved(std::move(vec));
+                            check_same(moved, model);
+                            vec = moved;
+                            break;
+                        }
+                        case 2:
+                            vec.shrink_to_size();
+                            if (model.size() <= N) REQUIRE(vec.is_small());
+                            break;
+                        default:
+                            break;
+                    }
+                    break;
+            }
+            check_same(vec, model);
+        }
+        vec.clear();
+        CHECK(vec.size() == 0);
+    }
+    CHECK(resource.allocations() == 0);
+}
+
+TEST(random_operations_trivial) {
+    check_random_operations<int, 8>([](int i) { return i; });
+    check_random_operations<int, 1>([](int i) { return i; });
+}
+
+TEST(random_operations_strings) {
+    check_random_operations<std::string, 4>([](int i) { return std::string(i % 40, (char) ('a' + i % 26)); });
+}
+
+TEST(random_operations_tracked) {
+    long live = test::tracked::live();
+    check_random_operations<test::tracked, 6>([](int i) { return test::tracked(i); });
+    CHECK(test::tracked::live() == live);
+}
+
+TEST(inline_vectors_do_not_allocate) {
+    test::counting_resource resource;
+    mstd::small_vector<int, 16> vec(16, &resource);
+    for (int i = 0; i < 16; i++) {
+        vec.push(i);
+    }
+    CHECK(vec.is_small());
+    CHECK(resource.allocations() == 0);
+    vec.push(16);
+    CHECK(!vec.is_small());
+    CHECK(resource.allocations() == 1);
+    vec.pop_back();
+    vec.shrink_to_size();
+    CHECK(vec.is_small());
+    CHECK(resource.allocations() == 0);
+    CHECK(vec[15] == 15);
+}
+
+TEST(push_own_element) {
+    mstd::small_vector<std::string, 2> vec;
+    vec.push(std::string(30, 'x'));
+    for (int i = 0; i < 50; i++) {
+        vec.push(vec[0]);
+        vec.emplace(vec.back());
+    }
+    for (const std::string &s : vec) {
+        REQUIRE(s == std::string(30, 'x'));
+    }
+}
+
+TEST(slices_and_bounds) {
+    mstd::small_vector<int, 4> vec;
+    for (int i = 0; i < 10; i++) {
+        vec.push(i);
+    }
+    CHECK(vec.slice(3, 7).size() == 4);
+    CHECK(vec.slice(3, 7)[0] == 3);
+    const mstd::small_vector<int, 4> &cvec = vec;
+    mstd::span<const int> all = cvec;
+    CHECK(all.size() == 10);
+    CHECK(vec.max_element() == 9);
+    CHECK(vec.min_element() == 0);
+    CHECK_THROWS(vec.slice(7, 3), std::out_of_range);
+    CHECK_THROWS(vec.at(10), std::out_of_range);
+    CHECK_THROWS(vec.set_growth_factor(0.5), std::invalid_argument);
+
+    mstd::small_vector<int, 4> part(vec, 2, 5);
+    CHECK(part.is_small());
+    CHECK(part.size() == 3);
+    CHECK(part[0] == 2);
+}
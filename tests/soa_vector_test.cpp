@@ -0,0 +1,167 @@
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "soa_vector.hpp"
+#include "test.hpp"
+
+typedef mstd::soa_vector<long, double, std::string, test::tracked> table;
+typedef std::tuple<long, double, std::string, int> model_row;
+
+static void check_same(const table &t, const std::vector<model_row> &model) {
+    REQUIRE(t.size() == model.size());
+    REQUIRE(t.column<0>().size() == model.size());
+    for (size_t i = 0; i < model.size(); i++) {
+        REQUIRE(t.get<0>(i) == std::get<0>(model[i]));
+        REQUIRE(t.column<1>()[i] == std::get<1>(model[i]));
+        REQUIRE(t.get<2>(i) == std::get<2>(model[i]));
+        REQUIRE(std::get<3>(t.record(i)).value == std::get<3>(model[i]));
+    }
+}
+
+// Pushes (every overload), row writes, removals and pops against a std::vector of tuples
+TEST(random_operations_against_vector) {
+    long live = test::tracked::live();
+    test::counting_resource resource;
+    {
+        table t(1, &resource);
+        std::vector<model_row> model;
+        for (int op = 0; op < 20000; op++) {
+            long a = (long) test::random(1000);
+            double b = (double) test::random(1000) / 8;
+            std::string c = test::random_string(0, 30);
+            int d = (int) test::random(1000);
+            switch (test::random(op < 10000 ? 6 : 8)) {
+                case 0:
+                    t.push(a, b, c, test::tracked(d));
+                    model.emplace_back(a, b, c, d);
+                    break;
+                case 1: {
+                    const long ca = a;
+                    const double cb = b;
+                    const test::tracked cd(d);
+                    t.push(ca, cb, c, cd);
+                    model.emplace_back(a, b, c, d);
+                    break;
+                }
+                case 2:
+                    t.push(std::make_tuple(a, b, c, test::tracked(d)));
+                    model.emplace_back(a, b, c, d);
+                    break;
+                case 3:
+                    if (!model.empty()) {
+                        size_t i = test::random(model.size());
+                        t[i] = std::make_tuple(a, b, c, test::tracked(d));
+                        model[i] = model_row(a, b, c, d);
+                    }
+                    break;
+                case 4:
+                    if (!model.empty()) {
+                        size_t i = test::random(model.size());
+                        t.at(i).get<2>() = c;
+                        t.get<0>(i) += 1;
+                        std::get<2>(model[i]) = c;
+                        std::get<0>(model[i]) += 1;
+                    }
+                    break;
+                case 5:
+                case 6:
+                    if (!model.empty()) {
+                        size_t i = test::random(model.size());
+                        t.remove_at(i);
+                        model.erase(model.begin() + (long) i);
+                    }
+                    break;
+                default:
+                    if (!model.empty()) {
+                        t.pop_back();
+                        model.pop_back();
+                    }
+                    break;
+            }
+            if (op % 1000 == 0) check_same(t, model);
+        }
+        check_same(t, model);
+
+        table copy(t);
+        check_same(copy, model);
+        table moved(std::move(copy));
+        check_same(moved, model);
+        copy = moved;
+        check_same(copy, model);
+        t.clear();
+        CHECK(t.size() == 0);
+        t.reserve(1000);
+        CHECK(t.capacity() >= 1000);
+    }
+    CHECK(resource.allocations() == 0);
+    CHECK(test::tracked::live() == live);
+}
+
+TEST(columns_are_contiguous) {
+    mstd::soa_vector<int, double> t;
+    for (int i = 0; i < 100; i++) {
+        t.push(i, i * 0.5);
+    }
+    mstd::span<int> ids = t.column<0>();
+    CHECK(ids.size() == 100);
+    CHECK(&ids[99] - &ids[0] == 99);
+    CHECK(ids.find(42) == 42);
+    CHECK(t.column<1>().max_element() == 99);
+    for (int &id : ids) {
+        id *= 2;
+    }
+    CHECK(t.get<0>(21) == 42);
+
+    const mstd::soa_vector<int, double> &ct = t;
+    mstd::span<const double> prices = ct.column<1>();
+    CHECK(prices[10] == 5.0);
+    std::tuple<int, double> r = t[3];
+    CHECK(std::get<0>(r) == 6);
+}
+
+TEST(bounds) {
+    mstd::soa_vector<int, std::string> t;
+    CHECK_THROWS(t.at(0), std::out_of_range);
+    CHECK_THROWS(t.remove_at(0), std::out_of_range);
+    t.pop_back();
+    t.push(1, "one");
+    CHECK_THROWS(t.get<1>(1), std::out_of_range);
+    CHECK(t.at(0).get<1>() == "one");
+}
+
+// A field that throws while a record is pushed leaves the vector as it was, with no field leaked
+struct throws_on_copy {
+    static int &countdown() {
+        static int n = 0;
+        return n;
+    }
+
+    test::tracked t;
+
+    throws_on_copy() { }
+    throws_on_copy(const throws_on_copy &other) : t(other.t) {
+        if (--countdown() == 0) throw std::runtime_error("copy failed");
+    }
+};
+
+TEST(push_is_exception_safe) {
+    long live = test::tracked::live();
+    {
+        mstd::soa_vector<test::tracked, std::string, throws_on_copy> t;
+        throws_on_copy field;
+        for (int i = 0; i < 50; i++) {
+            throws_on_copy::countdown() = i % 5 == 4 ? 1 : 1000;
+            try {
+                t.push(test::tracked(i), std::string(40, 's'), field);
+            } catch (const std::runtime_error &) {
+                continue;
+            }
+        }
+        CHECK(t.size() == 40);
+        for (size_t i = 0; i < t.size(); i++) {
+            REQUIRE(t.get<0>(i).value % 5 != 4);
+        }
+    }
+    CHECK(test::tracked::live() == live);
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "helpers.hpp"
+#include "mvector.hpp"
+#include "small_vector.hpp"
+#include "soa_vector.hpp"
+#include "span.hpp"
+#include "string_view.hpp"
+#include "test.hpp"
+
+// Const containers only hand out read-only views, and a read-only view doesn't turn back into a writable one
+static_assert(std::is_same<decltype(std::declval<const mstd::vector<int> &>().slice(0, 0)),
+                           mstd::span<const int>>::value, "const vector slices are read-only");
+static_assert(std::is_same<decltype(std::declval<mstd::vector<int> &>().slice(0, 0)),
+                           mstd::span<int>>::value, "vector slices are writable");
+static_assert(std::is_same<decltype(std::declval<const mstd::small_vector<int, 4> &>().slice(0, 0)),
+                           mstd::span<const int>>::value, "const small_vector slices are read-only");
+static_assert(std::is_same<decltype(std::declval<const mstd::soa_vector<int, double> &>().column<1>()),
+                           mstd::span<const double>>::value, "const soa_vector columns are read-only");
+static_assert(std::is_convertible<const mstd::vector<int> &, mstd::span<const int>>::value,
+              "const vectors convert to read-only spans");
+static_assert(!std::is_convertible<const mstd::vector<int> &, mstd::span<int>>::value,
+              "const vectors don't convert to writable spans");
+static_assert(std::is_convertible<mstd::span<int>, mstd::span<const int>>::value,
+              "writable spans convert to read-only ones");
+static_assert(!std::is_convertible<mstd::span<const int>, mstd::span<int>>::value,
+              "read-only spans don't convert to writable ones");
+
+// Searches against the obvious loops, on random subspans of random arrays
+TEST(searches_on_subspans) {
+    std::vector<int> data(500);
+    for (int &x : data) {
+        x = (int) test::random(50);
+    }
+    mstd::span<const int> all(data.data(), data.size());
+    for (int i = 0; i < 2000; i++) {
+        size_t pos = test::random(data.size() + 1);
+        size_t n = test::random(2) == 0 ? mstd::span<int>::npos : test::random(data.size());
+        mstd::span<const int> s = all.subspan(pos, n);
+        size_t expected_size = std::min(n, data.size() - pos);
+        REQUIRE(s.size() == expected_size);
+        REQUIRE(s.data() == data.data() + pos);
+
+        int value = (int) test::random(55);
+        size_t first = s.size(), matches = 0, lo = 0, hi = 0;
+        for (size_t k = 0; k < s.size(); k++) {
+            if (s[k] == value) {
+                if (first == s.size()) first = k;
+                matches++;
+            }
+            if (s[k] < s[lo]) lo = k;
+            if (s[hi] < s[k]) hi = k;
+        }
+        REQUIRE(s.find(value) == first);
+        REQUIRE(s.in(value) == (matches > 0));
+        REQUIRE(s.count(value) == matches);
+        REQUIRE(s.min_element() == lo);
+        REQUIRE(s.max_element() == hi);
+        REQUIRE(s.equal(mstd::span<const int>(data.data() + pos, expected_size)));
+    }
+    CHECK_THROWS(all.subspan(data.size() + 1), std::out_of_range);
+    CHECK(all.subspan(data.size()).empty());
+}
+
+TEST(writes_through_spans) {
+    mstd::vector<int> vec;
+    for (int i = 0; i < 20; i++) {
+        vec.push(i);
+    }
+    mstd::span<int> s = vec;
+    for (int &x : s.subspan(5, 5)) {
+        x = -x;
+    }
+    CHECK(vec[5] == -5 && vec[9] == -9 && vec[10] == 10);
+
+    mstd::span<const int> ro = s;
+    CHECK(ro.find(-7) == 7);
+    CHECK(!ro.equal(vec.slice(0, 19)));
+    mstd::span<int> empty;
+    CHECK(empty.empty());
+    CHECK(empty.find(1) == 0);
+}
+
+TEST(split_and_join) {
+    mstd::vector<std::string> parts;
+    helpers::split(",a,,bc,def,", parts, ',');
+    CHECK(parts.size() == 3);
+    CHECK(parts[0] == "a" && parts[1] == "bc" && parts[2] == "def");
+    CHECK(helpers::join(parts, '-') == "a-bc-def");
+
+    std::string text = "one two  three ";
+    mstd::small_vector<mstd::string_view, 4> views;
+    helpers::split_views(mstd::string_view(text.data(), text.size()), views, ' ');
+    CHECK(views.size() == 3);
+    CHECK(views[2].size() == 5);
+    CHECK(views[1].data() == text.data() + 4);
+    CHECK(helpers::join(views, ',') == "one,two,three");
+    CHECK(helpers::join(views.slice(1, 3), ',') == "two,three");
+
+    mstd::vector<std::string> none;
+    helpers::split("", none, ',');
+    helpers::split(",,,", none, ',');
+    CHECK(none.size() == 0);
+    CHECK(helpers::join(none, ',').empty());
+}
+
+// split then join gives back the input, for random inputs with no empty parts
+TEST(split_join_round_trip) {
+    for (int i = 0; i < 500; i++) {
+        std::string s;
+        size_t n = test::random(20);
+        for (size_t k = 0; k < n; k++) {
+            if (k > 0) s += ';';
+            s += test::random_string(1, 10);
+        }
+        mstd::vector<std::string> parts;
+        helpers::split(s, parts, ';');
+        REQUIRE(helpers::join(parts, ';') == s);
+        mstd::vector<mstd::string_view> views;
+        helpers::split_views(mstd::string_view(s.data(), s.size()), views, ';');
+        REQUIRE(views.size() == parts.size());
+        REQUIRE(helpers::join(views, ';') == s);
+    }
+}
@@ -0,0 +1,123 @@
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc_channel.hpp"
+#include "test.hpp"
+
+TEST(single_thread) {
+    mstd::spsc_channel<int> channel(5);
+    CHECK(channel.capacity() == 8);
+    for (int i = 0; i < 8; i++) {
+        REQUIRE(channel.try_push(int(i)));
+    }
+    CHECK(!channel.try_push(8));
+    CHECK(channel.size() == 8);
+
+    int out[4];
+    CHECK(channel.try_pop_batch(out, 3) == 3);
+    CHECK(out[0] == 0 && out[2] == 2);
+    int more[6] = {8, 9, 10, 11, 12, 13};
+    CHECK(channel.try_push_batch(more, 6) == 3);
+
+    int value;
+    for (int i = 3; i < 11; i++) {
+        REQUIRE(channel.try_pop(value));
+        REQUIRE(value == i);
+    }
+    CHECK(!channel.try_pop(value));
+
+    channel.push(1);
+    channel.close();
+    CHECK(channel.closed());
+    CHECK_THROWS(channel.push(2), std::runtime_error);
+    CHECK(channel.pop(value) && value == 1);
+    CHECK(!channel.pop(value));
+    CHECK(channel.pop_batch(out, 4) == 0);
+}
+
+// One producer and one consumer, with random mixes of single and batch calls on both sides:
+// the consumer sees every value exactly once, in order
+static void check_order(size_t capacity, bool blocking) {
+    const size_t n = 200000;
+    mstd::spsc_channel<uint64_t> channel(capacity, blocking);
+    uint64_t producer_seed = test::rng()(), consumer_seed = test::rng()();
+    uint64_t expected = 0;
+    bool in_order = true;
+
+    std::thread consumer([&]() {
+        std::mt19937_64 rng(consumer_seed);
+        std::vector<uint64_t> buffer(64);
+        for (;;) {
+            size_t got;
+            if (rng() % 2 == 0) {
+                uint64_t value;
+                if (!channel.pop(value)) break;
+                buffer[0] = value;
+                got = 1;
+            } else {
+                got = channel.pop_batch(buffer.data(), 1 + rng() % buffer.size());
+                if (got == 0) break;
+            }
+            for (size_t i = 0; i < got; i++) {
+                if (buffer[i] != expected++) in_order = false;
+            }
+        }
+    });
+
+    std::mt19937_64 rng(producer_seed);
+    std::vector<uint64_t> batch;
+    uint64_t next = 0;
+    while (next < n) {
+        if (rng() % 2 == 0) {
+            channel.push(next++);
+        } else {
+            batch.clear();
+            size_t size = 1 + rng() % 100;
+            for (size_t i = 0; i < size && next < n; i++) {
+                batch.push_back(next++);
+            }
+            channel.push_batch(batch.data(), batch.size());
+        }
+    }
+    channel.close();
+    consumer.join();
+
+    CHECK(in_order);
+    CHECK(expected == n);
+}
+
+TEST(order_blocking) {
+    check_order(16, true);
+    check_order(1, true);
+    check_order(1024, true);
+}
+
+TEST(order_non_blocking) {
+    check_order(16, false);
+    check_order(1024, false);
+}
+
+// Values are moved through, and whatever is still in the ring is destroyed with it
+TEST(move_only_values) {
+    long live = test::tracked::live();
+    {
+        mstd::spsc_channel<std::unique_ptr<test::tracked>> channel(64);
+        std::thread producer([&channel]() {
+            for (int i = 0; i < 10000; i++) {
+                channel.push(std::unique_ptr<test::tracked>(new test::tracked(i)));
+            }
+            channel.close();
+        });
+        std::unique_ptr<test::tracked> p;
+        int expected = 0;
+        bool in_order = true;
+        // Leaves the rest of the values in the ring
+        while (expected < 9990 && channel.pop(p)) {
+            if (p->value != expected++) in_order = false;
+        }
+        producer.join();
+        CHECK(in_order);
+    }
+    CHECK(test::tracked::live() == live);
+}
@@ -0,0 +1,172 @@
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "memory_resource.hpp"
+
+namespace test_constants {
+    // Seed of the randomized tests, unless MSTD_TEST_SEED says otherwise
+    const uint64_t default_seed = 0x6d737464;
+}
+
+// Minimal test harness. TEST(name) { ... } defines a test case, CHECK(cond) records a failure and carries on,
+// REQUIRE(cond) also ends the case. test_main.cpp runs every case, or those whose name contains argv[1].
+// Randomized cases draw from test::rng(), which is reseeded for every case from MSTD_TEST_SEED and the case's
+// name: a failure is replayed by running that case again with the seed printed at the start
+namespace test {
+    struct test_case {
+        const char *name;
+        void (*run)();
+    };
+
+    // Thrown by REQUIRE to end a case
+    struct abort_case { };
+
+    inline std::vector<test_case> &cases() {
+        static std::vector<test_case> all;
+        return all;
+    }
+
+    inline size_t &failures() {
+        static size_t count = 0;
+        return count;
+    }
+
+    struct registrar {
+        registrar(const char *name, void (*run)()) {
+            cases().push_back(test_case{name, run});
+        }
+    };
+
+    inline uint64_t seed() {
+        static uint64_t s = getenv("MSTD_TEST_SEED") != nullptr ? strtoull(getenv("MSTD_TEST_SEED"), nullptr, 0)
+                                                                : test_constants::default_seed;
+        return s;
+    }
+
+    // FNV-1a: the same on every platform, unlike std::hash
+    inline uint64_t name_hash(const char *name) {
+        uint64_t h = 0xcbf29ce484222325LLU;
+        for (; *name != '\0'; name++) {
+            h = (h ^ (uint8_t) *name) * 0x100000001b3LLU;
+        }
+        return h;
+    }
+
+    inline std::mt19937_64 &rng() {
+        static std::mt19937_64 generator(seed());
+        return generator;
+    }
+
+    // Uniform in [0, n)
+    inline uint64_t random(uint64_t n) {
+        return std::uniform_int_distribution<uint64_t>(0, n - 1)(rng());
+    }
+
+    inline std::string random_string(size_t min_length, size_t max_length) {
+        size_t length = min_length + random(max_length - min_length + 1);
+        std::string s(length, ' ');
+        for (size_t i = 0; i < length; i++) {
+            s[i] = (char) ('a' + random(26));
+        }
+        return s;
+    }
+
+    // n distinct strings: a random prefix makes them differ in length and content, the index makes them unique
+    inline std::vector<std::string> distinct_strings(size_t n, const char *tag = "key") {
+        std::vector<std::string> keys;
+        keys.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            keys.push_back(random_string(0, 24) + tag + std::to_string(i));
+        }
+        return keys;
+    }
+
+    inline void fail(const char *file, int line, const char *what) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+        failures()++;
+    }
+
+    // Counts live instances, to check that containers construct and destroy every element exactly once.
+    // Atomic, since values handed between threads die on another thread than the one that made them.
+    // Not trivially copyable, so containers take their non-memcpy paths
+    struct tracked {
+        static std::atomic<long> &live() {
+            static std::atomic<long> count(0);
+            return count;
+        }
+
+        int value;
+
+        tracked(int v = 0) : value(v) { live()++; }
+        tracked(const tracked &other) : value(other.value) { live()++; }
+        tracked(tracked &&other) : value(other.value) { other.value = -1; live()++; }
+        ~tracked() { live()--; }
+
+        tracked &operator=(const tracked &other) { value = other.value; return *this; }
+        tracked &operator=(tracked &&other) { value = other.value; other.value = -1; return *this; }
+
+        bool operator==(const tracked &other) const { return value == other.value; }
+        bool operator<(const tracked &other) const { return value < other.value; }
+    };
+
+    // Hands everything on to upstream, and keeps track of what is still allocated
+    class counting_resource : public mstd::memory_resource {
+    public:
+        explicit counting_resource(mstd::memory_resource *upstream = mstd::default_resource())
+                : _upstream(upstream), _allocations(0), _bytes(0) { }
+
+        // Blocks (bytes) allocated and not deallocated yet
+        long allocations() const { return _allocations; }
+
+        long bytes() const { return _bytes; }
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            void *p = _upstream->allocate(bytes, alignment);
+            _allocations++;
+            _bytes += (long) bytes;
+            return p;
+        }
+
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+            _upstream->deallocate(p, bytes, alignment);
+            _allocations--;
+            _bytes -= (long) bytes;
+        }
+
+    private:
+        mstd::memory_resource *_upstream;
+        long _allocations;
+        long _bytes;
+    };
+}
+
+#define TEST_CONCAT_(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_(a, b)
+
+#define TEST(name) \
+    static void name(); \
+    static test::registrar TEST_CONCAT(name, _registrar)(#name, &name); \
+    static void name()
+
+#define CHECK(cond) \
+    do { if (!(cond)) test::fail(__FILE__, __LINE__, #cond); } while (0)
+
+#define REQUIRE(cond) \
+    do { if (!(cond)) { test::fail(__FILE__, __LINE__, #cond); throw test::abort_case(); } } while (0)
+
+#define CHECK_THROWS(expr, type) \
+    do { \
+        bool thrown_ = false; \
+        try { expr; } catch (const type &) { thrown_ = true; } \
+        if (!thrown_) test::fail(__FILE__, __LINE__, #expr " throws " #type); \
+    } while (0)
+
+#endif // TEST_HPP
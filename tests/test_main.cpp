@@ -0,0 +1,31 @@
+#include <cstring>
+#include <exception>
+#include "simd.hpp"
+#include "test.hpp"
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+    printf("seed: %#llx (set MSTD_TEST_SEED to replay another)\n", (unsigned long long) test::seed());
+    // Also what pulls the kernels out of the static library, so containers' searches run through them
+    printf("simd: %s\n", mstd::simd::isa_name(mstd::simd::current_isa()));
+
+    size_t run = 0;
+    for (const test::test_case &c : test::cases()) {
+        if (filter != nullptr && strstr(c.name, filter) == nullptr) continue;
+
+        size_t before = test::failures();
+        // Every case gets its own stream, so that its inputs don't depend on which cases ran before it
+        test::rng().seed(test::seed() ^ test::name_hash(c.name));
+        try {
+            c.run();
+        } catch (const test::abort_case &) {
+        } catch (const std::exception &e) {
+            test::fail(__FILE__, __LINE__, e.what());
+        }
+        printf("%s %s\n", test::failures() == before ? "ok  " : "FAIL", c.name);
+        run++;
+    }
+
+    printf("%zu cases, %zu failed checks\n", run, test::failures());
+    return test::failures() == 0 && run > 0 ? 0 : 1;
+}
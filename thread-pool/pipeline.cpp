@@ -0,0 +1,158 @@
+#include "pipeline.hpp"
+
+mstd::pipeline::pipeline(thread_pool &pool, size_t batch_size, size_t max_in_flight)
+        : _pool(pool), _batch_size(batch_size > 0 ? batch_size : 1), _max_in_flight(max_in_flight > 0 ? max_in_flight : 1),
+          _in_flight(0), _next_seq(0), _source_busy(false), _source_done(false) {
+    pthread_mutex_init(&_mtx, nullptr);
+    pthread_cond_init(&_done_cond, nullptr);
+}
+
+mstd::pipeline::~pipeline() {
+    for (size_t i = 0; i < _stages.size(); i++) {
+        delete _stages[i];
+    }
+    pthread_mutex_destroy(&_mtx);
+    pthread_cond_destroy(&_done_cond);
+}
+
+void mstd::pipeline::run() {
+    if (!_source) throw std::runtime_error("Pipeline has no source");
+
+    pthread_mutex_lock(&_mtx);
+    _next_seq = 0;
+    _source_done = false;
+    for (size_t i = 0; i < _stages.size(); i++) {
+        _stages[i]->next_seq = 0;
+    }
+    pthread_mutex_unlock(&_mtx);
+
+    _pump();
+
+    pthread_mutex_lock(&_mtx);
+    while (!_source_done || _in_flight > 0) {
+        pthread_cond_wait(&_done_cond, &_mtx);
+    }
+    pthread_mutex_unlock(&_mtx);
+}
+
+void mstd::pipeline::_add_stage(stage_mode mode, std::function<void (batch &)> f) {
+    auto *s = new stage();
+    s->mode = mode;
+    s->f = std::move(f);
+    s->busy = false;
+    s->next_seq = 0;
+    _stages.push(s);
+}
+
+void mstd::pipeline::_pump() {
+    pthread_mutex_lock(&_mtx);
+    bool start = _reserve_source();
+    pthread_mutex_unlock(&_mtx);
+
+    if (start) {
+        _pool.add_task([this] { _produce(); });
+    }
+}
+
+bool mstd::pipeline::_reserve_source() {
+    if (_source_busy || _source_done || _in_flight >= _max_in_flight) {
+        return false;
+    }
+    _source_busy = true;
+    _in_flight++;
+    return true;
+}
+
+void mstd::pipeline::_produce() {
+    auto *b = new batch();
+    bool more = _source(*b);
+    // Empty batches don't take a number, so that in-order stages never wait for them
+    if (b->items != nullptr) {
+        b->seq = _next_seq++;
+    }
+
+    pthread_mutex_lock(&_mtx);
+    _source_busy = false;
+    if (!more) {
+        _source_done = true;
+    }
+    pthread_mutex_unlock(&_mtx);
+
+    // The source works on the next batch while this one goes down the pipeline
+    _pump();
+
+    if (b->items == nullptr) {
+        _finish(b);
+        return;
+    }
+    _advance(b, 0, false);
+}
+
+void mstd::pipeline::_advance(batch *b, size_t first, bool owns_first) {
+    for (size_t i = first; i < _stages.size(); i++) {
+        stage *s = _stages[i];
+        if (s->mode == stage_parallel) {
+            s->f(*b);
+            continue;
+        }
+
+        if (i != first || !owns_first) {
+            pthread_mutex_lock(&_mtx);
+            if (s->busy || (s->mode == stage_serial_in_order && b->seq != s->next_seq)) {
+                s->pending.push(b);
+                pthread_mutex_unlock(&_mtx);
+                return;
+            }
+            s->busy = true;
+            pthread_mutex_unlock(&_mtx);
+        }
+
+        s->f(*b);
+
+        pthread_mutex_lock(&_mtx);
+        s->next_seq++;
+        batch *ready = _take_ready(s);
+        // The stage goes straight to the parked batch, which a new task carries on from here
+        s->busy = ready != nullptr;
+        pthread_mutex_unlock(&_mtx);
+
+        if (ready != nullptr) {
+            _pool.add_task([this, ready, i] { _advance(ready, i, true); });
+        }
+    }
+
+    _finish(b);
+}
+
+mstd::pipeline::batch *mstd::pipeline::_take_ready(stage *s) {
+    for (size_t j = 0; j < s->pending.size(); j++) {
+        batch *p = s->pending[j];
+        if (s->mode == stage_serial || p->seq == s->next_seq) {
+            s->pending[j] = s->pending.back();
+            s->pending.pop_back();
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+void mstd::pipeline::_finish(batch *b) {
+    if (b->items != nullptr) {
+        b->destroy(b->items);
+    }
+    delete b;
+
+    // Once b no longer counts, run() may return and the pipeline go away: nothing touches it after the unlock,
+    // unless the source is restarted (and its batch keeps the pipeline alive)
+    pthread_mutex_lock(&_mtx);
+    _in_flight--;
+    if (_source_done && _in_flight == 0) {
+        pthread_cond_broadcast(&_done_cond);
+    }
+    bool start = _reserve_source();
+    pthread_mutex_unlock(&_mtx);
+
+    if (start) {
+        _pool.add_task([this] { _produce(); });
+    }
+}
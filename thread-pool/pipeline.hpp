@@ -0,0 +1,192 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <functional>
+#include <stdexcept>
+#include <pthread.h>
+#include "mvector.hpp"
+#include "thread_pool.hpp"
+
+namespace pipeline_constants {
+    // Items the source is asked for at a time
+    const size_t default_batch_size = 1024;
+    // Batches that can be between the source and the end of the pipeline at once
+    const size_t default_max_in_flight = 8;
+}
+
+namespace mstd {
+    enum stage_mode {
+        // Runs on any number of batches at once
+        stage_parallel,
+        // Runs on one batch at a time, in any order
+        stage_serial,
+        // Runs on one batch at a time, in the order the source produced them
+        stage_serial_in_order
+    };
+
+    template <typename T>
+    class pipeline_builder;
+
+    // Streams batches of items from a source through a chain of stages, on the workers of a thread_pool.
+    //
+    //     mstd::pipeline p(pool);
+    //     p.source<std::string>([&](mstd::vector<std::string> &out, size_t max) { ...; return !done; })
+    //      .then<record>(mstd::stage_parallel, [](mstd::vector<std::string> &in, mstd::vector<record> &out) { ... })
+    //      .apply(mstd::stage_serial_in_order, [&](mstd::vector<record> &in) { ... });
+    //     p.run();
+    //
+    // Every batch is carried through the stages by pool tasks: parallel stages run wherever the batch is,
+    // and a batch that reaches a busy serial stage (or an in-order stage before its turn) is parked there,
+    // and picked up by the task that frees the stage. No task ever blocks, so any number of stages share
+    // any number of workers.
+    // The source only produces a new batch while fewer than max_in_flight batches are in the pipeline:
+    // memory stays at max_in_flight batches however long the input is.
+    class pipeline {
+    public:
+        explicit pipeline(thread_pool &pool, size_t batch_size = pipeline_constants::default_batch_size,
+                          size_t max_in_flight = pipeline_constants::default_max_in_flight);
+        pipeline(const pipeline &)=delete;
+
+        ~pipeline();
+
+        // f appends up to max items to out, and returns false once the input is exhausted.
+        // It's the first stage, serial in order
+        template <typename T>
+        pipeline_builder<T> source(std::function<bool (mstd::vector<T> &, size_t)> f);
+
+        // Runs the pipeline until the source is exhausted and every batch has gone through every stage.
+        // Must not be called from one of the pool's workers
+        void run();
+
+        pipeline &operator=(const pipeline &)=delete;
+    private:
+        struct batch {
+            // Position in the source's output
+            size_t seq;
+            // The mstd::vector of the type the last stage produced
+            void *items;
+            void (*destroy)(void *);
+        };
+
+        struct stage {
+            stage_mode mode;
+            std::function<void (batch &)> f;
+            bool busy;
+            // Next batch an in-order stage accepts
+            size_t next_seq;
+            // Batches parked until the stage is free
+            mstd::vector<batch *> pending;
+        };
+
+        thread_pool &_pool;
+        size_t _batch_size;
+        size_t _max_in_flight;
+
+        std::function<bool (batch &)> _source;
+        mstd::vector<stage *> _stages;
+
+        pthread_mutex_t _mtx;
+        pthread_cond_t _done_cond;
+        size_t _in_flight;
+        size_t _next_seq;
+        bool _source_busy;
+        bool _source_done;
+
+        template <typename T>
+        static void _destroy(void *items);
+
+        void _add_stage(stage_mode mode, std::function<void (batch &)> f);
+
+        // Starts the source on a new batch, if it's idle and the pipeline has room
+        void _pump();
+
+        // With the lock held: claims the source and a place in the pipeline for a new batch
+        bool _reserve_source();
+
+        void _produce();
+
+        // Carries b through the stages from first on. If owns_first, the stage first was reserved for b
+        void _advance(batch *b, size_t first, bool owns_first);
+
+        // Removes a batch the stage can take next from its pending list, or returns nullptr
+        batch *_take_ready(stage *s);
+
+        void _finish(batch *b);
+
+        template <typename T>
+        friend class pipeline_builder;
+    };
+
+    // Adds stages after one that produces batches of T
+    template <typename T>
+    class pipeline_builder {
+    public:
+        // f moves (or copies) what it keeps of in, converted to U, to out
+        template <typename U>
+        pipeline_builder<U> then(stage_mode mode, std::function<void (mstd::vector<T> &, mstd::vector<U> &)> f);
+
+        // f works on the batch in place: filtering, updating, or consuming it
+        pipeline_builder<T> apply(stage_mode mode, std::function<void (mstd::vector<T> &)> f);
+
+    private:
+        pipeline *_pipeline;
+
+        explicit pipeline_builder(pipeline *p) : _pipeline(p) { }
+
+        friend class pipeline;
+
+        template <typename U>
+        friend class pipeline_builder;
+    };
+}
+
+template <typename T>
+mstd::pipeline_builder<T> mstd::pipeline::source(std::function<bool (mstd::vector<T> &, size_t)> f) {
+    size_t batch_size = _batch_size;
+    _source = [f, batch_size](batch &b) {
+        auto *items = new mstd::vector<T>(batch_size);
+        bool more = f(*items, batch_size);
+        if (items->size() == 0) {
+            delete items;
+            b.items = nullptr;
+        } else {
+            b.items = items;
+            b.destroy = &_destroy<T>;
+        }
+        return more;
+    };
+
+    return pipeline_builder<T>(this);
+}
+
+template <typename T>
+void mstd::pipeline::_destroy(void *items) {
+    delete static_cast<mstd::vector<T> *>(items);
+}
+
+template <typename T>
+template <typename U>
+mstd::pipeline_builder<U> mstd::pipeline_builder<T>::then(stage_mode mode,
+                                                          std::function<void (mstd::vector<T> &, mstd::vector<U> &)> f) {
+    _pipeline->_add_stage(mode, [f](pipeline::batch &b) {
+        auto *in = static_cast<mstd::vector<T> *>(b.items);
+        auto *out = new mstd::vector<U>(in->size() > 0 ? in->size() : 1);
+        f(*in, *out);
+        b.destroy(b.items);
+        b.items = out;
+        b.destroy = &pipeline::_destroy<U>;
+    });
+
+    return pipeline_builder<U>(_pipeline);
+}
+
+template <typename T>
+mstd::pipeline_builder<T> mstd::pipeline_builder<T>::apply(stage_mode mode, std::function<void (mstd::vector<T> &)> f) {
+    _pipeline->_add_stage(mode, [f](pipeline::batch &b) {
+        f(*static_cast<mstd::vector<T> *>(b.items));
+    });
+
+    return *this;
+}
+
+#endif // PIPELINE_HPP
@@ -0,0 +1,387 @@
+#ifndef SPSC_CHANNEL_HPP
+#define SPSC_CHANNEL_HPP
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace spsc_constants {
+    const size_t cache_line = 64;
+    // Times a blocked push or pop re-checks the ring before going to sleep
+    const int spin_count = 256;
+}
+
+namespace mstd {
+    // Bounded ring for handing values from exactly one producer thread to exactly one consumer thread.
+    // try_push and try_pop never wait: a push is a slot write and one release store of the tail, a pop
+    // the same on the head. Each side keeps a cached copy of the other side's index, on its own cache line,
+    // and only reloads it when the ring looks full (or empty), so most operations touch no shared line at all.
+    // The batch calls publish a whole batch with a single store.
+    // push and pop wait when the ring is full (or empty): they spin for a while, then sleep on a futex if the
+    // channel is blocking, or keep yielding the CPU if it isn't. A non-blocking channel saves the producer
+    // and consumer a fence per publish, at the cost of burning a core while waiting.
+    // Values are moved in and out, never copied. The producer calls close() once it's done: pop then drains
+    // what's left and returns false.
+    template <typename T>
+    class spsc_channel {
+    public:
+        // capacity is rounded up to a power of 2
+        explicit spsc_channel(size_t capacity, bool blocking = true);
+        spsc_channel(const spsc_channel &)=delete;
+
+        ~spsc_channel();
+
+        /* Producer */
+
+        // Returns false if the ring is full
+        bool try_push(T &&value);
+
+        // Waits while the ring is full. Throws if the channel is closed
+        void push(T &&value);
+
+        // Moves as many of values[0, n) as fit, and returns how many it moved
+        size_t try_push_batch(T *values, size_t n);
+
+        // Moves all of values[0, n), publishing as many at a time as fit
+        void push_batch(T *values, size_t n);
+
+        // No value can be pushed afterwards
+        void close();
+
+        /* Consumer */
+
+        // Returns false if the ring is empty
+        bool try_pop(T &out);
+
+        // Waits while the ring is empty. Returns false once the channel is closed and drained
+        bool pop(T &out);
+
+        // Moves up to max values to out, and returns how many it moved
+        size_t try_pop_batch(T *out, size_t max);
+
+        // Waits while the ring is empty, then moves up to max values. Returns 0 once the channel is closed
+        // and drained
+        size_t pop_batch(T *out, size_t max);
+
+        // Exact only when called from the producer or the consumer while the other one is idle
+        size_t size() const;
+
+        size_t capacity() const;
+
+        bool closed() const;
+
+        spsc_channel &operator=(const spsc_channel &)=delete;
+    private:
+        typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type slot;
+
+        // A side that sleeps on seq when the ring is full (or empty), and is woken by the other side
+        struct alignas(spsc_constants::cache_line) waiter {
+            std::atomic<uint32_t> seq;
+            std::atomic<uint32_t> waiting;
+        };
+
+        // Written by the producer only
+        struct alignas(spsc_constants::cache_line) producer_side {
+            std::atomic<size_t> tail;
+            size_t head_cache;
+        };
+
+        // Written by the consumer only
+        struct alignas(spsc_constants::cache_line) consumer_side {
+            std::atomic<size_t> head;
+            size_t tail_cache;
+        };
+
+        producer_side _producer;
+        consumer_side _consumer;
+        waiter _not_empty;
+        waiter _not_full;
+
+        slot *_slots;
+        size_t _capacity;
+        size_t _mask;
+        bool _blocking;
+        std::atomic<bool> _closed;
+
+        T &_item(size_t index) const;
+
+        // Free slots as seen by the producer, reloading the head only if fewer than n are known to be free
+        size_t _free_slots(size_t tail, size_t n);
+
+        // Full slots as seen by the consumer, reloading the tail only if the ring looks empty
+        size_t _full_slots(size_t head);
+
+        void _publish_tail(size_t tail);
+
+        void _publish_head(size_t head);
+
+        // Returns once ready() holds, or the channel is closed
+        template <typename F>
+        void _wait(waiter &w, F ready);
+
+        void _notify(waiter &w);
+
+        static void _cpu_relax();
+    };
+}
+
+template <typename T>
+mstd::spsc_channel<T>::spsc_channel(size_t capacity, bool blocking) : _blocking(blocking), _closed(false) {
+    _capacity = 1;
+    while (_capacity < capacity) {
+        _capacity <<= 1;
+    }
+    _mask = _capacity - 1;
+    _slots = new slot[_capacity];
+
+    _producer.tail.store(0);
+    _producer.head_cache = 0;
+    _consumer.head.store(0);
+    _consumer.tail_cache = 0;
+    _not_empty.seq.store(0);
+    _not_empty.waiting.store(0);
+    _not_full.seq.store(0);
+    _not_full.waiting.store(0);
+}
+
+template <typename T>
+mstd::spsc_channel<T>::~spsc_channel() {
+    size_t tail = _producer.tail.load();
+    for (size_t i = _consumer.head.load(); i != tail; i++) {
+        _item(i).~T();
+    }
+    delete[] _slots;
+}
+
+template <typename T>
+bool mstd::spsc_channel<T>::try_push(T &&value) {
+    size_t tail = _producer.tail.load(std::memory_order_relaxed);
+    if (_free_slots(tail, 1) == 0) {
+        return false;
+    }
+
+    new (&_item(tail)) T(std::move(value));
+    _publish_tail(tail + 1);
+    return true;
+}
+
+template <typename T>
+void mstd::spsc_channel<T>::push(T &&value) {
+    if (_closed.load(std::memory_order_relaxed)) throw std::runtime_error("Channel is closed");
+    while (!try_push(std::move(value))) {
+        size_t tail = _producer.tail.load(std::memory_order_relaxed);
+        _wait(_not_full, [this, tail] { return _free_slots(tail, 1) > 0; });
+    }
+}
+
+template <typename T>
+size_t mstd::spsc_channel<T>::try_push_batch(T *values, size_t n) {
+    size_t tail = _producer.tail.load(std::memory_order_relaxed);
+    size_t free = _free_slots(tail, n);
+    size_t count = free < n ? free : n;
+    if (count == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        new (&_item(tail + i)) T(std::move(values[i]));
+    }
+    _publish_tail(tail + count);
+    return count;
+}
+
+template <typename T>
+void mstd::spsc_channel<T>::push_batch(T *values, size_t n) {
+    if (_closed.load(std::memory_order_relaxed)) throw std::runtime_error("Channel is closed");
+    while (n > 0) {
+        size_t count = try_push_batch(values, n);
+        values += count;
+        n -= count;
+        if (n > 0) {
+            size_t tail = _producer.tail.load(std::memory_order_relaxed);
+            _wait(_not_full, [this, tail] { return _free_slots(tail, 1) > 0; });
+        }
+    }
+}
+
+template <typename T>
+void mstd::spsc_channel<T>::close() {
+    _closed.store(true);
+    // Unconditionally: a consumer that is about to sleep re-checks closed after announcing itself
+    _not_empty.seq.fetch_add(1);
+    if (_blocking) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&_not_empty.seq), FUTEX_WAKE_PRIVATE, INT_MAX,
+                nullptr, nullptr, 0);
+    }
+}
+
+template <typename T>
+bool mstd::spsc_channel<T>::try_pop(T &out) {
+    size_t head = _consumer.head.load(std::memory_order_relaxed);
+    if (_full_slots(head) == 0) {
+        return false;
+    }
+
+    T &item = _item(head);
+    out = std::move(item);
+    item.~T();
+    _publish_head(head + 1);
+    return true;
+}
+
+template <typename T>
+bool mstd::spsc_channel<T>::pop(T &out) {
+    while (!try_pop(out)) {
+        // The producer closes the channel after its last push: whatever it pushed is visible by then
+        if (_closed.load()) {
+            return try_pop(out);
+        }
+        size_t head = _consumer.head.load(std::memory_order_relaxed);
+        _wait(_not_empty, [this, head] { return _full_slots(head) > 0; });
+    }
+    return true;
+}
+
+template <typename T>
+size_t mstd::spsc_channel<T>::try_pop_batch(T *out, size_t max) {
+    size_t head = _consumer.head.load(std::memory_order_relaxed);
+    size_t full = _full_slots(head);
+    size_t count = full < max ? full : max;
+    if (count == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        T &item = _item(head + i);
+        out[i] = std::move(item);
+        item.~T();
+    }
+    _publish_head(head + count);
+    return count;
+}
+
+template <typename T>
+size_t mstd::spsc_channel<T>::pop_batch(T *out, size_t max) {
+    for (;;) {
+        size_t count = try_pop_batch(out, max);
+        if (count > 0 || max == 0) {
+            return count;
+        }
+        if (_closed.load()) {
+            return try_pop_batch(out, max);
+        }
+        size_t head = _consumer.head.load(std::memory_order_relaxed);
+        _wait(_not_empty, [this, head] { return _full_slots(head) > 0; });
+    }
+}
+
+template <typename T>
+size_t mstd::spsc_channel<T>::size() const {
+    return _producer.tail.load(std::memory_order_acquire) - _consumer.head.load(std::memory_order_acquire);
+}
+
+template <typename T>
+size_t mstd::spsc_channel<T>::capacity() const {
+    return _capacity;
+}
+
+template <typename T>
+bool mstd::spsc_channel<T>::closed() const {
+    return _closed.load();
+}
+
+template <typename T>
+T &mstd::spsc_channel<T>::_item(size_t index) const {
+    return *reinterpret_cast<T *>(&_slots[index & _mask]);
+}
+
+template <typename T>
+size_t mstd::spsc_channel<T>::_free_slots(size_t tail, size_t n) {
+    size_t free = _capacity - (tail - _producer.head_cache);
+    if (free < n) {
+        _producer.head_cache = _consumer.head.load(std::memory_order_acquire);
+        free = _capacity - (tail - _producer.head_cache);
+    }
+    return free;
+}
+
+template <typename T>
+size_t mstd::spsc_channel<T>::_full_slots(size_t head) {
+    size_t full = _consumer.tail_cache - head;
+    if (full == 0) {
+        _consumer.tail_cache = _producer.tail.load(std::memory_order_acquire);
+        full = _consumer.tail_cache - head;
+    }
+    return full;
+}
+
+template <typename T>
+void mstd::spsc_channel<T>::_publish_tail(size_t tail) {
+    _producer.tail.store(tail, std::memory_order_release);
+    _notify(_not_empty);
+}
+
+template <typename T>
+void mstd::spsc_channel<T>::_publish_head(size_t head) {
+    _consumer.head.store(head, std::memory_order_release);
+    _notify(_not_full);
+}
+
+// A sleeper announces itself in waiting, then re-checks the ring; a publisher stores its index, then
+// checks waiting. With a full fence on both sides, either the sleeper sees the new index or the publisher
+// sees the sleeper and bumps seq, so that the futex wait returns at once
+template <typename T>
+template <typename F>
+void mstd::spsc_channel<T>::_wait(waiter &w, F ready) {
+    for (int i = 0; i < spsc_constants::spin_count; i++) {
+        if (ready() || _closed.load(std::memory_order_relaxed)) return;
+        _cpu_relax();
+    }
+
+    while (!ready() && !_closed.load()) {
+        if (!_blocking) {
+            sched_yield();
+            continue;
+        }
+
+        uint32_t seq = w.seq.load();
+        w.waiting.store(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ready() || _closed.load()) {
+            w.waiting.store(0, std::memory_order_relaxed);
+            return;
+        }
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&w.seq), FUTEX_WAIT_PRIVATE, seq, nullptr, nullptr, 0);
+        w.waiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+void mstd::spsc_channel<T>::_notify(waiter &w) {
+    if (!_blocking) return;
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (w.waiting.load(std::memory_order_relaxed)) {
+        w.waiting.store(0, std::memory_order_relaxed);
+        w.seq.fetch_add(1);
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&w.seq), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+}
+
+template <typename T>
+void mstd::spsc_channel<T>::_cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+#endif // SPSC_CHANNEL_HPP
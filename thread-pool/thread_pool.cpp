@@ -1,4 +1,5 @@
 #include "thread_pool.hpp"
+#include "slab_allocator.hpp"
 #include <iostream>
 #include <cmath>
 
@@ -19,19 +20,25 @@ thread_pool::thread_pool(int num_threads) : _num_finished(0), _num_assigned(0) {
 }
 
 thread_pool::~thread_pool() {
+    // The workers use the mutex until they're joined
+    finish();
+
     pthread_mutex_destroy(&_finished_mtx);
     pthread_cond_destroy(&_finished_cond);
-
-    finish();
 }
 
+// Tasks can add tasks: the count is shared with the workers
 void thread_pool::add_task(task *t) {
+    pthread_mutex_lock(&_finished_mtx);
     _num_assigned++;
+    pthread_mutex_unlock(&_finished_mtx);
     _wq.add_task(t);
 }
 
 void thread_pool::add_task(std::function<void (void)> f) {
+    pthread_mutex_lock(&_finished_mtx);
     _num_assigned++;
+    pthread_mutex_unlock(&_finished_mtx);
     task *t = new _raw_task_(f);
     _wq.add_task(t);
 }
@@ -59,17 +66,16 @@ void thread_pool::wait_all() {
     }
 
     _num_finished = 0;
-    pthread_mutex_unlock(&_finished_mtx);
-
     _num_assigned = 0;
+    pthread_mutex_unlock(&_finished_mtx);
 }
 
 int thread_pool::get_active() {
     pthread_mutex_lock(&_finished_mtx);
-    int num_threads = _num_finished;
+    int num_active = _num_assigned - _num_finished;
     pthread_mutex_unlock(&_finished_mtx);
 
-    return _num_assigned - num_threads;
+    return num_active;
 }
 
 
@@ -84,5 +90,13 @@ void thread_pool::_raw_task_::run() {
     delete this;
 }
 
+void *thread_pool::_raw_task_::operator new(size_t size) {
+    return mstd::slab_allocator::allocate(size);
+}
+
+void thread_pool::_raw_task_::operator delete(void *p, size_t size) {
+    mstd::slab_allocator::deallocate(p, size);
+}
+
 
 
@@ -32,10 +32,14 @@ private:
     int _num_finished;
     int _num_assigned;
     
+    // Allocated from the slab allocator: submitting a task doesn't reach malloc in steady state
     class _raw_task_ : public task {
     public:
         explicit _raw_task_(std::function<void (void)> f);
         void run() override;
+
+        static void *operator new(size_t size);
+        static void operator delete(void *p, size_t size);
     private:
         std::function<void (void)> _f;
     };
@@ -0,0 +1,134 @@
+#include "epoch.hpp"
+
+std::atomic<uint64_t> mstd::epoch::_global(0);
+std::atomic<mstd::epoch::thread_record *> mstd::epoch::_records(nullptr);
+
+namespace mstd {
+    // Releases the thread's record when the thread exits.
+    // Whatever it still had retired is freed by the next thread that takes the record over
+    struct epoch_record_holder {
+        epoch::thread_record *record = nullptr;
+
+        ~epoch_record_holder() {
+            if (record != nullptr) {
+                record->local.store(0);
+                record->nesting = 0;
+                record->in_use.store(false);
+            }
+        }
+    };
+}
+
+static thread_local mstd::epoch_record_holder local_record;
+
+void mstd::epoch::enter() {
+    thread_record *r = _local();
+    if (r->nesting++ == 0) {
+        r->local.store((_global.load() << 1) | 1, std::memory_order_relaxed);
+        // A store, even a seq_cst one, can still be reordered after the (acquire) loads the reader does next.
+        // The fence makes the pin visible before any of them, so a thread that frees memory either sees the
+        // pin or has already unlinked what the reader is about to load
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void mstd::epoch::exit() {
+    thread_record *r = _local();
+    if (--r->nesting == 0) {
+        r->local.store(0, std::memory_order_release);
+    }
+}
+
+void mstd::epoch::retire(void *p, void (*deleter)(void *)) {
+    thread_record *r = _local();
+    uint64_t e = _global.load();
+    int b = (int) (e % 3);
+    if (r->bag_epoch[b] != e) {
+        // Anything in this bag was retired during epoch e - 3 or earlier
+        r->num_retired -= r->bags[b].size();
+        _free_bag(r->bags[b]);
+        r->bag_epoch[b] = e;
+    }
+
+    retired item;
+    item.ptr = p;
+    item.deleter = deleter;
+    r->bags[b].push(item);
+
+    if (++r->num_retired >= epoch_constants::collect_threshold) {
+        collect();
+    }
+}
+
+void mstd::epoch::collect() {
+    thread_record *r = _local();
+    _try_advance();
+
+    uint64_t e = _global.load();
+    for (int b = 0; b < 3; b++) {
+        if (r->bag_epoch[b] + 2 <= e && r->bags[b].size() > 0) {
+            r->num_retired -= r->bags[b].size();
+            _free_bag(r->bags[b]);
+        }
+    }
+}
+
+uint64_t mstd::epoch::current() {
+    return _global.load();
+}
+
+mstd::epoch::thread_record *mstd::epoch::_local() {
+    if (local_record.record == nullptr) {
+        local_record.record = _acquire_record();
+    }
+    return local_record.record;
+}
+
+mstd::epoch::thread_record *mstd::epoch::_acquire_record() {
+    // Reuse the record of a thread that has exited
+    for (thread_record *r = _records.load(); r != nullptr; r = r->next) {
+        bool expected = false;
+        if (!r->in_use.load() && r->in_use.compare_exchange_strong(expected, true)) {
+            return r;
+        }
+    }
+
+    auto *r = new thread_record();
+    r->local.store(0);
+    r->in_use.store(true);
+    r->nesting = 0;
+    r->num_retired = 0;
+    for (int b = 0; b < 3; b++) {
+        r->bag_epoch[b] = 0;
+    }
+
+    thread_record *head = _records.load();
+    do {
+        r->next = head;
+    } while (!_records.compare_exchange_weak(head, r));
+
+    return r;
+}
+
+// The epoch can only advance once every pinned thread has observed the current one
+bool mstd::epoch::_try_advance() {
+    uint64_t e = _global.load();
+    // Pairs with the fence in enter(): a pin made before it is seen by the scan below
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (thread_record *r = _records.load(); r != nullptr; r = r->next) {
+        uint64_t local = r->local.load();
+        if ((local & 1) && (local >> 1) != e) {
+            return false;
+        }
+    }
+
+    return _global.compare_exchange_strong(e, e + 1);
+}
+
+void mstd::epoch::_free_bag(mstd::vector<retired> &bag) {
+    for (size_t i = 0; i < bag.size(); i++) {
+        retired &item = bag[i];
+        item.deleter(item.ptr);
+    }
+    bag.clear(bag.capacity());
+}
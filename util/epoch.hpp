@@ -0,0 +1,86 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <atomic>
+#include <cstdint>
+#include "mvector.hpp"
+
+namespace epoch_constants {
+    // A thread tries to advance the epoch (and free memory) every time it has retired this many objects
+    const size_t collect_threshold = 64;
+}
+
+namespace mstd {
+    // Epoch-based memory reclamation, shared by the library's lock-free structures.
+    // Readers pin the current epoch (a single store: wait-free) while they hold pointers into a shared structure.
+    // Writers unlink objects and retire them instead of deleting them. A retired object is deleted once
+    // the global epoch has advanced twice, at which point no pinned thread can still reference it.
+    //
+    //     mstd::epoch::guard g;        // pin
+    //     node *n = head.load();      // n stays valid until g goes out of scope
+    //     ...
+    //     mstd::epoch::retire(old);    // instead of delete old
+    class epoch {
+    public:
+        // Pins the calling thread for its lifetime. Guards can be nested
+        class guard {
+        public:
+            guard() { enter(); }
+            guard(const guard &)=delete;
+            ~guard() { exit(); }
+
+            guard &operator=(const guard &)=delete;
+        };
+
+        static void enter();
+
+        static void exit();
+
+        // Deletes p once no pinned thread can reference it
+        template <typename T>
+        static void retire(T *p) {
+            retire(p, [](void *q) { delete static_cast<T *>(q); });
+        }
+
+        static void retire(void *p, void (*deleter)(void *));
+
+        // Tries to advance the global epoch and frees whatever the calling thread retired that is now safe
+        static void collect();
+
+        static uint64_t current();
+
+    private:
+        struct retired {
+            void *ptr;
+            void (*deleter)(void *);
+        };
+
+        // One per thread. Records are never freed: a thread that exits releases its record for the next thread
+        struct thread_record {
+            // (pinned epoch << 1) | 1 while pinned, 0 otherwise
+            std::atomic<uint64_t> local;
+            std::atomic<bool> in_use;
+            thread_record *next;
+            int nesting;
+            // Objects retired during epoch e go to bag e % 3
+            mstd::vector<retired> bags[3];
+            uint64_t bag_epoch[3];
+            size_t num_retired;
+        };
+
+        static std::atomic<uint64_t> _global;
+        static std::atomic<thread_record *> _records;
+
+        static thread_record *_local();
+
+        static thread_record *_acquire_record();
+
+        static bool _try_advance();
+
+        static void _free_bag(mstd::vector<retired> &bag);
+
+        friend struct epoch_record_holder;
+    };
+}
+
+#endif // EPOCH_HPP
@@ -1,24 +1,56 @@
 #include <string>
 #include <sstream>
 #include "mvector.hpp"
+#include "span.hpp"
+#include "string_view.hpp"
 
 namespace helpers {
-    inline void split(const std::string &s, mstd::vector<std::string> &v, char delim) {
-        std::stringstream ss(s);
-        std::string tmp;
-        while(std::getline(ss, tmp, delim)) {
-            if (tmp != "") {
+    // V is any mstd vector of strings (mstd::vector, mstd::small_vector)
+    template <typename V>
+    inline void split(const std::string &s, V &v, char delim) {
+        size_t start = 0;
+        while (start < s.size()) {
+            size_t end = s.find(delim, start);
+            if (end == std::string::npos) end = s.size();
+            if (end > start) {
+                std::string tmp(s, start, end - start);
                 v.m_push(tmp);
             }
+            start = end + 1;
+        }
+    }
+
+    // Same as split, but the parts are views into s: no string is allocated.
+    // V is any mstd vector of mstd::string_view
+    template <typename V>
+    inline void split_views(mstd::string_view s, V &v, char delim) {
+        size_t start = 0;
+        while (start < s.size()) {
+            size_t end = start;
+            while (end < s.size() && s[end] != delim) end++;
+            if (end > start) {
+                v.push(s.substr(start, end - start));
+            }
+            start = end + 1;
         }
     }
 
-    inline std::string join(const mstd::vector<std::string> &v, char on) {
+    // V is any mstd vector or span of std::string or mstd::string_view. The result is allocated once
+    template <typename V>
+    inline std::string join(const V &v, char on) {
         std::string s;
-        for (int i = 0; i < (int) v.size() - 1; i++) {
-            s += v[i] + on;
+        if (v.size() == 0) return s;
+
+        size_t length = v.size() - 1;
+        for (size_t i = 0; i < v.size(); i++) {
+            length += v[i].size();
+        }
+        s.reserve(length);
+
+        for (size_t i = 0; i < v.size(); i++) {
+            if (i > 0) s += on;
+            s.append(v[i].data(), v[i].size());
         }
-        s += v[v.size() - 1];
         return s;
     }
 
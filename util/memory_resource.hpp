@@ -0,0 +1,299 @@
+#ifndef MEMORY_RESOURCE_HPP
+#define MEMORY_RESOURCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace arena_constants {
+    // Size of the blocks an arena requests from its upstream resource
+    const size_t block_size = 64 * 1024;
+}
+
+namespace pool_constants {
+    // Size classes are min_block_size, 2 * min_block_size, ... max_block_size
+    const size_t min_block_size = 16;
+    const size_t max_block_size = 512;
+    const size_t num_classes = 6;
+    // Every refill carves this many bytes into blocks of one size class
+    const size_t chunk_size = 16 * 1024;
+}
+
+namespace mstd {
+    // Where a container gets its memory from (a subset of C++17's std::pmr::memory_resource).
+    // Every mstd container takes one in its constructor and defaults to default_resource(), i.e. malloc
+    class memory_resource {
+    public:
+        virtual ~memory_resource()=default;
+
+        void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+            return do_allocate(bytes, alignment);
+        }
+
+        void deallocate(void *p, size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+            do_deallocate(p, bytes, alignment);
+        }
+
+        // Resizes a block whose contents can be copied bytewise, possibly in place
+        void *reallocate(void *p, size_t old_bytes, size_t new_bytes, size_t alignment = alignof(std::max_align_t)) {
+            return do_reallocate(p, old_bytes, new_bytes, alignment);
+        }
+
+        // True if allocate and deallocate can be called from several threads at once
+        virtual bool is_thread_safe() const {
+            return false;
+        }
+
+    protected:
+        virtual void *do_allocate(size_t bytes, size_t alignment)=0;
+
+        virtual void do_deallocate(void *p, size_t bytes, size_t alignment)=0;
+
+        virtual void *do_reallocate(void *p, size_t old_bytes, size_t new_bytes, size_t alignment) {
+            void *q = do_allocate(new_bytes, alignment);
+            memcpy(q, p, old_bytes < new_bytes ? old_bytes : new_bytes);
+            do_deallocate(p, old_bytes, alignment);
+            return q;
+        }
+    };
+
+    // malloc and free. Reallocation goes through realloc
+    class malloc_resource : public memory_resource {
+    public:
+        bool is_thread_safe() const override {
+            return true;
+        }
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            void *p;
+            if (alignment <= alignof(std::max_align_t)) {
+                p = malloc(bytes > 0 ? bytes : 1);
+            } else if (posix_memalign(&p, alignment, bytes > 0 ? bytes : 1) != 0) {
+                p = nullptr;
+            }
+            if (p == nullptr) throw std::bad_alloc();
+            return p;
+        }
+
+        void do_deallocate(void *p, size_t, size_t) override {
+            free(p);
+        }
+
+        void *do_reallocate(void *p, size_t old_bytes, size_t new_bytes, size_t alignment) override {
+            if (alignment > alignof(std::max_align_t)) {
+                return memory_resource::do_reallocate(p, old_bytes, new_bytes, alignment);
+            }
+            void *q = realloc(p, new_bytes > 0 ? new_bytes : 1);
+            if (q == nullptr) throw std::bad_alloc();
+            return q;
+        }
+    };
+
+    inline memory_resource *default_resource() {
+        static malloc_resource resource;
+        return &resource;
+    }
+
+    // Monotonic bump allocator: allocation is a pointer increment, deallocation does nothing, and everything
+    // is freed at once by release() (or the destructor). Give one to the containers of a batch of work,
+    // and drop it when the batch is done. Not thread safe
+    class arena_resource : public memory_resource {
+    public:
+        explicit arena_resource(size_t block_size = arena_constants::block_size,
+                                memory_resource *upstream = default_resource())
+                : _upstream(upstream), _block_size(block_size), _blocks(nullptr), _ptr(nullptr), _left(0),
+                  _last(nullptr), _bytes_allocated(0) { }
+
+        arena_resource(const arena_resource &)=delete;
+
+        ~arena_resource() override {
+            release();
+        }
+
+        // Frees every block. Everything that was allocated from the arena becomes invalid
+        void release() {
+            while (_blocks != nullptr) {
+                block_header *next = _blocks->next;
+                _upstream->deallocate(_blocks, _blocks->size);
+                _blocks = next;
+            }
+            _ptr = nullptr;
+            _left = 0;
+            _last = nullptr;
+            _bytes_allocated = 0;
+        }
+
+        // Bytes requested from the upstream resource
+        size_t bytes_allocated() const {
+            return _bytes_allocated;
+        }
+
+        arena_resource &operator=(const arena_resource &)=delete;
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            size_t padding = (alignment - (uintptr_t) _ptr % alignment) % alignment;
+            if (_ptr == nullptr || padding + bytes > _left) {
+                _new_block(bytes + alignment);
+                padding = (alignment - (uintptr_t) _ptr % alignment) % alignment;
+            }
+
+            char *p = _ptr + padding;
+            _ptr = p + bytes;
+            _left -= padding + bytes;
+            _last = p;
+            return p;
+        }
+
+        // Only the most recent allocation can be given back
+        void do_deallocate(void *p, size_t bytes, size_t) override {
+            if (p == _last && p != nullptr) {
+                _left += (size_t) (_ptr - _last);
+                _ptr = _last;
+                _last = nullptr;
+            }
+            (void) bytes;
+        }
+
+        // The most recent allocation grows in place while its block has room (a growing vector's common case)
+        void *do_reallocate(void *p, size_t old_bytes, size_t new_bytes, size_t alignment) override {
+            if (p == _last && p != nullptr && new_bytes <= (size_t) (_ptr - _last) + _left) {
+                size_t used = (size_t) (_ptr - _last);
+                _left = used + _left - new_bytes;
+                _ptr = _last + new_bytes;
+                return p;
+            }
+            return memory_resource::do_reallocate(p, old_bytes, new_bytes, alignment);
+        }
+
+    private:
+        struct block_header {
+            block_header *next;
+            size_t size;
+        };
+
+        memory_resource *_upstream;
+        size_t _block_size;
+        block_header *_blocks;
+        char *_ptr;
+        size_t _left;
+        char *_last;
+        size_t _bytes_allocated;
+
+        void _new_block(size_t min_bytes) {
+            size_t size = sizeof(block_header) + (min_bytes > _block_size ? min_bytes : _block_size);
+            auto *header = static_cast<block_header *>(_upstream->allocate(size));
+            header->next = _blocks;
+            header->size = size;
+            _blocks = header;
+            _bytes_allocated += size;
+
+            _ptr = reinterpret_cast<char *>(header + 1);
+            _left = size - sizeof(block_header);
+            _last = nullptr;
+        }
+    };
+
+    // Free lists of fixed-size blocks, one per power-of-2 size class up to max_block_size. Blocks are carved
+    // out of chunks that are only returned to the upstream resource when the pool is destroyed.
+    // Larger (or over-aligned) requests go straight upstream. Not thread safe: use for_this_thread(),
+    // and free blocks on the thread that allocated them
+    class pool_resource : public memory_resource {
+    public:
+        explicit pool_resource(memory_resource *upstream = default_resource())
+                : _upstream(upstream), _chunks(nullptr) {
+            for (size_t i = 0; i < pool_constants::num_classes; i++) {
+                _free[i] = nullptr;
+            }
+        }
+
+        pool_resource(const pool_resource &)=delete;
+
+        ~pool_resource() override {
+            while (_chunks != nullptr) {
+                chunk_header *next = _chunks->next;
+                _upstream->deallocate(_chunks, sizeof(chunk_header) + pool_constants::chunk_size);
+                _chunks = next;
+            }
+        }
+
+        // The calling thread's pool. It lives (and keeps its chunks) until the thread exits
+        static pool_resource &for_this_thread() {
+            static thread_local pool_resource pool;
+            return pool;
+        }
+
+        pool_resource &operator=(const pool_resource &)=delete;
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            size_t c = _class_of(bytes, alignment);
+            if (c == pool_constants::num_classes) {
+                return _upstream->allocate(bytes, alignment);
+            }
+
+            if (_free[c] == nullptr) {
+                _refill(c);
+            }
+            free_block *b = _free[c];
+            _free[c] = b->next;
+            return b;
+        }
+
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+            size_t c = _class_of(bytes, alignment);
+            if (c == pool_constants::num_classes) {
+                _upstream->deallocate(p, bytes, alignment);
+                return;
+            }
+
+            auto *b = static_cast<free_block *>(p);
+            b->next = _free[c];
+            _free[c] = b;
+        }
+
+    private:
+        struct free_block {
+            free_block *next;
+        };
+
+        struct chunk_header {
+            chunk_header *next;
+            // Keeps the blocks that follow maximally aligned
+            std::max_align_t padding;
+        };
+
+        memory_resource *_upstream;
+        chunk_header *_chunks;
+        free_block *_free[pool_constants::num_classes];
+
+        // Index of the smallest class that fits, or num_classes if none does
+        static size_t _class_of(size_t bytes, size_t alignment) {
+            if (alignment > alignof(std::max_align_t)) return pool_constants::num_classes;
+            size_t c = 0;
+            for (size_t size = pool_constants::min_block_size; size < bytes; size <<= 1) {
+                c++;
+            }
+            return c < pool_constants::num_classes ? c : pool_constants::num_classes;
+        }
+
+        void _refill(size_t c) {
+            auto *chunk = static_cast<chunk_header *>(_upstream->allocate(sizeof(chunk_header) + pool_constants::chunk_size));
+            chunk->next = _chunks;
+            _chunks = chunk;
+
+            size_t block_size = pool_constants::min_block_size << c;
+            char *p = reinterpret_cast<char *>(chunk + 1);
+            for (size_t offset = 0; offset + block_size <= pool_constants::chunk_size; offset += block_size) {
+                auto *b = reinterpret_cast<free_block *>(p + offset);
+                b->next = _free[c];
+                _free[c] = b;
+            }
+        }
+    };
+}
+
+#endif // MEMORY_RESOURCE_HPP
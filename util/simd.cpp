@@ -0,0 +1,168 @@
+#include "simd.hpp"
+#include <atomic>
+
+namespace mstd {
+    namespace simd {
+        namespace detail {
+            template <typename T>
+            struct kernels {
+                size_t (*find)(const T *, size_t, T);
+                size_t (*count)(const T *, size_t, T);
+                size_t (*min)(const T *, size_t);
+                size_t (*max)(const T *, size_t);
+                bool (*equal)(const T *, const T *, size_t);
+            };
+
+            template <typename T>
+            size_t find_generic_kernel(const T *p, size_t n, T x) {
+                return find_generic(p, n, x);
+            }
+
+            template <typename T>
+            size_t count_generic_kernel(const T *p, size_t n, T x) {
+                return count_generic(p, n, x);
+            }
+        }
+    }
+}
+
+// One set of kernels per instruction set, each compiled for it: mstd::simd::detail::sse42, avx2 and avx512
+#if defined(__x86_64__) || defined(__i386__)
+#define MSTD_SIMD_X86
+
+#pragma GCC push_options
+#pragma GCC target("sse4.2")
+#define MSTD_SIMD_ISA sse42
+#define MSTD_SIMD_BYTES 16
+#include "simd_kernels.hpp"
+#undef MSTD_SIMD_ISA
+#undef MSTD_SIMD_BYTES
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#define MSTD_SIMD_ISA avx2
+#define MSTD_SIMD_BYTES 32
+#include "simd_kernels.hpp"
+#undef MSTD_SIMD_ISA
+#undef MSTD_SIMD_BYTES
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512dq")
+#define MSTD_SIMD_ISA avx512
+#define MSTD_SIMD_BYTES 64
+#include "simd_kernels.hpp"
+#undef MSTD_SIMD_ISA
+#undef MSTD_SIMD_BYTES
+#pragma GCC pop_options
+#endif
+
+namespace mstd {
+    namespace simd {
+        namespace detail {
+            template <typename T>
+            const kernels<T> &kernels_for(isa which) {
+                static const kernels<T> table[isa_count] = {
+                        {&find_generic_kernel<T>, &count_generic_kernel<T>, &min_generic<T>, &max_generic<T>,
+                         &equal_generic<T>},
+#ifdef MSTD_SIMD_X86
+                        {&sse42::find<T>, &sse42::count<T>, &sse42::min<T>, &sse42::max<T>, &sse42::equal<T>},
+                        {&avx2::find<T>, &avx2::count<T>, &avx2::min<T>, &avx2::max<T>, &avx2::equal<T>},
+                        {&avx512::find<T>, &avx512::count<T>, &avx512::min<T>, &avx512::max<T>, &avx512::equal<T>},
+#endif
+                };
+                return table[which];
+            }
+        }
+    }
+}
+
+static mstd::simd::isa detect() {
+#ifdef MSTD_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq")) {
+        return mstd::simd::isa_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) return mstd::simd::isa_avx2;
+    if (__builtin_cpu_supports("sse4.2")) return mstd::simd::isa_sse42;
+#endif
+    return mstd::simd::isa_generic;
+}
+
+static std::atomic<int> &current() {
+    static std::atomic<int> which(detect());
+    return which;
+}
+
+mstd::simd::isa mstd::simd::detected_isa() {
+    static isa which = detect();
+    return which;
+}
+
+mstd::simd::isa mstd::simd::current_isa() {
+    return (isa) current().load(std::memory_order_relaxed);
+}
+
+void mstd::simd::set_isa(isa which) {
+    if (which >= isa_count) which = isa_avx512;
+    if (which > detected_isa()) which = detected_isa();
+    current().store(which, std::memory_order_relaxed);
+}
+
+void mstd::simd::detail::kernels_marker() { }
+
+const char *mstd::simd::isa_name(isa which) {
+    switch (which) {
+        case isa_generic: return "generic";
+        case isa_sse42: return "sse4.2";
+        case isa_avx2: return "avx2";
+        case isa_avx512: return "avx512";
+        default: return "unknown";
+    }
+}
+
+template <typename L>
+size_t mstd::simd::detail::find_kernel(const L *data, size_t n, L value) {
+    return kernels_for<L>(current_isa()).find(data, n, value);
+}
+
+template <typename L>
+size_t mstd::simd::detail::count_kernel(const L *data, size_t n, L value) {
+    return kernels_for<L>(current_isa()).count(data, n, value);
+}
+
+template <typename L>
+size_t mstd::simd::detail::min_kernel(const L *data, size_t n) {
+    return kernels_for<L>(current_isa()).min(data, n);
+}
+
+template <typename L>
+size_t mstd::simd::detail::max_kernel(const L *data, size_t n) {
+    return kernels_for<L>(current_isa()).max(data, n);
+}
+
+template <typename L>
+bool mstd::simd::detail::equal_kernel(const L *a, const L *b, size_t n) {
+    return kernels_for<L>(current_isa()).equal(a, b, n);
+}
+
+#define MSTD_SIMD_INSTANTIATE(L)                                                    \
+    template size_t mstd::simd::detail::find_kernel<L>(const L *, size_t, L);      \
+    template size_t mstd::simd::detail::count_kernel<L>(const L *, size_t, L);     \
+    template size_t mstd::simd::detail::min_kernel<L>(const L *, size_t);          \
+    template size_t mstd::simd::detail::max_kernel<L>(const L *, size_t);          \
+    template bool mstd::simd::detail::equal_kernel<L>(const L *, const L *, size_t);
+
+MSTD_SIMD_INSTANTIATE(int8_t)
+MSTD_SIMD_INSTANTIATE(uint8_t)
+MSTD_SIMD_INSTANTIATE(int16_t)
+MSTD_SIMD_INSTANTIATE(uint16_t)
+MSTD_SIMD_INSTANTIATE(int32_t)
+MSTD_SIMD_INSTANTIATE(uint32_t)
+MSTD_SIMD_INSTANTIATE(int64_t)
+MSTD_SIMD_INSTANTIATE(uint64_t)
+MSTD_SIMD_INSTANTIATE(float)
+MSTD_SIMD_INSTANTIATE(double)
+
+#undef MSTD_SIMD_INSTANTIATE
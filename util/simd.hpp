@@ -0,0 +1,273 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace simd_constants {
+    // Below this many elements a plain loop is faster than dispatching to a kernel
+    const size_t min_elements = 16;
+}
+
+// Searches and comparisons over arrays of arithmetic types, with kernels for SSE4.2, AVX2 and AVX-512
+// picked at runtime (the best one the CPU supports, unless set_isa() says otherwise).
+// Other element types, and short arrays, take the generic loop, which only needs operator== and operator<.
+// Results are the same as the generic loop's, including for NaN, -0.0 and +0.0.
+// These back mstd::vector's in, find, count, min_element, max_element and equal.
+// The kernels live in simd.cpp. On ELF targets they are declared weak: a program that doesn't link simd.cpp
+// still builds, and every search takes the generic loop. Elsewhere simd.cpp has to be linked
+#if defined(__GNUC__) && defined(__ELF__)
+#define MSTD_SIMD_WEAK __attribute__((weak))
+#else
+#define MSTD_SIMD_WEAK
+#endif
+
+namespace mstd {
+    namespace simd {
+        enum isa {
+            isa_generic,
+            isa_sse42,
+            isa_avx2,
+            isa_avx512,
+            isa_count
+        };
+
+        // Best instruction set the CPU (and OS) supports
+        isa detected_isa();
+
+        // Instruction set the kernels currently use
+        isa current_isa();
+
+        // Makes the kernels use which, or the best supported one below it
+        void set_isa(isa which);
+
+        const char *isa_name(isa which);
+
+        // Index of the first element equal to value, or n
+        template <typename T>
+        size_t find(const T *data, size_t n, const T &value);
+
+        template <typename T>
+        size_t count(const T *data, size_t n, const T &value);
+
+        // Index of the first smallest (largest) element, or n if n is 0
+        template <typename T>
+        size_t min_element(const T *data, size_t n);
+
+        template <typename T>
+        size_t max_element(const T *data, size_t n);
+
+        // True if a[i] == b[i] for every i
+        template <typename T>
+        bool equal(const T *a, const T *b, size_t n);
+
+        // Types with kernels: integers and floating point types of up to 8 bytes, except bool
+        template <typename T>
+        struct is_vectorizable : std::integral_constant<bool, std::is_arithmetic<T>::value
+                                                              && !std::is_same<T, bool>::value && sizeof(T) <= 8> { };
+
+        namespace detail {
+            template <size_t Size, bool Signed>
+            struct int_of_size;
+
+            template <> struct int_of_size<1, true> { typedef int8_t type; };
+            template <> struct int_of_size<1, false> { typedef uint8_t type; };
+            template <> struct int_of_size<2, true> { typedef int16_t type; };
+            template <> struct int_of_size<2, false> { typedef uint16_t type; };
+            template <> struct int_of_size<4, true> { typedef int32_t type; };
+            template <> struct int_of_size<4, false> { typedef uint32_t type; };
+            template <> struct int_of_size<8, true> { typedef int64_t type; };
+            template <> struct int_of_size<8, false> { typedef uint64_t type; };
+
+            // The type the kernels see T as (char as int8_t or uint8_t, long long as int64_t, ...)
+            template <typename T, bool = std::is_floating_point<T>::value>
+            struct lane {
+                typedef typename int_of_size<sizeof(T), std::is_signed<T>::value>::type type;
+            };
+
+            template <typename T>
+            struct lane<T, true> {
+                typedef T type;
+            };
+
+            // Defined in simd.cpp for every lane type
+            template <typename L>
+            size_t find_kernel(const L *data, size_t n, L value) MSTD_SIMD_WEAK;
+
+            template <typename L>
+            size_t count_kernel(const L *data, size_t n, L value) MSTD_SIMD_WEAK;
+
+            template <typename L>
+            size_t min_kernel(const L *data, size_t n) MSTD_SIMD_WEAK;
+
+            template <typename L>
+            size_t max_kernel(const L *data, size_t n) MSTD_SIMD_WEAK;
+
+            template <typename L>
+            bool equal_kernel(const L *a, const L *b, size_t n) MSTD_SIMD_WEAK;
+
+            // Defined in simd.cpp. Its (weak) address is null when simd.cpp isn't linked in. GCC assumes template
+            // instantiations are never null, so the kernels themselves can't be tested
+            void kernels_marker() MSTD_SIMD_WEAK;
+
+            inline bool linked() {
+#if defined(__GNUC__) && defined(__ELF__)
+                return &kernels_marker != nullptr;
+#else
+                return true;
+#endif
+            }
+
+            template <typename T>
+            size_t find_generic(const T *data, size_t n, const T &value) {
+                for (size_t i = 0; i < n; i++) {
+                    if (data[i] == value) {
+                        return i;
+                    }
+                }
+                return n;
+            }
+
+            template <typename T>
+            size_t count_generic(const T *data, size_t n, const T &value) {
+                size_t c = 0;
+                for (size_t i = 0; i < n; i++) {
+                    if (data[i] == value) {
+                        c++;
+                    }
+                }
+                return c;
+            }
+
+            template <typename T>
+            size_t min_generic(const T *data, size_t n) {
+                if (n == 0) return 0;
+                size_t best = 0;
+                for (size_t i = 1; i < n; i++) {
+                    if (data[i] < data[best]) {
+                        best = i;
+                    }
+                }
+                return best;
+            }
+
+            template <typename T>
+            size_t max_generic(const T *data, size_t n) {
+                if (n == 0) return 0;
+                size_t best = 0;
+                for (size_t i = 1; i < n; i++) {
+                    if (data[best] < data[i]) {
+                        best = i;
+                    }
+                }
+                return best;
+            }
+
+            template <typename T>
+            bool equal_generic(const T *a, const T *b, size_t n) {
+                for (size_t i = 0; i < n; i++) {
+                    if (!(a[i] == b[i])) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            template <typename T>
+            const typename lane<T>::type *as_lanes(const T *data) {
+                return reinterpret_cast<const typename lane<T>::type *>(data);
+            }
+
+            template <typename T>
+            typename lane<T>::type as_lane(const T &value) {
+                typename lane<T>::type l;
+                memcpy(&l, &value, sizeof(l));
+                return l;
+            }
+
+            template <typename T>
+            size_t find(const T *data, size_t n, const T &value, std::true_type) {
+                if (n < simd_constants::min_elements || !linked()) return find_generic(data, n, value);
+                return find_kernel(as_lanes(data), n, as_lane(value));
+            }
+
+            template <typename T>
+            size_t find(const T *data, size_t n, const T &value, std::false_type) {
+                return find_generic(data, n, value);
+            }
+
+            template <typename T>
+            size_t count(const T *data, size_t n, const T &value, std::true_type) {
+                if (n < simd_constants::min_elements || !linked()) return count_generic(data, n, value);
+                return count_kernel(as_lanes(data), n, as_lane(value));
+            }
+
+            template <typename T>
+            size_t count(const T *data, size_t n, const T &value, std::false_type) {
+                return count_generic(data, n, value);
+            }
+
+            template <typename T>
+            size_t min_element(const T *data, size_t n, std::true_type) {
+                if (n < simd_constants::min_elements || !linked()) return min_generic(data, n);
+                return min_kernel(as_lanes(data), n);
+            }
+
+            template <typename T>
+            size_t min_element(const T *data, size_t n, std::false_type) {
+                return min_generic(data, n);
+            }
+
+            template <typename T>
+            size_t max_element(const T *data, size_t n, std::true_type) {
+                if (n < simd_constants::min_elements || !linked()) return max_generic(data, n);
+                return max_kernel(as_lanes(data), n);
+            }
+
+            template <typename T>
+            size_t max_element(const T *data, size_t n, std::false_type) {
+                return max_generic(data, n);
+            }
+
+            template <typename T>
+            bool equal(const T *a, const T *b, size_t n, std::true_type) {
+                if (n < simd_constants::min_elements || !linked()) return equal_generic(a, b, n);
+                return equal_kernel(as_lanes(a), as_lanes(b), n);
+            }
+
+            template <typename T>
+            bool equal(const T *a, const T *b, size_t n, std::false_type) {
+                return equal_generic(a, b, n);
+            }
+        }
+
+        template <typename T>
+        size_t find(const T *data, size_t n, const T &value) {
+            return detail::find(data, n, value, is_vectorizable<T>());
+        }
+
+        template <typename T>
+        size_t count(const T *data, size_t n, const T &value) {
+            return detail::count(data, n, value, is_vectorizable<T>());
+        }
+
+        template <typename T>
+        size_t min_element(const T *data, size_t n) {
+            return detail::min_element(data, n, is_vectorizable<T>());
+        }
+
+        template <typename T>
+        size_t max_element(const T *data, size_t n) {
+            return detail::max_element(data, n, is_vectorizable<T>());
+        }
+
+        template <typename T>
+        bool equal(const T *a, const T *b, size_t n) {
+            return detail::equal(a, b, n, is_vectorizable<T>());
+        }
+    }
+}
+
+#endif // SIMD_HPP
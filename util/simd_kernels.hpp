@@ -0,0 +1,159 @@
+// Kernels for one instruction set, included by simd.cpp once per instruction set (so no include guard), under
+// a #pragma GCC target for it, with MSTD_SIMD_ISA naming the namespace and MSTD_SIMD_BYTES the vector width.
+// Everything here must be compiled for the instruction set it runs on, templates included: with AVX-512 GCC
+// types a vector comparison as a mask register, and if the comparison were in a template compiled for the
+// default target, it would be lowered lane by lane once inlined into an AVX-512 kernel
+namespace mstd {
+    namespace simd {
+        namespace detail {
+            namespace MSTD_SIMD_ISA {
+                // GCC vector extensions: vectors of MSTD_SIMD_BYTES bytes of T
+                template <typename T>
+                struct vec {
+                    typedef T type __attribute__((vector_size(MSTD_SIMD_BYTES)));
+                };
+
+                // Vectors are checked this many at a time: one mask reduction per group
+                const size_t unroll = 4;
+
+                // Vectors are passed by reference: these are only ever inlined into the kernels, whatever the ABI
+                template <typename V, typename T>
+                inline void broadcast(V &v, T x) {
+                    for (size_t k = 0; k < MSTD_SIMD_BYTES / sizeof(T); k++) {
+                        v[k] = x;
+                    }
+                }
+
+                template <typename V>
+                inline const V &load(V &v, const void *p) {
+                    memcpy(&v, p, sizeof(V));
+                    return v;
+                }
+
+                // True if any lane of the comparison mask m is set
+                template <typename M>
+                inline bool any(const M &m) {
+                    typedef typename vec<uint64_t>::type U;
+                    U u = (U) m;
+                    uint64_t bits = 0;
+                    for (size_t k = 0; k < MSTD_SIMD_BYTES / 8; k++) {
+                        bits |= u[k];
+                    }
+                    return bits != 0;
+                }
+
+                template <typename T>
+                size_t find(const T *p, size_t n, T x) {
+                    typedef typename vec<T>::type V;
+                    const size_t lanes = MSTD_SIMD_BYTES / sizeof(T);
+                    const size_t step = unroll * lanes;
+                    V vx, a, b, c, d;
+                    broadcast(vx, x);
+
+                    size_t i = 0;
+                    for (; i + step <= n; i += step) {
+                        auto m = (load(a, p + i) == vx) | (load(b, p + i + lanes) == vx)
+                                 | (load(c, p + i + 2 * lanes) == vx) | (load(d, p + i + 3 * lanes) == vx);
+                        if (any(m)) break;
+                    }
+                    // The match is in this group, if the loop stopped early
+                    for (; i < n; i++) {
+                        if (p[i] == x) return i;
+                    }
+                    return n;
+                }
+
+                template <typename T>
+                size_t count(const T *p, size_t n, T x) {
+                    typedef typename vec<T>::type V;
+                    typedef typename vec<typename int_of_size<sizeof(T), false>::type>::type VU;
+                    const size_t lanes = MSTD_SIMD_BYTES / sizeof(T);
+                    V vx, a;
+                    broadcast(vx, x);
+
+                    size_t total = 0;
+                    size_t i = 0;
+                    while (i + lanes <= n) {
+                        // Matching lanes are -1: subtracting the mask counts them. 255 rounds fit in any lane width
+                        VU acc = VU();
+                        for (size_t r = 0; r < 255 && i + lanes <= n; r++, i += lanes) {
+                            acc -= (VU) (load(a, p + i) == vx);
+                        }
+                        for (size_t k = 0; k < lanes; k++) {
+                            total += acc[k];
+                        }
+                    }
+                    for (; i < n; i++) {
+                        if (p[i] == x) total++;
+                    }
+                    return total;
+                }
+
+                // Finds the smallest (largest) value with vector min (max), then its first position with find.
+                // With a NaN anywhere the generic loop's answer depends on where it is: leave it to the generic loop
+                template <typename T, bool Min>
+                size_t minmax(const T *p, size_t n) {
+                    typedef typename vec<T>::type V;
+                    const size_t lanes = MSTD_SIMD_BYTES / sizeof(T);
+                    // Not even one vector to start from
+                    if (n < lanes) {
+                        return Min ? min_generic(p, n) : max_generic(p, n);
+                    }
+
+                    V acc, a;
+                    load(acc, p);
+                    auto nan = acc != acc;
+                    size_t i = lanes;
+                    for (; i + lanes <= n; i += lanes) {
+                        load(a, p + i);
+                        nan |= a != a;
+                        acc = Min ? (a < acc ? a : acc) : (acc < a ? a : acc);
+                    }
+                    if (any(nan)) {
+                        return Min ? min_generic(p, n) : max_generic(p, n);
+                    }
+
+                    T best = acc[0];
+                    for (size_t k = 1; k < lanes; k++) {
+                        if (Min ? acc[k] < best : best < acc[k]) best = acc[k];
+                    }
+                    for (; i < n; i++) {
+                        if (p[i] != p[i]) return Min ? min_generic(p, n) : max_generic(p, n);
+                        if (Min ? p[i] < best : best < p[i]) best = p[i];
+                    }
+                    return find(p, n, best);
+                }
+
+                template <typename T>
+                size_t min(const T *p, size_t n) {
+                    return minmax<T, true>(p, n);
+                }
+
+                template <typename T>
+                size_t max(const T *p, size_t n) {
+                    return minmax<T, false>(p, n);
+                }
+
+                template <typename T>
+                bool equal(const T *a, const T *b, size_t n) {
+                    // Integers are equal when their bytes are
+                    if (!std::is_floating_point<T>::value) {
+                        return memcmp(a, b, n * sizeof(T)) == 0;
+                    }
+
+                    typedef typename vec<T>::type V;
+                    const size_t lanes = MSTD_SIMD_BYTES / sizeof(T);
+                    V va, vb;
+                    size_t i = 0;
+                    for (; i + lanes <= n; i += lanes) {
+                        if (any(load(va, a + i) != load(vb, b + i))) return false;
+                    }
+                    for (; i < n; i++) {
+                        if (!(a[i] == b[i])) return false;
+                    }
+                    return true;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,279 @@
+#include "slab_allocator.hpp"
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <pthread.h>
+
+std::atomic<mstd::slab_allocator::thread_cache *> mstd::slab_allocator::_caches(nullptr);
+std::atomic<size_t> mstd::slab_allocator::_large_allocations(0);
+
+namespace mstd {
+    struct slab_allocator::depot {
+        pthread_mutex_t mtx;
+        mstd::vector<batch> batches;
+        size_t num_objects;
+        size_t num_slabs;
+        size_t carved;
+        size_t refills;
+        size_t flushes;
+
+        depot() : num_objects(0), num_slabs(0), carved(0), refills(0), flushes(0) {
+            pthread_mutex_init(&mtx, nullptr);
+        }
+    };
+
+    // Empties the thread's cache into the depots when the thread exits
+    struct slab_cache_holder {
+        slab_allocator::thread_cache *cache = nullptr;
+
+        ~slab_cache_holder();
+    };
+}
+
+static thread_local mstd::slab_cache_holder local_cache;
+// Set once local_cache is destroyed: objects freed by later destructors of the thread go straight to the depot
+static thread_local bool local_cache_gone = false;
+
+mstd::slab_cache_holder::~slab_cache_holder() {
+    if (cache != nullptr) {
+        for (size_t c = 0; c < slab_constants::num_classes; c++) {
+            slab_allocator::_flush(cache, c, cache->count[c].load(std::memory_order_relaxed));
+        }
+        cache->in_use.store(false);
+        cache = nullptr;
+    }
+    local_cache_gone = true;
+}
+
+static size_t class_of(size_t bytes) {
+    return bytes == 0 ? 0 : (bytes - 1) / slab_constants::granularity;
+}
+
+void *mstd::slab_allocator::allocate(size_t bytes) {
+    if (bytes > slab_constants::max_object_size) {
+        _large_allocations.fetch_add(1, std::memory_order_relaxed);
+        void *p = malloc(bytes);
+        if (p == nullptr) throw std::bad_alloc();
+        return p;
+    }
+
+    size_t c = class_of(bytes);
+    thread_cache *cache = _local();
+    if (cache == nullptr) {
+        // Thread exit: borrow the object from the depot, one at a time
+        thread_cache tmp{};
+        _refill(&tmp, c);
+        free_object *o = tmp.free[c];
+        tmp.free[c] = o->next;
+        _flush(&tmp, c, tmp.count[c].load(std::memory_order_relaxed) - 1);
+        return o;
+    }
+
+    if (cache->free[c] == nullptr) {
+        _refill(cache, c);
+    }
+    free_object *o = cache->free[c];
+    cache->free[c] = o->next;
+    // Only this thread writes its counters: no read-modify-write needed
+    cache->count[c].store(cache->count[c].load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    cache->allocations[c].store(cache->allocations[c].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return o;
+}
+
+void mstd::slab_allocator::deallocate(void *p, size_t bytes) {
+    if (p == nullptr) return;
+    if (bytes > slab_constants::max_object_size) {
+        free(p);
+        return;
+    }
+
+    size_t c = class_of(bytes);
+    auto *o = static_cast<free_object *>(p);
+    thread_cache *cache = _local();
+    if (cache == nullptr) {
+        thread_cache tmp{};
+        tmp.free[c] = o;
+        o->next = nullptr;
+        tmp.count[c].store(1, std::memory_order_relaxed);
+        _flush(&tmp, c, 1);
+        return;
+    }
+
+    o->next = cache->free[c];
+    cache->free[c] = o;
+    size_t count = cache->count[c].load(std::memory_order_relaxed) + 1;
+    cache->count[c].store(count, std::memory_order_relaxed);
+    if (count >= slab_constants::max_cached) {
+        _flush(cache, c, slab_constants::batch_size);
+    }
+}
+
+mstd::slab_stats mstd::slab_allocator::stats() {
+    slab_stats st;
+    for (size_t c = 0; c < slab_constants::num_classes; c++) {
+        slab_class_stats cs;
+        cs.object_size = (c + 1) * slab_constants::granularity;
+
+        depot &d = _depot(c);
+        pthread_mutex_lock(&d.mtx);
+        cs.slabs = d.num_slabs;
+        cs.objects = d.carved;
+        cs.in_depot = d.num_objects;
+        cs.refills = d.refills;
+        cs.flushes = d.flushes;
+        pthread_mutex_unlock(&d.mtx);
+
+        for (thread_cache *t = _caches.load(); t != nullptr; t = t->next) {
+            cs.in_caches += t->count[c].load(std::memory_order_relaxed);
+            cs.allocations += t->allocations[c].load(std::memory_order_relaxed);
+        }
+        size_t free_objects = cs.in_depot + cs.in_caches;
+        cs.in_use = cs.objects > free_objects ? cs.objects - free_objects : 0;
+
+        st.classes.push(cs);
+    }
+    st.large_allocations = _large_allocations.load(std::memory_order_relaxed);
+    return st;
+}
+
+// Never destroyed: objects can be freed by static destructors that run after this one would
+mstd::slab_allocator::depot &mstd::slab_allocator::_depot(size_t c) {
+    static depot *depots = new depot[slab_constants::num_classes];
+    return depots[c];
+}
+
+mstd::slab_allocator::thread_cache *mstd::slab_allocator::_local() {
+    if (local_cache.cache == nullptr) {
+        if (local_cache_gone) {
+            return nullptr;
+        }
+        local_cache.cache = _acquire_cache();
+    }
+    return local_cache.cache;
+}
+
+mstd::slab_allocator::thread_cache *mstd::slab_allocator::_acquire_cache() {
+    // Reuse the cache of a thread that has exited. It was emptied, but keeps its counters
+    for (thread_cache *t = _caches.load(); t != nullptr; t = t->next) {
+        bool expected = false;
+        if (!t->in_use.load() && t->in_use.compare_exchange_strong(expected, true)) {
+            return t;
+        }
+    }
+
+    auto *t = new thread_cache();
+    for (size_t c = 0; c < slab_constants::num_classes; c++) {
+        t->free[c] = nullptr;
+        t->count[c].store(0);
+        t->allocations[c].store(0);
+    }
+    t->in_use.store(true);
+
+    thread_cache *head = _caches.load();
+    do {
+        t->next = head;
+    } while (!_caches.compare_exchange_weak(head, t));
+
+    return t;
+}
+
+void mstd::slab_allocator::_refill(thread_cache *cache, size_t c) {
+    depot &d = _depot(c);
+    pthread_mutex_lock(&d.mtx);
+
+    if (d.batches.size() == 0) {
+        size_t size = (c + 1) * slab_constants::granularity;
+        char *slab = static_cast<char *>(malloc(slab_constants::slab_bytes));
+        if (slab == nullptr) {
+            pthread_mutex_unlock(&d.mtx);
+            throw std::bad_alloc();
+        }
+        d.num_slabs++;
+
+        size_t num = slab_constants::slab_bytes / size;
+        for (size_t first = 0; first < num; first += slab_constants::batch_size) {
+            size_t last = first + slab_constants::batch_size < num ? first + slab_constants::batch_size : num;
+            batch b;
+            b.head = nullptr;
+            b.count = last - first;
+            for (size_t i = last; i > first; i--) {
+                auto *o = reinterpret_cast<free_object *>(slab + (i - 1) * size);
+                o->next = b.head;
+                b.head = o;
+            }
+            d.batches.push(b);
+        }
+        d.carved += num;
+        d.num_objects += num;
+    }
+
+    batch b = d.batches.back();
+    d.batches.pop_back();
+    d.num_objects -= b.count;
+    d.refills++;
+    pthread_mutex_unlock(&d.mtx);
+
+    // The list is empty: the batch becomes the list
+    cache->free[c] = b.head;
+    cache->count[c].store(b.count, std::memory_order_relaxed);
+}
+
+void mstd::slab_allocator::_flush(thread_cache *cache, size_t c, size_t count) {
+    if (count == 0) return;
+
+    batch b;
+    b.head = cache->free[c];
+    b.count = count;
+    free_object *last = b.head;
+    for (size_t i = 1; i < count; i++) {
+        last = last->next;
+    }
+    cache->free[c] = last->next;
+    last->next = nullptr;
+    cache->count[c].store(cache->count[c].load(std::memory_order_relaxed) - count, std::memory_order_relaxed);
+
+    depot &d = _depot(c);
+    pthread_mutex_lock(&d.mtx);
+    d.batches.push(b);
+    d.num_objects += count;
+    d.flushes++;
+    pthread_mutex_unlock(&d.mtx);
+}
+
+std::string mstd::slab_stats::to_string() const {
+    std::ostringstream out;
+    out << "size  slabs  objects  in use  depot  caches  allocations  refills  flushes\n";
+    for (size_t c = 0; c < classes.size(); c++) {
+        const slab_class_stats &cs = classes[c];
+        if (cs.slabs == 0) continue;
+        out << cs.object_size << "  " << cs.slabs << "  " << cs.objects << "  " << cs.in_use << "  "
+            << cs.in_depot << "  " << cs.in_caches << "  " << cs.allocations << "  " << cs.refills << "  "
+            << cs.flushes << "\n";
+    }
+    out << "large allocations: " << large_allocations << "\n";
+    return out.str();
+}
+
+void *mstd::slab_memory_resource::do_allocate(size_t bytes, size_t alignment) {
+    if (alignment > slab_constants::granularity) {
+        return default_resource()->allocate(bytes, alignment);
+    }
+    return slab_allocator::allocate(bytes);
+}
+
+void mstd::slab_memory_resource::do_deallocate(void *p, size_t bytes, size_t alignment) {
+    if (alignment > slab_constants::granularity) {
+        default_resource()->deallocate(p, bytes, alignment);
+        return;
+    }
+    slab_allocator::deallocate(p, bytes);
+}
+
+void *mstd::slab_memory_resource::do_reallocate(void *p, size_t old_bytes, size_t new_bytes, size_t alignment) {
+    if (alignment <= slab_constants::granularity && old_bytes <= slab_constants::max_object_size
+        && new_bytes <= slab_constants::max_object_size && old_bytes > 0 && new_bytes > 0
+        && class_of(old_bytes) == class_of(new_bytes)) {
+        return p;
+    }
+    return memory_resource::do_reallocate(p, old_bytes, new_bytes, alignment);
+}
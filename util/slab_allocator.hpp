@@ -0,0 +1,127 @@
+#ifndef SLAB_ALLOCATOR_HPP
+#define SLAB_ALLOCATOR_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include "memory_resource.hpp"
+#include "mvector.hpp"
+
+namespace slab_constants {
+    // Objects are rounded up to a multiple of granularity. Anything bigger than max_object_size goes to malloc
+    const size_t granularity = 16;
+    const size_t max_object_size = 256;
+    const size_t num_classes = max_object_size / granularity;
+    // Every slab is carved into objects of a single size class
+    const size_t slab_bytes = 64 * 1024;
+    // Objects move between a thread's cache and the global depot this many at a time
+    const size_t batch_size = 32;
+    // A thread's cache of one size class returns a batch to the depot once it holds this many objects
+    const size_t max_cached = 2 * batch_size;
+}
+
+namespace mstd {
+    // Counters of one size class. Read without stopping the threads that allocate, so only exact when they're idle
+    struct slab_class_stats {
+        size_t object_size = 0;
+        size_t slabs = 0;
+        // Objects carved out of slabs so far
+        size_t objects = 0;
+        size_t in_use = 0;
+        // Free objects in the global depot, and in the threads' caches
+        size_t in_depot = 0;
+        size_t in_caches = 0;
+        size_t allocations = 0;
+        // Batches moved from the depot to a thread cache, and back
+        size_t refills = 0;
+        size_t flushes = 0;
+    };
+
+    struct slab_stats {
+        mstd::vector<slab_class_stats> classes;
+        // Requests bigger than max_object_size, passed on to malloc
+        size_t large_allocations = 0;
+
+        std::string to_string() const;
+    };
+
+    // Allocator for small fixed-size objects (container nodes, tasks), shared by the whole process.
+    // Sizes are grouped into classes of granularity bytes. Each thread keeps a free list per class: allocate
+    // and deallocate only touch that list, so in steady state they're a few instructions and never lock.
+    // A thread whose list runs dry takes a batch of objects from the global depot (carving a new slab when
+    // the depot is empty), and a thread holding too many gives a batch back. Objects can therefore be freed
+    // on any thread, not only the one that allocated them. Slabs are never returned to the system.
+    class slab_allocator {
+    public:
+        static void *allocate(size_t bytes);
+
+        // bytes has to be the size that was passed to allocate
+        static void deallocate(void *p, size_t bytes);
+
+        static slab_stats stats();
+
+    private:
+        struct free_object {
+            free_object *next;
+        };
+
+        struct batch {
+            free_object *head;
+            size_t count;
+        };
+
+        // One per size class. Only touched by the slow paths, under its lock
+        struct depot;
+
+        // One per thread. Records are never freed: a thread that exits empties its record into the depots
+        // and releases it for the next thread
+        struct thread_cache {
+            free_object *free[slab_constants::num_classes];
+            // Written only by the owning thread, read by stats()
+            std::atomic<size_t> count[slab_constants::num_classes];
+            std::atomic<size_t> allocations[slab_constants::num_classes];
+            std::atomic<bool> in_use;
+            thread_cache *next;
+        };
+
+        static std::atomic<thread_cache *> _caches;
+        static std::atomic<size_t> _large_allocations;
+
+        static depot &_depot(size_t c);
+
+        static thread_cache *_local();
+
+        static thread_cache *_acquire_cache();
+
+        static void _refill(thread_cache *cache, size_t c);
+
+        // Gives count objects of the cache's list of class c back to the depot
+        static void _flush(thread_cache *cache, size_t c, size_t count);
+
+        friend struct slab_cache_holder;
+    };
+
+    // slab_allocator as a memory_resource. Over-aligned requests go to default_resource()
+    class slab_memory_resource : public memory_resource {
+    public:
+        bool is_thread_safe() const override {
+            return true;
+        }
+
+    protected:
+        void *do_allocate(size_t bytes, size_t alignment) override;
+
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+
+        // Free when both sizes fall in the same class
+        void *do_reallocate(void *p, size_t old_bytes, size_t new_bytes, size_t alignment) override;
+    };
+
+    // Default resource of the node-based containers (mstd::stack, hash_map's buckets)
+    inline memory_resource *slab_resource() {
+        static slab_memory_resource resource;
+        return &resource;
+    }
+}
+
+#endif // SLAB_ALLOCATOR_HPP
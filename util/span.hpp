@@ -0,0 +1,69 @@
+#ifndef SPAN_HPP
+#define SPAN_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "simd.hpp"
+
+namespace mstd {
+    // Non-owning view of a contiguous array (a subset of C++20's std::span).
+    // span<const T> is a read-only view; a span<T> converts to it.
+    // mstd::vector, mstd::small_vector and mstd::soa_vector columns hand out spans (slice, column), so a range
+    // of elements can be passed around with no allocation or copy. Searches are the same as mstd::vector's
+    template <typename T>
+    class span {
+    public:
+        typedef typename std::remove_const<T>::type value_type;
+
+        static const size_t npos = (size_t) -1;
+
+        span() : _data(nullptr), _size(0) { }
+
+        span(T *data, size_t size) : _data(data), _size(size) { }
+
+        template <typename U, typename = typename std::enable_if<std::is_convertible<U (*)[], T (*)[]>::value>::type>
+        span(const span<U> &other) : _data(other.data()), _size(other.size()) { }
+
+        T *data() const { return _data; }
+
+        size_t size() const { return _size; }
+
+        bool empty() const { return _size == 0; }
+
+        T &operator[](size_t index) const { return _data[index]; }
+
+        T *begin() const { return _data; }
+
+        T *end() const { return _data + _size; }
+
+        span subspan(size_t pos, size_t n = npos) const {
+            if (pos > _size) throw std::out_of_range("Bad index: " + std::to_string(pos));
+            return span(_data + pos, n < _size - pos ? n : _size - pos);
+        }
+
+        bool in(const value_type &value) const { return find(value) != _size; }
+
+        // Index of the first element equal to value, or size() if there's none
+        size_t find(const value_type &value) const { return simd::find<value_type>(_data, _size, value); }
+
+        size_t count(const value_type &value) const { return simd::count<value_type>(_data, _size, value); }
+
+        // Index of the first smallest (largest) element, or 0 if the span is empty
+        size_t min_element() const { return simd::min_element<value_type>(_data, _size); }
+
+        size_t max_element() const { return simd::max_element<value_type>(_data, _size); }
+
+        // Same size, and equal elements
+        bool equal(span<const value_type> other) const {
+            return _size == other.size() && simd::equal<value_type>(_data, other.data(), _size);
+        }
+
+    private:
+        T *_data;
+        size_t _size;
+    };
+}
+
+#endif // SPAN_HPP
@@ -0,0 +1,58 @@
+#ifndef STRING_VIEW_HPP
+#define STRING_VIEW_HPP
+
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+namespace mstd {
+    // Non-owning view of a character sequence (a subset of C++17's std::string_view).
+    // Lets string-keyed containers be searched without building a temporary std::string
+    class string_view {
+    public:
+        static const size_t npos = (size_t) -1;
+
+        string_view() : _data(nullptr), _size(0) { }
+
+        string_view(const char *s) : _data(s), _size(strlen(s)) { }
+
+        string_view(const char *s, size_t size) : _data(s), _size(size) { }
+
+        string_view(const std::string &s) : _data(s.data()), _size(s.length()) { }
+
+        const char *data() const { return _data; }
+
+        size_t size() const { return _size; }
+
+        size_t length() const { return _size; }
+
+        bool empty() const { return _size == 0; }
+
+        char operator[](size_t index) const { return _data[index]; }
+
+        const char *begin() const { return _data; }
+
+        const char *end() const { return _data + _size; }
+
+        string_view substr(size_t pos, size_t n = npos) const {
+            if (pos > _size) throw std::out_of_range("Bad index: " + std::to_string(pos));
+            return string_view(_data + pos, n < _size - pos ? n : _size - pos);
+        }
+
+        std::string to_string() const { return std::string(_data, _size); }
+
+    private:
+        const char *_data;
+        size_t _size;
+    };
+
+    inline bool operator==(string_view a, string_view b) {
+        return a.size() == b.size() && (a.size() == 0 || memcmp(a.data(), b.data(), a.size()) == 0);
+    }
+
+    inline bool operator!=(string_view a, string_view b) {
+        return !(a == b);
+    }
+}
+
+#endif // STRING_VIEW_HPP
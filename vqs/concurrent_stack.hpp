@@ -0,0 +1,176 @@
+#ifndef CONCURRENT_STACK_HPP
+#define CONCURRENT_STACK_HPP
+
+#include <atomic>
+#include <stdexcept>
+#include <utility>
+#include "mvector.hpp"
+#include "epoch.hpp"
+
+namespace mstd {
+    // Lock-free stack (Treiber) that can be shared between threads: push and pop are a single CAS on the top
+    // of the stack, retried under contention.
+    // Popped nodes are retired through epoch.hpp rather than deleted. That also rules out ABA: a node can't be
+    // freed, and its address can't come back to the top of the stack, while a thread that read it is pinned.
+    // push_all and pop_all move a whole batch with one CAS (one exchange for pop_all).
+    template <typename T>
+    class concurrent_stack {
+    public:
+        concurrent_stack();
+        concurrent_stack(const concurrent_stack &)=delete;
+
+        // Must not run concurrently with any other operation
+        ~concurrent_stack();
+
+        void push(const T &value);
+
+        void push(T &&value);
+
+        // Pushes [first, last) in order, so *(last - 1) ends up on top. Other threads see all of them at once
+        template <typename It>
+        void push_all(It first, It last);
+
+        // Returns false if the stack was empty
+        bool try_pop(T &out);
+
+        T pop();
+
+        // Empties the stack into out, top first. Returns the number of values popped
+        size_t pop_all(mstd::vector<T> &out);
+
+        // Only a hint when other threads are pushing or popping
+        bool empty() const;
+
+        concurrent_stack &operator=(const concurrent_stack &)=delete;
+    private:
+        struct node {
+            T value;
+            // Set before the node is published, and never changed afterwards
+            node *next;
+
+            template <typename... Args>
+            explicit node(Args &&... args) : value(std::forward<Args>(args)...), next(nullptr) { }
+        };
+
+        std::atomic<node *> _top;
+
+        // Links the chain first ... last on top of the stack
+        void _push_chain(node *first, node *last);
+
+        // Deleter for a chain detached by pop_all, retired as a single object
+        static void _delete_chain(void *p);
+    };
+}
+
+template <typename T>
+mstd::concurrent_stack<T>::concurrent_stack() : _top(nullptr) { }
+
+template <typename T>
+mstd::concurrent_stack<T>::~concurrent_stack() {
+    _delete_chain(_top.load(std::memory_order_relaxed));
+}
+
+template <typename T>
+void mstd::concurrent_stack<T>::push(const T &value) {
+    node *n = new node(value);
+    _push_chain(n, n);
+}
+
+template <typename T>
+void mstd::concurrent_stack<T>::push(T &&value) {
+    node *n = new node(std::move(value));
+    _push_chain(n, n);
+}
+
+template <typename T>
+template <typename It>
+void mstd::concurrent_stack<T>::push_all(It first, It last) {
+    if (first == last) return;
+
+    // Built privately, newest first
+    node *bottom = new node(*first);
+    node *top = bottom;
+    for (++first; first != last; ++first) {
+        node *n = new node(*first);
+        n->next = top;
+        top = n;
+    }
+
+    _push_chain(top, bottom);
+}
+
+template <typename T>
+bool mstd::concurrent_stack<T>::try_pop(T &out) {
+    epoch::guard g;
+    node *n = _top.load(std::memory_order_acquire);
+    // n->next is safe to read: n can't be freed while this thread is pinned
+    while (n != nullptr && !_top.compare_exchange_weak(n, n->next, std::memory_order_acquire)) { }
+
+    if (n == nullptr) {
+        return false;
+    }
+
+    // Only the thread whose CAS succeeded touches the value
+    out = std::move(n->value);
+    epoch::retire(n);
+    return true;
+}
+
+template <typename T>
+T mstd::concurrent_stack<T>::pop() {
+    epoch::guard g;
+    node *n = _top.load(std::memory_order_acquire);
+    while (n != nullptr && !_top.compare_exchange_weak(n, n->next, std::memory_order_acquire)) { }
+
+    if (n == nullptr) {
+        throw std::runtime_error("stack is empty");
+    }
+
+    T value(std::move(n->value));
+    epoch::retire(n);
+    return value;
+}
+
+template <typename T>
+size_t mstd::concurrent_stack<T>::pop_all(mstd::vector<T> &out) {
+    epoch::guard g;
+    node *chain = _top.exchange(nullptr, std::memory_order_acquire);
+    if (chain == nullptr) {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (node *n = chain; n != nullptr; n = n->next) {
+        out.push(std::move(n->value));
+        count++;
+    }
+
+    // Threads that read one of these nodes before the exchange may still follow its next pointer
+    epoch::retire(chain, &_delete_chain);
+    return count;
+}
+
+template <typename T>
+bool mstd::concurrent_stack<T>::empty() const {
+    return _top.load(std::memory_order_acquire) == nullptr;
+}
+
+template <typename T>
+void mstd::concurrent_stack<T>::_push_chain(node *first, node *last) {
+    node *top = _top.load(std::memory_order_relaxed);
+    do {
+        last->next = top;
+    } while (!_top.compare_exchange_weak(top, first, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template <typename T>
+void mstd::concurrent_stack<T>::_delete_chain(void *p) {
+    node *n = static_cast<node *>(p);
+    while (n != nullptr) {
+        node *next = n->next;
+        delete n;
+        n = next;
+    }
+}
+
+#endif // CONCURRENT_STACK_HPP
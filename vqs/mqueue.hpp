@@ -1,57 +1,79 @@
 #ifndef QUEUE_H_
 #define QUEUE_H_
 
+#include <cstddef>
 #include <stdexcept>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "memory_resource.hpp"
+
+namespace queue_constants {
+    // Elements are stored in blocks of about this many bytes
+    const size_t block_bytes = 4096;
+    // ... but never fewer than this many elements per block
+    const size_t min_block_items = 8;
+    // Drained blocks kept for reuse instead of being given back to the memory_resource
+    const size_t max_spare_blocks = 2;
+}
 
 namespace mstd {
 // To be used only as pointer. Copying doesn't work
+// Elements are stored in a chain of fixed-size blocks: push fills the last block, pop drains the first one,
+// and a drained block is kept for a later push. A queue that stays around the same size never allocates,
+// and popping walks memory sequentially instead of chasing a pointer per element.
+// Blocks are allocated from a memory_resource
     template<typename T>
     class queue {
     private:
-        class queue_node {
-        private:
-            T _entry;
-            queue_node *_next;
-        public:
-            explicit queue_node(T ent, queue_node *next = nullptr, queue_node *prev = nullptr) {
-                _entry = ent;
-                _next = next;
-            }
-
-            queue_node(const queue_node &other)=delete;
+        static constexpr size_t _block_capacity =
+                sizeof(T) * queue_constants::min_block_items > queue_constants::block_bytes
+                ? queue_constants::min_block_items : queue_constants::block_bytes / sizeof(T);
 
-            ~queue_node()=default;
+        struct block {
+            block *next;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type items[_block_capacity];
+        };
 
-            queue_node *get_next() { return _next; }
+        // Elements live in [_head, _block_capacity) of _head_block, the full blocks in between,
+        // and [0, _tail) of _tail_block. Both blocks are nullptr until the first push
+        block *_head_block;
+        block *_tail_block;
+        size_t _head;
+        size_t _tail;
+        size_t _size;
+        int _max;
+        // Singly linked through next
+        block *_spare;
+        size_t _num_spare;
+        memory_resource *_resource;
 
-            void set_next(queue_node *next) {
-                _next = next;
-            }
+        static T &_item(block *b, size_t index);
 
-            void add_next(queue_node *next) {
-                _next = new queue_node(next->_entry);
-            }
+        block *_take_block();
 
-            T &get_entry() { return _entry; }
+        void _recycle_block(block *b);
 
-            queue_node &operator=(const queue_node &other)=delete;
-        };
+        void _destroy_items();
 
-        queue_node *_head;
-        queue_node *_last;
-        size_t _size;
-        int _max;
+        void _free_blocks();
     public:
-        explicit queue(int max = -1);
+        explicit queue(int max = -1, memory_resource *resource = default_resource());
 
         queue(const queue &)=delete;
 
         ~queue();
 
-        void push(T ent);
+        void push(const T &ent);
+
+        void push(T &&ent);
+
+        template <typename... Args>
+        void emplace(Args &&... args);
 
         bool empty();
 
+        // Destroys every element and gives every block back to the memory_resource
         void clear();
 
         T pop();
@@ -60,10 +82,6 @@ namespace mstd {
 
         T &peek();
 
-        queue_node* get_head();
-
-        queue_node* get_last();
-
         /* For unit test purposes only */
         T &get_element_at(int pos);
 
@@ -74,30 +92,45 @@ namespace mstd {
 }
 
 template <typename T>
-mstd::queue<T>::queue(int max) : _head(nullptr), _last(nullptr), _size(0), _max(max) { }
+constexpr size_t mstd::queue<T>::_block_capacity;
+
+template <typename T>
+mstd::queue<T>::queue(int max, memory_resource *resource)
+        : _head_block(nullptr), _tail_block(nullptr), _head(0), _tail(0), _size(0), _max(max),
+          _spare(nullptr), _num_spare(0), _resource(resource) { }
 
 template <typename T>
 mstd::queue<T>::~queue() {
-    queue_node *curr;
-    while(_head) {
-        curr = _head;
-        _head = _head->get_next();
-        delete curr;
-    }
+    _destroy_items();
+    _free_blocks();
+}
+
+template <typename T>
+void mstd::queue<T>::push(const T &ent) {
+    emplace(ent);
+}
+
+template <typename T>
+void mstd::queue<T>::push(T &&ent) {
+    emplace(std::move(ent));
 }
 
 template <typename T>
-void mstd::queue<T>::push(T ent) {
+template <typename... Args>
+void mstd::queue<T>::emplace(Args &&... args) {
     if (full()) throw std::runtime_error("Queue is full");
-    if (_head == nullptr) {
-        _last = _head = new queue_node(ent);
-        _size++;
-        return;
+    if (_tail_block == nullptr) {
+        _head_block = _tail_block = _take_block();
+        _head = _tail = 0;
+    } else if (_tail == _block_capacity) {
+        block *b = _take_block();
+        _tail_block->next = b;
+        _tail_block = b;
+        _tail = 0;
     }
 
-    auto *curr = new queue_node(ent, nullptr, _last);
-    _last->set_next(curr);
-    _last = curr;
+    new (&_tail_block->items[_tail]) T(std::forward<Args>(args)...);
+    _tail++;
     _size++;
 }
 
@@ -108,28 +141,36 @@ bool mstd::queue<T>::empty() {
 
 template <typename T>
 void mstd::queue<T>::clear() {
-    queue_node *curr;
-    while(_head) {
-        curr = _head;
-        _head = _head->get_next();
-        delete curr;
-    }
-    _head = nullptr;
-    _last = nullptr;
+    _destroy_items();
+    _free_blocks();
+    _head_block = _tail_block = nullptr;
+    _head = _tail = 0;
     _size = 0;
 }
 
 template <typename T>
 T mstd::queue<T>::pop() {
-    if (_head == nullptr) {
+    if (_size == 0) {
         throw std::runtime_error("queue is empty");
     }
 
-    T tmp = _head->get_entry();
-    queue_node *curr = _head->get_next();
-    delete _head;
-    _head = curr;
+    T &front = _item(_head_block, _head);
+    T tmp(std::move(front));
+    front.~T();
+    _head++;
     _size--;
+
+    if (_head == _block_capacity && _head_block != _tail_block) {
+        block *next = _head_block->next;
+        _recycle_block(_head_block);
+        _head_block = next;
+        _head = 0;
+    }
+    // An empty queue starts over at the beginning of its block
+    if (_size == 0) {
+        _head = _tail = 0;
+    }
+
     return tmp;
 }
 
@@ -138,32 +179,27 @@ size_t mstd::queue<T>::size() { return _size; }
 
 template <typename T>
 T &mstd::queue<T>::peek() {
-    if (_head == nullptr)
+    if (_size == 0)
         throw std::runtime_error("queue is empty");
 
-    return _head->get_entry();
+    return _item(_head_block, _head);
 }
 
-template <typename T>
-typename mstd::queue<T>::queue_node* mstd::queue<T>::get_head(){ return _head; }
-
-template <typename T>
-typename mstd::queue<T>::queue_node* mstd::queue<T>::get_last(){ return _last; }
-
 /* For unit test purposes only */
 template <typename T>
 T &mstd::queue<T>::get_element_at(int pos){
-    if (_head == nullptr)
+    if (_size == 0)
         throw std::runtime_error("queue is empty");
-    if (pos < 0 || pos > _size){
+    if (pos < 0 || (size_t) pos >= _size){
         throw std::out_of_range("index out of range");
     }
 
-    queue_node* aux = _head;
-    for (size_t i = 0; i < pos; i++) {
-        aux = aux->get_next();
+    size_t index = _head + pos;
+    block *b = _head_block;
+    for (; index >= _block_capacity; index -= _block_capacity) {
+        b = b->next;
     }
-    return aux->get_entry();
+    return _item(b, index);
 }
 
 template <typename T>
@@ -171,4 +207,61 @@ bool mstd::queue<T>::full() {
     return ((int) _size == _max) && (_max > 0);
 }
 
+template <typename T>
+T &mstd::queue<T>::_item(block *b, size_t index) {
+    return *reinterpret_cast<T *>(&b->items[index]);
+}
+
+template <typename T>
+typename mstd::queue<T>::block *mstd::queue<T>::_take_block() {
+    block *b = _spare;
+    if (b != nullptr) {
+        _spare = b->next;
+        _num_spare--;
+    } else {
+        b = static_cast<block *>(_resource->allocate(sizeof(block), alignof(block)));
+    }
+    b->next = nullptr;
+    return b;
+}
+
+template <typename T>
+void mstd::queue<T>::_recycle_block(block *b) {
+    if (_num_spare < queue_constants::max_spare_blocks) {
+        b->next = _spare;
+        _spare = b;
+        _num_spare++;
+    } else {
+        _resource->deallocate(b, sizeof(block), alignof(block));
+    }
+}
+
+template <typename T>
+void mstd::queue<T>::_destroy_items() {
+    if (std::is_trivially_destructible<T>::value) return;
+    for (block *b = _head_block; b != nullptr; b = b->next) {
+        size_t first = b == _head_block ? _head : 0;
+        size_t last = b == _tail_block ? _tail : _block_capacity;
+        for (size_t i = first; i < last; i++) {
+            _item(b, i).~T();
+        }
+    }
+}
+
+template <typename T>
+void mstd::queue<T>::_free_blocks() {
+    block *b = _head_block;
+    while (b != nullptr) {
+        block *next = b->next;
+        _resource->deallocate(b, sizeof(block), alignof(block));
+        b = next;
+    }
+    while (_spare != nullptr) {
+        block *next = _spare->next;
+        _resource->deallocate(_spare, sizeof(block), alignof(block));
+        _spare = next;
+    }
+    _num_spare = 0;
+}
+
 #endif /* QUEUE_H_ */
@@ -1,9 +1,14 @@
 #ifndef MSTACK
 #define MSTACK
 #include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include "slab_allocator.hpp"
 
 namespace mstd {
 
+    // Nodes are allocated from a memory_resource, by default the slab allocator
     template <typename T>
     class stack {
     private:
@@ -49,9 +54,15 @@ namespace mstd {
         node *_head;
         size_t _size;
         int _max;
+        memory_resource *_resource;
+
+        template <typename... Args>
+        node *_new_node(Args &&... args);
+
+        void _delete_node(node *n);
 
     public:
-        explicit stack(int max = -1);
+        explicit stack(int max = -1, memory_resource *resource = slab_resource());
 
         stack(const stack &other)=delete;
 
@@ -79,7 +90,7 @@ namespace mstd {
 }
 
 template <typename T>
-mstd::stack<T>::stack(int max): _head(nullptr), _size(0), _max(max) { }
+mstd::stack<T>::stack(int max, memory_resource *resource): _head(nullptr), _size(0), _max(max), _resource(resource) { }
 
 template <typename T>
 mstd::stack<T>::~stack() {
@@ -87,7 +98,7 @@ mstd::stack<T>::~stack() {
     node *next;
     while (tmp) {
         next = tmp->get_next();
-        delete tmp;
+        _delete_node(tmp);
         tmp = next;
     }
 }
@@ -96,11 +107,11 @@ template <typename T>
 void mstd::stack<T>::push(T ent) {
     if (full()) throw std::runtime_error("stack is full");
     if (_head == nullptr) {
-        _head = new node(ent);
+        _head = _new_node(ent);
         _size++;
         return;
     }
-    auto *new_node = new node(ent, _head);
+    auto *new_node = _new_node(ent, _head);
     _head = new_node;
     _size++;
 }
@@ -111,7 +122,7 @@ T mstd::stack<T>::pop() {
     T tmp = _head->get_entry();
     node *tmp_node = _head;
     _head = _head->get_next();
-    delete tmp_node;
+    _delete_node(tmp_node);
     _size--;
     return tmp;
 }
@@ -128,7 +139,7 @@ void mstd::stack<T>::clear() {
     while(_head) {
         curr = _head;
         _head = _head->get_next();
-        delete curr;
+        _delete_node(curr);
     }
     _head = nullptr;
     _size = 0;
@@ -159,4 +170,17 @@ bool mstd::stack<T>::full() { return (_size == _max) && (_max > 0); }
 template <typename T>
 bool mstd::stack<T>::empty() { return _size == 0; }
 
+template <typename T>
+template <typename... Args>
+typename mstd::stack<T>::node *mstd::stack<T>::_new_node(Args &&... args) {
+    void *p = _resource->allocate(sizeof(node), alignof(node));
+    return new (p) node(std::forward<Args>(args)...);
+}
+
+template <typename T>
+void mstd::stack<T>::_delete_node(node *n) {
+    n->~node();
+    _resource->deallocate(n, sizeof(node), alignof(node));
+}
+
 #endif // MSTACK
\ No newline at end of file
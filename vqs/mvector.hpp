@@ -3,19 +3,40 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
 #include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "memory_resource.hpp"
+#include "simd.hpp"
+#include "span.hpp"
+
+namespace vector_constants {
+    // Capacity is multiplied by this when a vector is full (see vector::set_growth_factor)
+    const double default_growth_factor = 2.0;
+}
 
 // Simple resizable array template class
-// that includes some of std::vector's basic operations
+// that includes some of std::vector's basic operations.
+// Storage is raw memory: only the first size() slots hold constructed elements.
+// Trivially copyable types are copied with memcpy and grown with the resource's reallocate (realloc by default).
+// Memory comes from a memory_resource (malloc unless told otherwise), which copies share.
+// Searches over arithmetic types run on SIMD kernels when util/simd.cpp is linked in (see simd.hpp).
+// slice() and the conversions to span view the elements in place: sub-ranges need no copy. A const vector
+// only hands out span<const T>
 namespace mstd {
     template <typename T>
     class vector {
 
     public:
-        explicit vector(size_t capacity = 1);
+        explicit vector(size_t capacity = 1, memory_resource *resource = default_resource());
 
         vector(const vector &other);
-        vector(T *arr, size_t arr_size);
+        vector(T *arr, size_t arr_size, memory_resource *resource = default_resource());
+        // Copies other's elements [start, end). slice(start, end) views them without copying
         vector(const vector &other, size_t start, size_t end);
         vector(vector &&other) noexcept;
 
@@ -23,6 +44,9 @@ namespace mstd {
 
         void push(const T &ent); 
         void push(T &&ent); 
+        // Constructs the new element from args
+        template <typename... Args>
+        T &emplace(Args &&... args);
         T *m_push(T &ent); 
         T *m_insert_at(int index, T &ent); 
 
@@ -31,12 +55,37 @@ namespace mstd {
 
         void shrink_to_size(); 
 
+        // Makes room for capacity elements. Never shrinks
+        void reserve(size_t capacity);
+
+        // Capacity is multiplied by factor (> 1) on growth. Lower factors trade push speed for memory
+        void set_growth_factor(double factor);
+
         bool in(const T &ent) const; 
 
+        // Index of the first element equal to ent, or size() if there's none
+        size_t find(const T &ent) const;
+
+        size_t count(const T &ent) const;
+
+        // Index of the first smallest (largest) element, or 0 if the vector is empty
+        size_t min_element() const;
+
+        size_t max_element() const;
+
+        // Same size, and equal elements
+        bool equal(const vector &other) const;
+
         T &at(size_t index) const; 
 
         T *at_p(size_t index); 
 
+        // View of the elements [start, end), valid until the vector is resized
+        span<T> slice(size_t start, size_t end);
+
+        span<const T> slice(size_t start, size_t end) const;
+
+        // Destroys every element. Keeps the current storage, growing it to new_cap if needed
         void clear(size_t new_cap = 1); 
 
         void set_at(size_t index, const T &ent); 
@@ -49,12 +98,19 @@ namespace mstd {
 
         void remove_at(size_t index);
 
-        size_t capacity();
+        size_t capacity() const;
 
         size_t size() const; 
 
+        memory_resource *get_resource() const;
+
         T &operator[](size_t index) const; 
 
+        // View of every element, valid until the vector is resized
+        operator span<T>();
+
+        operator span<const T>() const;
+
         // Copy assignment operator
         vector &operator=(const vector &other); 
 
@@ -68,39 +124,61 @@ namespace mstd {
         size_t _size{};
         size_t _capacity;
         T *_entries;
+        double _growth_factor;
+        memory_resource *_resource;
+
+        static const bool _trivial = std::is_trivially_copyable<T>::value;
 
         void _enlarge(); 
+
+        // Moves the elements to a buffer of new_capacity slots
+        void _reallocate(size_t new_capacity);
+
+        void _destroy_all();
+
+        T *_allocate(size_t capacity);
+
+        void _free();
     };
 }
 
 template <typename T>
-mstd::vector<T>::vector(size_t capacity)
-        : _size(0), _capacity(capacity) {
-    _entries = new T[_capacity];
+mstd::vector<T>::vector(size_t capacity, memory_resource *resource)
+        : _size(0), _capacity(capacity), _growth_factor(vector_constants::default_growth_factor), _resource(resource) {
+    _entries = _allocate(_capacity);
 }
 
 template <typename T>
 mstd::vector<T>::vector(const mstd::vector<T> &other)
         : _size(other._size),
-        _capacity(other._capacity) {
-    _entries = new T[_capacity];
-    std::copy(other._entries, other._entries + other._size, _entries);
+        _capacity(other._capacity),
+        _growth_factor(other._growth_factor),
+        _resource(other._resource) {
+    _entries = _allocate(_capacity);
+    if (_trivial) {
+        memcpy((void *) _entries, other._entries, _size * sizeof(T));
+    } else {
+        std::uninitialized_copy(other._entries, other._entries + other._size, _entries);
+    }
 }
 
 template <typename T>
-mstd::vector<T>::vector(T *arr, size_t arr_size)
-        : _capacity(arr_size), _size(arr_size) {
-    _entries = new T[_capacity];
-    std::copy(arr, arr + arr_size, _entries);
+mstd::vector<T>::vector(T *arr, size_t arr_size, memory_resource *resource)
+        : _size(arr_size), _capacity(arr_size), _growth_factor(vector_constants::default_growth_factor),
+          _resource(resource) {
+    _entries = _allocate(_capacity);
+    std::uninitialized_copy(arr, arr + arr_size, _entries);
 }
 
 template <typename T>
-mstd::vector<T>::vector(const mstd::vector<T> &other, size_t start, size_t end) {
-    if (start < 0 || end > other._size) return;
-    _capacity = other._capacity;
-    _size = (size_t) end - start;
-    _entries = new T[_capacity];
-    std::copy(other._entries + start, other._entries + end, _entries);
+mstd::vector<T>::vector(const mstd::vector<T> &other, size_t start, size_t end)
+        : _size(0), _capacity(start <= end && end <= other._size ? end - start : 0), _growth_factor(other._growth_factor),
+          _resource(other._resource) {
+    // Room for the range only, not for all of other
+    _entries = _allocate(_capacity);
+    if (start > end || end > other._size) return;
+    std::uninitialized_copy(other._entries + start, other._entries + end, _entries);
+    _size = end - start;
 }
 
 template <typename T>
@@ -111,33 +189,54 @@ mstd::vector<T>::vector(vector<T> &&other) noexcept : vector() {
 
 template <typename T>
 mstd::vector<T>::~vector() {
-    delete[] _entries;
+    _destroy_all();
+    _free();
 }
 
 template <typename T>
 void mstd::vector<T>::push(const T &ent) {
     if (_size + 1 > _capacity) {
+        // ent may be one of our own elements: copy it before the storage moves
+        T tmp(ent);
         _enlarge();
+        new (&_entries[_size++]) T(std::move(tmp));
+        return;
     }
 
-    _entries[_size++] = T(ent);
+    new (&_entries[_size++]) T(ent);
 }
 
 template <typename T>
 void mstd::vector<T>::push(T &&ent) {
     if (_size + 1 > _capacity) {
+        T tmp(std::move(ent));
         _enlarge();
+        new (&_entries[_size++]) T(std::move(tmp));
+        return;
     }
 
-    _entries[_size++] = ent;
+    new (&_entries[_size++]) T(std::move(ent));
 }
 
 template <typename T>
-T *mstd::vector<T>::m_push(T &ent) {
-    if (_size + 1 > _capacity) _enlarge();
+template <typename... Args>
+T &mstd::vector<T>::emplace(Args &&... args) {
+    if (_size + 1 > _capacity) {
+        // args may refer to our own elements
+        T tmp(std::forward<Args>(args)...);
+        _enlarge();
+        new (&_entries[_size]) T(std::move(tmp));
+        return _entries[_size++];
+    }
 
-    _entries[_size] = std::move(ent);
-    return &_entries[_size++];
+    new (&_entries[_size]) T(std::forward<Args>(args)...);
+    return _entries[_size++];
+}
+
+template <typename T>
+T *mstd::vector<T>::m_push(T &ent) {
+    push(std::move(ent));
+    return &_entries[_size - 1];
 }
 
 template <typename T>
@@ -145,18 +244,20 @@ T *mstd::vector<T>::m_insert_at(int index, T &ent) {
     // Changed: Throws an out_of_range exception if
     // an entry is about to be placed over the size of the vector
     // (because it would cause too many other problems)
-    if (index > _size + 1) {
+    if (index < 0 || (size_t) index > _size) {
         throw std::out_of_range("Index out of range");
     }
 
-    if ((_size == 0) || (index == _size)) {
+    if ((_size == 0) || ((size_t) index == _size)) {
         return m_push(ent);
     }
 
-    if (_size + 1 >= _capacity) _enlarge();
+    if (_size + 1 > _capacity) _enlarge();
 
-    for (size_t i = _size - 1; (int) i >= index; i--) {
-        _entries[i + 1] = std::move(_entries[i]);
+    // The last element moves into raw storage, the others are shifted by assignment
+    new (&_entries[_size]) T(std::move(_entries[_size - 1]));
+    for (size_t i = _size - 1; i > (size_t) index; i--) {
+        _entries[i] = std::move(_entries[i - 1]);
     }
 
     _entries[index] = std::move(ent);
@@ -167,7 +268,7 @@ T *mstd::vector<T>::m_insert_at(int index, T &ent) {
 
 template <typename T>
 T &mstd::vector<T>::back() {
-    if (_size - 1 < 0) {
+    if (_size == 0) {
         throw std::out_of_range("Requesting back of empty vector");
     }
     return _entries[_size - 1];
@@ -178,34 +279,65 @@ void mstd::vector<T>::pop_back() {
     if (_size == 0) {
         return;
     }
-    
-    _size--;
+
+    _entries[--_size].~T();
 }
 
 template <typename T>
 void mstd::vector<T>::shrink_to_size() {
-    auto *tmp = new T[_size];
-    for (size_t i = 0; i < _size; i++) {
-        tmp[i] = _entries[i];
+    if (_size != _capacity) {
+        _reallocate(_size);
     }
-    delete[] _entries;
-    _entries = tmp;
-    _capacity = _size;
 }
 
 template <typename T>
-bool mstd::vector<T>::in(const T &ent) const {
-    for (size_t i = 0; i < _size; i++) {
-        if (_entries[i] == ent) {
-            return true;
-        }
+void mstd::vector<T>::reserve(size_t capacity) {
+    if (capacity > _capacity) {
+        _reallocate(capacity);
+    }
+}
+
+template <typename T>
+void mstd::vector<T>::set_growth_factor(double factor) {
+    if (factor <= 1) {
+        throw std::invalid_argument("Growth factor must be greater than 1");
     }
-    return false;
+    _growth_factor = factor;
+}
+
+template <typename T>
+bool mstd::vector<T>::in(const T &ent) const {
+    return simd::find(_entries, _size, ent) != _size;
+}
+
+template <typename T>
+size_t mstd::vector<T>::find(const T &ent) const {
+    return simd::find(_entries, _size, ent);
+}
+
+template <typename T>
+size_t mstd::vector<T>::count(const T &ent) const {
+    return simd::count(_entries, _size, ent);
+}
+
+template <typename T>
+size_t mstd::vector<T>::min_element() const {
+    return simd::min_element(_entries, _size);
+}
+
+template <typename T>
+size_t mstd::vector<T>::max_element() const {
+    return simd::max_element(_entries, _size);
+}
+
+template <typename T>
+bool mstd::vector<T>::equal(const vector &other) const {
+    return _size == other._size && simd::equal(_entries, other._entries, _size);
 }
 
 template <typename T>
 T &mstd::vector<T>::at(size_t index) const {
-    if (index >= (int) _size) {
+    if (index >= _size) {
         throw std::out_of_range("Index out of range:");
     }
 
@@ -222,17 +354,32 @@ T *mstd::vector<T>::at_p(size_t index) {
 }
 
 template <typename T>
-void mstd::vector<T>::clear(size_t new_cap) {
-    delete[] _entries;
-    _size = 0;
+mstd::span<T> mstd::vector<T>::slice(size_t start, size_t end) {
+    if (start > end || end > _size) {
+        throw std::out_of_range("Bad slice: [" + std::to_string(start) + ", " + std::to_string(end) + ")");
+    }
+
+    return span<T>(_entries + start, end - start);
+}
 
-    _capacity = new_cap;
-    _entries = new T[_capacity];
+template <typename T>
+mstd::span<const T> mstd::vector<T>::slice(size_t start, size_t end) const {
+    if (start > end || end > _size) {
+        throw std::out_of_range("Bad slice: [" + std::to_string(start) + ", " + std::to_string(end) + ")");
+    }
+
+    return span<const T>(_entries + start, end - start);
+}
+
+template <typename T>
+void mstd::vector<T>::clear(size_t new_cap) {
+    _destroy_all();
+    reserve(new_cap);
 }
 
 template <typename T>
 void mstd::vector<T>::set_at(size_t index, const T &ent) {
-    if (index < 0 || index >= _size) {
+    if (index >= _size) {
         throw std::out_of_range("Bad index: " + std::to_string(index));
     }
 
@@ -244,17 +391,17 @@ void mstd::vector<T>::set_at(size_t index, const T &ent) {
 // (for (int i : vec))
 template <typename T>
 T *mstd::vector<T>::begin() {
-    return &_entries[0];
+    return _entries;
 }
 
 template <typename T>
 T *mstd::vector<T>::end() {
-    return &_entries[_size];
+    return _entries + _size;
 }
 
 template <typename T>
 void mstd::vector<T>::remove_at(size_t index) {
-    if (index >= _size || index < 0) {
+    if (index >= _size) {
         throw std::out_of_range("Bad index: " + std::to_string(index));
     }
 
@@ -262,21 +409,35 @@ void mstd::vector<T>::remove_at(size_t index) {
         _entries[i - 1] = std::move(_entries[i]);
     }
 
-    _size--;
-
+    _entries[--_size].~T();
 }
 template <typename T>
-size_t mstd::vector<T>::capacity() {
+size_t mstd::vector<T>::capacity() const {
     return _capacity;
 }
 template <typename T>
 size_t mstd::vector<T>::size() const { return _size; }
 
+template <typename T>
+mstd::memory_resource *mstd::vector<T>::get_resource() const {
+    return _resource;
+}
+
 template <typename T>
 T &mstd::vector<T>::operator[](size_t index) const {
     return at(index);
 }
 
+template <typename T>
+mstd::vector<T>::operator span<T>() {
+    return span<T>(_entries, _size);
+}
+
+template <typename T>
+mstd::vector<T>::operator span<const T>() const {
+    return span<const T>(_entries, _size);
+}
+
 template <typename T>
 mstd::vector<T> &mstd::vector<T>::operator=(const vector &other) {
     vector tmp(other);
@@ -288,27 +449,67 @@ mstd::vector<T> &mstd::vector<T>::operator=(const vector &other) {
 template <typename T>
 mstd::vector<T> &mstd::vector<T>::operator=(vector &&other) noexcept {
     _swap_vectors(*this, other);
+
+    return *this;
 }
 
 template <typename T>
 void mstd::vector<T>::_enlarge() {
-    auto *tmp = new T[_capacity << 1];
-    for (size_t i = 0; i < _size; i++) {
-        tmp[i] = std::move(_entries[i]);
+    auto grown = (size_t) ((double) _capacity * _growth_factor);
+    _reallocate(grown > _capacity ? grown : _capacity + 1);
+}
+
+template <typename T>
+void mstd::vector<T>::_reallocate(size_t new_capacity) {
+    if (_trivial) {
+        // Trivially copyable elements can be relocated bytewise, and realloc may not even have to move them
+        void *tmp = _resource->reallocate(_entries, (_capacity > 0 ? _capacity : 1) * sizeof(T),
+                                          (new_capacity > 0 ? new_capacity : 1) * sizeof(T), alignof(T));
+        _entries = static_cast<T *>(tmp);
+    } else {
+        T *tmp = _allocate(new_capacity);
+        for (size_t i = 0; i < _size; i++) {
+            new (&tmp[i]) T(std::move(_entries[i]));
+            _entries[i].~T();
+        }
+        _free();
+        _entries = tmp;
     }
 
-    delete[] _entries;
-    _entries = tmp;
+    _capacity = new_capacity;
+}
 
-    _capacity <<= 1;
+template <typename T>
+void mstd::vector<T>::_destroy_all() {
+    if (!std::is_trivially_destructible<T>::value) {
+        for (size_t i = 0; i < _size; i++) {
+            _entries[i].~T();
+        }
+    }
+    _size = 0;
+}
+
+template <typename T>
+T *mstd::vector<T>::_allocate(size_t capacity) {
+    // Always allocate something, so that _entries is never null
+    return static_cast<T *>(_resource->allocate((capacity > 0 ? capacity : 1) * sizeof(T), alignof(T)));
 }
 
 template <typename T>
-void _swap_vectors(mstd::vector<T> &v1, mstd::vector<T> &v2) {
-    using std::swap;
-    swap(v1._size, v2._size);
-    swap(v1._capacity, v2._capacity);
-    swap(v1._entries, v2._entries);
+void mstd::vector<T>::_free() {
+    _resource->deallocate(_entries, (_capacity > 0 ? _capacity : 1) * sizeof(T), alignof(T));
+}
+
+namespace mstd {
+    template <typename T>
+    void _swap_vectors(mstd::vector<T> &v1, mstd::vector<T> &v2) {
+        using std::swap;
+        swap(v1._size, v2._size);
+        swap(v1._capacity, v2._capacity);
+        swap(v1._entries, v2._entries);
+        swap(v1._growth_factor, v2._growth_factor);
+        swap(v1._resource, v2._resource);
+    }
 }
 
 
@@ -0,0 +1,321 @@
+#ifndef PRIORITY_QUEUE_HPP
+#define PRIORITY_QUEUE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include "memory_resource.hpp"
+#include "mvector.hpp"
+#include "span.hpp"
+
+namespace priority_queue_constants {
+    // Children per node
+    const size_t default_arity = 4;
+}
+
+namespace mstd {
+    // Priority queue (same order as std::priority_queue: with std::less the largest element is on top),
+    // as an implicit D-ary heap in one contiguous mstd::vector: the children of i are D * i + 1 ... D * i + D.
+    // A 4-ary heap is half as deep as a binary one, and the children a pop compares are next to each other
+    // (one or two cache lines), so a pop touches about half as many lines. Sifting moves a hole down (or up)
+    // instead of swapping elements.
+    //
+    // With a limit, the queue keeps the limit elements that would come out last, and discards the others as
+    // it goes: bounded at k with std::greater (smallest on top), it keeps the k largest elements pushed.
+    // Top-k selection is then O(n log k) in O(k) memory, and the top is the k-th largest:
+    //
+    //     mstd::priority_queue<int, std::greater<int>> top(k);
+    //     for (int x : input) top.push(x);
+    //
+    // Storage comes from a memory_resource
+    template <typename T, typename Compare = std::less<T>, size_t D = priority_queue_constants::default_arity>
+    class priority_queue {
+    public:
+        // limit is the number of elements kept, or -1 for no limit
+        explicit priority_queue(int limit = -1, Compare comp = Compare(),
+                                memory_resource *resource = default_resource());
+
+        // Takes items over and builds the heap in O(n)
+        explicit priority_queue(mstd::vector<T> &&items, Compare comp = Compare());
+
+        priority_queue(const priority_queue &other)=default;
+        priority_queue(priority_queue &&other)=default;
+
+        // Returns false if a bounded queue discarded value
+        bool push(const T &value);
+
+        bool push(T &&value);
+
+        template <typename... Args>
+        bool emplace(Args &&... args);
+
+        // Adds every item. Rebuilds the heap bottom-up when that's cheaper than pushing them one by one
+        void heapify(span<const T> items);
+
+        // Removes and returns the top element
+        T pop();
+
+        // Moves every element to out, in the order pop would return them
+        void pop_all(mstd::vector<T> &out);
+
+        const T &top() const;
+
+        // Replaces the top element with value and returns it: a pop and a push with a single sift
+        T replace_top(T value);
+
+        size_t size() const;
+
+        bool empty() const;
+
+        int limit() const;
+
+        void clear();
+
+        priority_queue &operator=(const priority_queue &other)=default;
+
+        priority_queue &operator=(priority_queue &&other)=default;
+
+    private:
+        mstd::vector<T> _heap;
+        Compare _comp;
+        int _limit;
+
+        bool _full() const;
+
+        // Elements that would come out before the top of a full bounded queue aren't kept
+        bool _keeps(const T &value) const;
+
+        void _sift_up(size_t index);
+
+        void _sift_down(size_t index);
+
+        // Floyd's bottom-up construction
+        void _build();
+    };
+}
+
+template <typename T, typename Compare, size_t D>
+mstd::priority_queue<T, Compare, D>::priority_queue(int limit, Compare comp, memory_resource *resource)
+        : _heap(limit > 0 ? (size_t) limit : 1, resource), _comp(comp), _limit(limit) {
+    static_assert(D >= 2, "priority_queue needs at least 2 children per node");
+}
+
+template <typename T, typename Compare, size_t D>
+mstd::priority_queue<T, Compare, D>::priority_queue(mstd::vector<T> &&items, Compare comp)
+        : _heap(std::move(items)), _comp(comp), _limit(-1) {
+    static_assert(D >= 2, "priority_queue needs at least 2 children per node");
+    _build();
+}
+
+template <typename T, typename Compare, size_t D>
+bool mstd::priority_queue<T, Compare, D>::push(const T &value) {
+    if (_full()) {
+        if (!_keeps(value)) return false;
+        replace_top(value);
+        return true;
+    }
+
+    _heap.push(value);
+    _sift_up(_heap.size() - 1);
+    return true;
+}
+
+template <typename T, typename Compare, size_t D>
+bool mstd::priority_queue<T, Compare, D>::push(T &&value) {
+    if (_full()) {
+        if (!_keeps(value)) return false;
+        replace_top(std::move(value));
+        return true;
+    }
+
+    _heap.push(std::move(value));
+    _sift_up(_heap.size() - 1);
+    return true;
+}
+
+template <typename T, typename Compare, size_t D>
+template <typename... Args>
+bool mstd::priority_queue<T, Compare, D>::emplace(Args &&... args) {
+    if (_full()) {
+        return push(T(std::forward<Args>(args)...));
+    }
+
+    _heap.emplace(std::forward<Args>(args)...);
+    _sift_up(_heap.size() - 1);
+    return true;
+}
+
+template <typename T, typename Compare, size_t D>
+void mstd::priority_queue<T, Compare, D>::heapify(span<const T> items) {
+    if (_limit >= 0) {
+        for (const T &item : items) {
+            push(item);
+        }
+        return;
+    }
+
+    // Pushing costs about log_D(size) moves per item, rebuilding about one per element in the heap
+    size_t old_size = _heap.size();
+    _heap.reserve(old_size + items.size());
+    for (const T &item : items) {
+        _heap.push(item);
+    }
+
+    size_t depth = 1;
+    for (size_t n = _heap.size(); n > D; n /= D) {
+        depth++;
+    }
+    if (items.size() * depth > _heap.size()) {
+        _build();
+    } else {
+        for (size_t i = old_size; i < _heap.size(); i++) {
+            _sift_up(i);
+        }
+    }
+}
+
+template <typename T, typename Compare, size_t D>
+T mstd::priority_queue<T, Compare, D>::pop() {
+    if (_heap.size() == 0) throw std::runtime_error("priority queue is empty");
+
+    T *h = _heap.begin();
+    T result = std::move(h[0]);
+    size_t last = _heap.size() - 1;
+    if (last > 0) {
+        h[0] = std::move(h[last]);
+    }
+    _heap.pop_back();
+    if (last > 1) {
+        _sift_down(0);
+    }
+    return result;
+}
+
+template <typename T, typename Compare, size_t D>
+void mstd::priority_queue<T, Compare, D>::pop_all(mstd::vector<T> &out) {
+    out.reserve(out.size() + _heap.size());
+    while (_heap.size() > 0) {
+        out.push(pop());
+    }
+}
+
+template <typename T, typename Compare, size_t D>
+const T &mstd::priority_queue<T, Compare, D>::top() const {
+    if (_heap.size() == 0) throw std::runtime_error("priority queue is empty");
+
+    return _heap[0];
+}
+
+template <typename T, typename Compare, size_t D>
+T mstd::priority_queue<T, Compare, D>::replace_top(T value) {
+    if (_heap.size() == 0) throw std::runtime_error("priority queue is empty");
+
+    T *h = _heap.begin();
+    T result = std::move(h[0]);
+    h[0] = std::move(value);
+    _sift_down(0);
+    return result;
+}
+
+template <typename T, typename Compare, size_t D>
+size_t mstd::priority_queue<T, Compare, D>::size() const {
+    return _heap.size();
+}
+
+template <typename T, typename Compare, size_t D>
+bool mstd::priority_queue<T, Compare, D>::empty() const {
+    return _heap.size() == 0;
+}
+
+template <typename T, typename Compare, size_t D>
+int mstd::priority_queue<T, Compare, D>::limit() const {
+    return _limit;
+}
+
+template <typename T, typename Compare, size_t D>
+void mstd::priority_queue<T, Compare, D>::clear() {
+    _heap.clear(_heap.capacity());
+}
+
+template <typename T, typename Compare, size_t D>
+bool mstd::priority_queue<T, Compare, D>::_full() const {
+    return _limit >= 0 && _heap.size() >= (size_t) _limit;
+}
+
+template <typename T, typename Compare, size_t D>
+bool mstd::priority_queue<T, Compare, D>::_keeps(const T &value) const {
+    // A limit of 0 keeps nothing
+    return _heap.size() > 0 && _comp(value, _heap[0]);
+}
+
+template <typename T, typename Compare, size_t D>
+void mstd::priority_queue<T, Compare, D>::_sift_up(size_t index) {
+    T *h = _heap.begin();
+    if (index == 0 || !_comp(h[(index - 1) / D], h[index])) return;
+
+    T value = std::move(h[index]);
+    while (index > 0) {
+        size_t parent = (index - 1) / D;
+        if (!_comp(h[parent], value)) break;
+        h[index] = std::move(h[parent]);
+        index = parent;
+    }
+    h[index] = std::move(value);
+}
+
+template <typename T, typename Compare, size_t D>
+void mstd::priority_queue<T, Compare, D>::_sift_down(size_t index) {
+    // Bottom-up: the hole goes all the way down to a leaf, always to the child that comes out first,
+    // and value then goes back up from there. The value sifted down is usually a leaf taken from the end,
+    // which belongs near the bottom again: this saves comparing it with every level on the way down
+    T *h = _heap.begin();
+    size_t n = _heap.size();
+    size_t start = index;
+    T value = std::move(h[index]);
+    for (;;) {
+        size_t first = D * index + 1;
+        size_t best = first;
+        if (first + D <= n) {
+            // The grandchildren are next to each other, whichever child wins: start loading them now
+            size_t grandchildren = D * first + 1;
+            if (grandchildren < n) {
+                __builtin_prefetch(h + grandchildren);
+                __builtin_prefetch(h + (grandchildren + D * D - 1 < n ? grandchildren + D * D - 1 : n - 1));
+            }
+            // Every child is there: a fixed number of comparisons, without branches (they'd be mispredicted
+            // half the time)
+            for (size_t k = 1; k < D; k++) {
+                best += (size_t) _comp(h[best], h[first + k]) * (first + k - best);
+            }
+        } else if (first < n) {
+            for (size_t child = first + 1; child < n; child++) {
+                best = _comp(h[best], h[child]) ? child : best;
+            }
+        } else {
+            break;
+        }
+        h[index] = std::move(h[best]);
+        index = best;
+    }
+
+    while (index > start) {
+        size_t parent = (index - 1) / D;
+        if (!_comp(h[parent], value)) break;
+        h[index] = std::move(h[parent]);
+        index = parent;
+    }
+    h[index] = std::move(value);
+}
+
+template <typename T, typename Compare, size_t D>
+void mstd::priority_queue<T, Compare, D>::_build() {
+    size_t n = _heap.size();
+    if (n < 2) return;
+
+    for (size_t i = (n - 2) / D + 1; i-- > 0;) {
+        _sift_down(i);
+    }
+}
+
+#endif // PRIORITY_QUEUE_HPP
@@ -0,0 +1,540 @@
+#ifndef SMALL_VECTOR_HPP
+#define SMALL_VECTOR_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "mvector.hpp"
+#include "span.hpp"
+
+// mstd::vector with room for N elements inside the object itself.
+// Up to N elements it never allocates. The (N+1)-th element moves everything to the heap,
+// after which it behaves exactly like mstd::vector (and stays there until shrink_to_size() brings it back).
+// Same API as mstd::vector, so either can be used wherever the other is. Heap buffers come from a memory_resource
+namespace mstd {
+    template <typename T, size_t N>
+    class small_vector {
+
+    public:
+        explicit small_vector(size_t capacity = N, memory_resource *resource = default_resource());
+
+        small_vector(const small_vector &other);
+        small_vector(T *arr, size_t arr_size, memory_resource *resource = default_resource());
+        small_vector(const small_vector &other, size_t start, size_t end);
+        small_vector(small_vector &&other) noexcept;
+
+        ~small_vector();
+
+        void push(const T &ent);
+        void push(T &&ent);
+        // Constructs the new element from args
+        template <typename... Args>
+        T &emplace(Args &&... args);
+        T *m_push(T &ent);
+        T *m_insert_at(int index, T &ent);
+
+        T &back();
+        void pop_back();
+
+        // Moves the elements back inline if they fit
+        void shrink_to_size();
+
+        // Makes room for capacity elements. Never shrinks
+        void reserve(size_t capacity);
+
+        // Capacity is multiplied by factor (> 1) on growth (once on the heap)
+        void set_growth_factor(double factor);
+
+        bool in(const T &ent) const;
+
+        // Index of the first element equal to ent, or size() if there's none
+        size_t find(const T &ent) const;
+
+        size_t count(const T &ent) const;
+
+        // Index of the first smallest (largest) element, or 0 if the vector is empty
+        size_t min_element() const;
+
+        size_t max_element() const;
+
+        // Same size, and equal elements
+        bool equal(const small_vector &other) const;
+
+        T &at(size_t index) const;
+
+        T *at_p(size_t index);
+
+        // View of the elements [start, end), valid until the vector is resized (or moved, while inline)
+        span<T> slice(size_t start, size_t end);
+
+        span<const T> slice(size_t start, size_t end) const;
+
+        // Destroys every element. Keeps the current storage, growing it to new_cap if needed
+        void clear(size_t new_cap = N);
+
+        void set_at(size_t index, const T &ent);
+
+        // iterators. allows for foreach loops
+        // (for (int i : vec))
+        T *begin();
+
+        T *end();
+
+        void remove_at(size_t index);
+
+        size_t capacity() const;
+
+        size_t size() const;
+
+        // True while the elements are stored inline
+        bool is_small() const;
+
+        memory_resource *get_resource() const;
+
+        T &operator[](size_t index) const;
+
+        // View of every element, valid until the vector is resized (or moved, while inline)
+        operator span<T>();
+
+        operator span<const T>() const;
+
+        // Copy assignment operator
+        small_vector &operator=(const small_vector &other);
+
+        // Move assignment operator
+        small_vector &operator=(small_vector &&other) noexcept;
+
+    private:
+        typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        size_t _size;
+        size_t _capacity;
+        T *_entries;
+        double _growth_factor;
+        memory_resource *_resource;
+        storage _inline[N];
+
+        static const bool _trivial = std::is_trivially_copyable<T>::value;
+
+        T *_inline_entries() const;
+
+        void _enlarge();
+
+        // Moves the elements to a buffer of new_capacity slots (the inline one if new_capacity <= N)
+        void _reallocate(size_t new_capacity);
+
+        // Moves (or steals) other's elements into this, which has to be empty and inline
+        void _take(small_vector &other);
+
+        void _destroy_all();
+
+        void _free();
+    };
+}
+
+template <typename T, size_t N>
+mstd::small_vector<T, N>::small_vector(size_t capacity, memory_resource *resource)
+        : _size(0), _capacity(N), _growth_factor(vector_constants::default_growth_factor), _resource(resource) {
+    static_assert(N > 0, "small_vector needs room for at least one inline element");
+    _entries = _inline_entries();
+    reserve(capacity);
+}
+
+template <typename T, size_t N>
+mstd::small_vector<T, N>::small_vector(const small_vector &other) : small_vector(other._size, other._resource) {
+    _growth_factor = other._growth_factor;
+    std::uninitialized_copy(other._entries, other._entries + other._size, _entries);
+    _size = other._size;
+}
+
+template <typename T, size_t N>
+mstd::small_vector<T, N>::small_vector(T *arr, size_t arr_size, memory_resource *resource)
+        : small_vector(arr_size, resource) {
+    std::uninitialized_copy(arr, arr + arr_size, _entries);
+    _size = arr_size;
+}
+
+template <typename T, size_t N>
+mstd::small_vector<T, N>::small_vector(const small_vector &other, size_t start, size_t end)
+        : small_vector(N, other._resource) {
+    if (start > end || end > other._size) return;
+    reserve(end - start);
+    std::uninitialized_copy(other._entries + start, other._entries + end, _entries);
+    _size = end - start;
+}
+
+template <typename T, size_t N>
+mstd::small_vector<T, N>::small_vector(small_vector &&other) noexcept : small_vector(N, other._resource) {
+    _take(other);
+}
+
+template <typename T, size_t N>
+mstd::small_vector<T, N>::~small_vector() {
+    _destroy_all();
+    _free();
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::push(const T &ent) {
+    if (_size + 1 > _capacity) {
+        // ent may be one of our own elements: copy it before the storage moves
+        T tmp(ent);
+        _enlarge();
+        new (&_entries[_size++]) T(std::move(tmp));
+        return;
+    }
+
+    new (&_entries[_size++]) T(ent);
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::push(T &&ent) {
+    if (_size + 1 > _capacity) {
+        T tmp(std::move(ent));
+        _enlarge();
+        new (&_entries[_size++]) T(std::move(tmp));
+        return;
+    }
+
+    new (&_entries[_size++]) T(std::move(ent));
+}
+
+template <typename T, size_t N>
+template <typename... Args>
+T &mstd::small_vector<T, N>::emplace(Args &&... args) {
+    if (_size + 1 > _capacity) {
+        // args may refer to our own elements
+        T tmp(std::forward<Args>(args)...);
+        _enlarge();
+        new (&_entries[_size]) T(std::move(tmp));
+        return _entries[_size++];
+    }
+
+    new (&_entries[_size]) T(std::forward<Args>(args)...);
+    return _entries[_size++];
+}
+
+template <typename T, size_t N>
+T *mstd::small_vector<T, N>::m_push(T &ent) {
+    push(std::move(ent));
+    return &_entries[_size - 1];
+}
+
+template <typename T, size_t N>
+T *mstd::small_vector<T, N>::m_insert_at(int index, T &ent) {
+    if (index < 0 || (size_t) index > _size) {
+        throw std::out_of_range("Index out of range");
+    }
+
+    if ((_size == 0) || ((size_t) index == _size)) {
+        return m_push(ent);
+    }
+
+    if (_size + 1 > _capacity) _enlarge();
+
+    // The last element moves into raw storage, the others are shifted by assignment
+    new (&_entries[_size]) T(std::move(_entries[_size - 1]));
+    for (size_t i = _size - 1; i > (size_t) index; i--) {
+        _entries[i] = std::move(_entries[i - 1]);
+    }
+
+    _entries[index] = std::move(ent);
+    _size++;
+    return &_entries[index];
+}
+
+template <typename T, size_t N>
+T &mstd::small_vector<T, N>::back() {
+    if (_size == 0) {
+        throw std::out_of_range("Requesting back of empty vector");
+    }
+    return _entries[_size - 1];
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::pop_back() {
+    if (_size == 0) {
+        return;
+    }
+
+    _entries[--_size].~T();
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::shrink_to_size() {
+    size_t wanted = _size > N ? _size : N;
+    if (wanted != _capacity) {
+        _reallocate(wanted);
+    }
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::reserve(size_t capacity) {
+    if (capacity > _capacity) {
+        _reallocate(capacity);
+    }
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::set_growth_factor(double factor) {
+    if (factor <= 1) {
+        throw std::invalid_argument("Growth factor must be greater than 1");
+    }
+    _growth_factor = factor;
+}
+
+template <typename T, size_t N>
+bool mstd::small_vector<T, N>::in(const T &ent) const {
+    return simd::find(_entries, _size, ent) != _size;
+}
+
+template <typename T, size_t N>
+size_t mstd::small_vector<T, N>::find(const T &ent) const {
+    return simd::find(_entries, _size, ent);
+}
+
+template <typename T, size_t N>
+size_t mstd::small_vector<T, N>::count(const T &ent) const {
+    return simd::count(_entries, _size, ent);
+}
+
+template <typename T, size_t N>
+size_t mstd::small_vector<T, N>::min_element() const {
+    return simd::min_element(_entries, _size);
+}
+
+template <typename T, size_t N>
+size_t mstd::small_vector<T, N>::max_element() const {
+    return simd::max_element(_entries, _size);
+}
+
+template <typename T, size_t N>
+bool mstd::small_vector<T, N>::equal(const small_vector &other) const {
+    return _size == other._size && simd::equal(_entries, other._entries, _size);
+}
+
+template <typename T, size_t N>
+T &mstd::small_vector<T, N>::at(size_t index) const {
+    if (index >= _size) {
+        throw std::out_of_range("Index out of range:");
+    }
+
+    return _entries[index];
+}
+
+template <typename T, size_t N>
+T *mstd::small_vector<T, N>::at_p(size_t index) {
+    if (index >= _size) {
+        throw std::out_of_range("Index out of range");
+    }
+
+    return &_entries[index];
+}
+
+template <typename T, size_t N>
+mstd::span<T> mstd::small_vector<T, N>::slice(size_t start, size_t end) {
+    if (start > end || end > _size) {
+        throw std::out_of_range("Bad slice: [" + std::to_string(start) + ", " + std::to_string(end) + ")");
+    }
+
+    return span<T>(_entries + start, end - start);
+}
+
+template <typename T, size_t N>
+mstd::span<const T> mstd::small_vector<T, N>::slice(size_t start, size_t end) const {
+    if (start > end || end > _size) {
+        throw std::out_of_range("Bad slice: [" + std::to_string(start) + ", " + std::to_string(end) + ")");
+    }
+
+    return span<const T>(_entries + start, end - start);
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::clear(size_t new_cap) {
+    _destroy_all();
+    reserve(new_cap);
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::set_at(size_t index, const T &ent) {
+    if (index >= _size) {
+        throw std::out_of_range("Bad index: " + std::to_string(index));
+    }
+
+    _entries[index] = T(ent);
+}
+
+template <typename T, size_t N>
+T *mstd::small_vector<T, N>::begin() {
+    return _entries;
+}
+
+template <typename T, size_t N>
+T *mstd::small_vector<T, N>::end() {
+    return _entries + _size;
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::remove_at(size_t index) {
+    if (index >= _size) {
+        throw std::out_of_range("Bad index: " + std::to_string(index));
+    }
+
+    for (size_t i = index + 1; i < _size; i++) {
+        _entries[i - 1] = std::move(_entries[i]);
+    }
+
+    _entries[--_size].~T();
+}
+
+template <typename T, size_t N>
+size_t mstd::small_vector<T, N>::capacity() const {
+    return _capacity;
+}
+
+template <typename T, size_t N>
+size_t mstd::small_vector<T, N>::size() const {
+    return _size;
+}
+
+template <typename T, size_t N>
+bool mstd::small_vector<T, N>::is_small() const {
+    return _entries == _inline_entries();
+}
+
+template <typename T, size_t N>
+mstd::memory_resource *mstd::small_vector<T, N>::get_resource() const {
+    return _resource;
+}
+
+template <typename T, size_t N>
+T &mstd::small_vector<T, N>::operator[](size_t index) const {
+    return at(index);
+}
+
+template <typename T, size_t N>
+mstd::small_vector<T, N>::operator span<T>() {
+    return span<T>(_entries, _size);
+}
+
+template <typename T, size_t N>
+mstd::small_vector<T, N>::operator span<const T>() const {
+    return span<const T>(_entries, _size);
+}
+
+template <typename T, size_t N>
+mstd::small_vector<T, N> &mstd::small_vector<T, N>::operator=(const small_vector &other) {
+    if (this != &other) {
+        small_vector tmp(other);
+        *this = std::move(tmp);
+    }
+
+    return *this;
+}
+
+template <typename T, size_t N>
+mstd::small_vector<T, N> &mstd::small_vector<T, N>::operator=(small_vector &&other) noexcept {
+    if (this != &other) {
+        _destroy_all();
+        _free();
+        _entries = _inline_entries();
+        _capacity = N;
+        _resource = other._resource;
+        _take(other);
+    }
+
+    return *this;
+}
+
+template <typename T, size_t N>
+T *mstd::small_vector<T, N>::_inline_entries() const {
+    return reinterpret_cast<T *>(const_cast<storage *>(_inline));
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::_enlarge() {
+    auto grown = (size_t) ((double) _capacity * _growth_factor);
+    _reallocate(grown > _capacity ? grown : _capacity + 1);
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::_reallocate(size_t new_capacity) {
+    bool to_inline = new_capacity <= N;
+    if (to_inline && is_small()) {
+        return;
+    }
+
+    if (_trivial && !is_small() && !to_inline) {
+        // Heap to heap: realloc may not even have to move the elements
+        void *tmp = _resource->reallocate(_entries, _capacity * sizeof(T), new_capacity * sizeof(T), alignof(T));
+        _entries = static_cast<T *>(tmp);
+        _capacity = new_capacity;
+        return;
+    }
+
+    T *tmp;
+    if (to_inline) {
+        tmp = _inline_entries();
+        new_capacity = N;
+    } else {
+        tmp = static_cast<T *>(_resource->allocate(new_capacity * sizeof(T), alignof(T)));
+    }
+
+    if (_trivial) {
+        memcpy((void *) tmp, (const void *) _entries, _size * sizeof(T));
+    } else {
+        for (size_t i = 0; i < _size; i++) {
+            new (&tmp[i]) T(std::move(_entries[i]));
+            _entries[i].~T();
+        }
+    }
+
+    _free();
+    _entries = tmp;
+    _capacity = new_capacity;
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::_take(small_vector &other) {
+    _growth_factor = other._growth_factor;
+    if (other.is_small()) {
+        for (size_t i = 0; i < other._size; i++) {
+            new (&_entries[i]) T(std::move(other._entries[i]));
+        }
+        _size = other._size;
+        other._destroy_all();
+        return;
+    }
+
+    // A heap buffer can simply change hands
+    _entries = other._entries;
+    _capacity = other._capacity;
+    _size = other._size;
+    other._entries = other._inline_entries();
+    other._capacity = N;
+    other._size = 0;
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::_destroy_all() {
+    if (!std::is_trivially_destructible<T>::value) {
+        for (size_t i = 0; i < _size; i++) {
+            _entries[i].~T();
+        }
+    }
+    _size = 0;
+}
+
+template <typename T, size_t N>
+void mstd::small_vector<T, N>::_free() {
+    if (!is_small()) {
+        _resource->deallocate(_entries, _capacity * sizeof(T), alignof(T));
+    }
+}
+
+#endif // SMALL_VECTOR_HPP
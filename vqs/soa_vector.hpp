@@ -0,0 +1,499 @@
+#ifndef SOA_VECTOR_HPP
+#define SOA_VECTOR_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "memory_resource.hpp"
+#include "span.hpp"
+
+namespace soa_vector_constants {
+    // Capacity is multiplied by this when the columns are full
+    const double growth_factor = 2.0;
+}
+
+namespace mstd {
+    namespace detail {
+        // C++14's std::index_sequence
+        template <size_t... Is>
+        struct index_sequence { };
+
+        template <size_t N, size_t... Is>
+        struct make_index_sequence : make_index_sequence<N - 1, N - 1, Is...> { };
+
+        template <size_t... Is>
+        struct make_index_sequence<0, Is...> : index_sequence<Is...> { };
+    }
+
+    // Resizable array of records, stored as a struct of arrays: field I of every record lives in column I,
+    // a contiguous array of its own. A loop over one field only loads that field's memory, and column<I>()
+    // hands the column out as a span for vectorised loops.
+    // Records go in whole (push), and come out a field at a time (get, column) or through a row proxy:
+    //
+    //     mstd::soa_vector<int64_t, double, std::string> trades;
+    //     trades.push(1, 9.5, "AAPL");
+    //     trades[0].get<1>() += 1;
+    //     for (double price : trades.column<1>()) { ... }
+    //
+    // The columns grow together, from a memory_resource. Trivially copyable columns are grown with the
+    // resource's reallocate, as in mstd::vector
+    template <typename... Fields>
+    class soa_vector {
+    public:
+        typedef std::tuple<Fields...> value_type;
+
+        template <size_t I>
+        using field_type = typename std::tuple_element<I, value_type>::type;
+
+        // One record of a soa_vector: reads and writes go straight to the columns
+        class row {
+        public:
+            template <size_t I>
+            field_type<I> &get() const { return _owner->template get<I>(_index); }
+
+            size_t index() const { return _index; }
+
+            // Assigns every field
+            const row &operator=(const value_type &record) const;
+
+            operator value_type() const { return _owner->record(_index); }
+
+        private:
+            soa_vector *_owner;
+            size_t _index;
+
+            row(soa_vector *owner, size_t index) : _owner(owner), _index(index) { }
+
+            friend class soa_vector;
+        };
+
+        explicit soa_vector(size_t capacity = 1, memory_resource *resource = default_resource());
+
+        soa_vector(const soa_vector &other);
+        soa_vector(soa_vector &&other) noexcept;
+
+        ~soa_vector();
+
+        void push(const Fields &... fields);
+        void push(Fields &&... fields);
+        void push(const value_type &record);
+
+        void pop_back();
+
+        void remove_at(size_t index);
+
+        // Destroys every record. Keeps the storage
+        void clear();
+
+        // Makes room for capacity records. Never shrinks
+        void reserve(size_t capacity);
+
+        // Field I of every record, in order
+        template <size_t I>
+        span<field_type<I>> column();
+
+        template <size_t I>
+        span<const field_type<I>> column() const;
+
+        // Field I of the record at index
+        template <size_t I>
+        field_type<I> &get(size_t index);
+
+        template <size_t I>
+        const field_type<I> &get(size_t index) const;
+
+        // A copy of the record at index
+        value_type record(size_t index) const;
+
+        row at(size_t index);
+
+        row operator[](size_t index);
+
+        size_t size() const;
+
+        size_t capacity() const;
+
+        memory_resource *get_resource() const;
+
+        soa_vector &operator=(const soa_vector &other);
+
+        soa_vector &operator=(soa_vector &&other) noexcept;
+
+    private:
+        typedef detail::make_index_sequence<sizeof...(Fields)> _indices;
+
+        size_t _size;
+        size_t _capacity;
+        std::tuple<Fields *...> _columns;
+        memory_resource *_resource;
+
+        // Column operations, called on every column by _each
+
+        struct _allocate_op {
+            size_t capacity;
+            memory_resource *resource;
+
+            template <typename F>
+            void operator()(F *&column) const {
+                column = static_cast<F *>(resource->allocate((capacity > 0 ? capacity : 1) * sizeof(F), alignof(F)));
+            }
+        };
+
+        struct _free_op {
+            size_t capacity;
+            memory_resource *resource;
+
+            template <typename F>
+            void operator()(F *&column) const {
+                resource->deallocate(column, (capacity > 0 ? capacity : 1) * sizeof(F), alignof(F));
+            }
+        };
+
+        // Destroys the elements [from, to) of every column, or of the first count columns only
+        struct _destroy_op {
+            size_t from;
+            size_t to;
+            size_t count;
+
+            template <typename F>
+            void operator()(F *&column) {
+                if (count == 0) return;
+                count--;
+                if (!std::is_trivially_destructible<F>::value) {
+                    for (size_t i = from; i < to; i++) {
+                        column[i].~F();
+                    }
+                }
+            }
+        };
+
+        struct _reallocate_op {
+            size_t size;
+            size_t old_capacity;
+            size_t new_capacity;
+            memory_resource *resource;
+
+            template <typename F>
+            void operator()(F *&column) const {
+                size_t old_bytes = (old_capacity > 0 ? old_capacity : 1) * sizeof(F);
+                size_t new_bytes = (new_capacity > 0 ? new_capacity : 1) * sizeof(F);
+                if (std::is_trivially_copyable<F>::value) {
+                    column = static_cast<F *>(resource->reallocate(column, old_bytes, new_bytes, alignof(F)));
+                    return;
+                }
+                F *tmp = static_cast<F *>(resource->allocate(new_bytes, alignof(F)));
+                for (size_t i = 0; i < size; i++) {
+                    new (&tmp[i]) F(std::move(column[i]));
+                    column[i].~F();
+                }
+                resource->deallocate(column, old_bytes, alignof(F));
+                column = tmp;
+            }
+        };
+
+        // Shifts the elements after index down by one, and destroys the last one
+        struct _erase_op {
+            size_t index;
+            size_t size;
+
+            template <typename F>
+            void operator()(F *&column) const {
+                for (size_t i = index + 1; i < size; i++) {
+                    column[i - 1] = std::move(column[i]);
+                }
+                column[size - 1].~F();
+            }
+        };
+
+        template <typename Op, size_t... Is>
+        void _each(Op &op, detail::index_sequence<Is...>);
+
+        template <typename Op>
+        void _each(Op op);
+
+        template <size_t... Is>
+        void _copy_columns(const soa_vector &other, detail::index_sequence<Is...>);
+
+        // Constructs the record at _size from args, one per field. If a field throws, the ones already
+        // constructed are destroyed
+        template <size_t... Is, typename... Args>
+        void _construct_back(detail::index_sequence<Is...>, Args &&... args);
+
+        template <size_t... Is>
+        void _push_tuple(value_type &&record, detail::index_sequence<Is...>);
+
+        template <size_t... Is>
+        void _assign(size_t index, const value_type &record, detail::index_sequence<Is...>);
+
+        template <size_t... Is>
+        value_type _record(size_t index, detail::index_sequence<Is...>) const;
+
+        void _enlarge();
+
+        void _reallocate(size_t new_capacity);
+
+        void _check_index(size_t index) const;
+
+        void _swap(soa_vector &other) noexcept;
+    };
+}
+
+template <typename... Fields>
+const typename mstd::soa_vector<Fields...>::row &
+mstd::soa_vector<Fields...>::row::operator=(const value_type &record) const {
+    _owner->_assign(_index, record, _indices());
+    return *this;
+}
+
+template <typename... Fields>
+mstd::soa_vector<Fields...>::soa_vector(size_t capacity, memory_resource *resource)
+        : _size(0), _capacity(capacity), _resource(resource) {
+    _each(_allocate_op{_capacity, _resource});
+}
+
+template <typename... Fields>
+mstd::soa_vector<Fields...>::soa_vector(const soa_vector &other)
+        : _size(0), _capacity(other._capacity), _resource(other._resource) {
+    _each(_allocate_op{_capacity, _resource});
+    _copy_columns(other, _indices());
+    _size = other._size;
+}
+
+template <typename... Fields>
+mstd::soa_vector<Fields...>::soa_vector(soa_vector &&other) noexcept : soa_vector() {
+    _swap(other);
+}
+
+template <typename... Fields>
+mstd::soa_vector<Fields...>::~soa_vector() {
+    clear();
+    _each(_free_op{_capacity, _resource});
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::push(const Fields &... fields) {
+    if (_size + 1 > _capacity) {
+        // fields may be our own elements: copy them before the columns move
+        value_type tmp(fields...);
+        _enlarge();
+        _push_tuple(std::move(tmp), _indices());
+        return;
+    }
+
+    _construct_back(_indices(), fields...);
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::push(Fields &&... fields) {
+    if (_size + 1 > _capacity) {
+        value_type tmp(std::move(fields)...);
+        _enlarge();
+        _push_tuple(std::move(tmp), _indices());
+        return;
+    }
+
+    _construct_back(_indices(), std::move(fields)...);
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::push(const value_type &record) {
+    value_type tmp(record);
+    if (_size + 1 > _capacity) _enlarge();
+    _push_tuple(std::move(tmp), _indices());
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::pop_back() {
+    if (_size == 0) {
+        return;
+    }
+
+    _each(_destroy_op{_size - 1, _size, sizeof...(Fields)});
+    _size--;
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::remove_at(size_t index) {
+    _check_index(index);
+
+    _each(_erase_op{index, _size});
+    _size--;
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::clear() {
+    _each(_destroy_op{0, _size, sizeof...(Fields)});
+    _size = 0;
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::reserve(size_t capacity) {
+    if (capacity > _capacity) {
+        _reallocate(capacity);
+    }
+}
+
+template <typename... Fields>
+template <size_t I>
+mstd::span<typename mstd::soa_vector<Fields...>::template field_type<I>> mstd::soa_vector<Fields...>::column() {
+    return span<field_type<I>>(std::get<I>(_columns), _size);
+}
+
+template <typename... Fields>
+template <size_t I>
+mstd::span<const typename mstd::soa_vector<Fields...>::template field_type<I>>
+mstd::soa_vector<Fields...>::column() const {
+    return span<const field_type<I>>(std::get<I>(_columns), _size);
+}
+
+template <typename... Fields>
+template <size_t I>
+typename mstd::soa_vector<Fields...>::template field_type<I> &mstd::soa_vector<Fields...>::get(size_t index) {
+    _check_index(index);
+    return std::get<I>(_columns)[index];
+}
+
+template <typename... Fields>
+template <size_t I>
+const typename mstd::soa_vector<Fields...>::template field_type<I> &
+mstd::soa_vector<Fields...>::get(size_t index) const {
+    _check_index(index);
+    return std::get<I>(_columns)[index];
+}
+
+template <typename... Fields>
+typename mstd::soa_vector<Fields...>::value_type mstd::soa_vector<Fields...>::record(size_t index) const {
+    _check_index(index);
+    return _record(index, _indices());
+}
+
+template <typename... Fields>
+typename mstd::soa_vector<Fields...>::row mstd::soa_vector<Fields...>::at(size_t index) {
+    _check_index(index);
+    return row(this, index);
+}
+
+template <typename... Fields>
+typename mstd::soa_vector<Fields...>::row mstd::soa_vector<Fields...>::operator[](size_t index) {
+    return at(index);
+}
+
+template <typename... Fields>
+size_t mstd::soa_vector<Fields...>::size() const {
+    return _size;
+}
+
+template <typename... Fields>
+size_t mstd::soa_vector<Fields...>::capacity() const {
+    return _capacity;
+}
+
+template <typename... Fields>
+mstd::memory_resource *mstd::soa_vector<Fields...>::get_resource() const {
+    return _resource;
+}
+
+template <typename... Fields>
+mstd::soa_vector<Fields...> &mstd::soa_vector<Fields...>::operator=(const soa_vector &other) {
+    soa_vector tmp(other);
+    _swap(tmp);
+
+    return *this;
+}
+
+template <typename... Fields>
+mstd::soa_vector<Fields...> &mstd::soa_vector<Fields...>::operator=(soa_vector &&other) noexcept {
+    _swap(other);
+
+    return *this;
+}
+
+template <typename... Fields>
+template <typename Op, size_t... Is>
+void mstd::soa_vector<Fields...>::_each(Op &op, detail::index_sequence<Is...>) {
+    int unused[] = {0, (op(std::get<Is>(_columns)), 0)...};
+    (void) unused;
+}
+
+template <typename... Fields>
+template <typename Op>
+void mstd::soa_vector<Fields...>::_each(Op op) {
+    _each(op, _indices());
+}
+
+template <typename... Fields>
+template <size_t... Is>
+void mstd::soa_vector<Fields...>::_copy_columns(const soa_vector &other, detail::index_sequence<Is...>) {
+    int unused[] = {0, (std::uninitialized_copy(std::get<Is>(other._columns), std::get<Is>(other._columns) + other._size,
+                                                std::get<Is>(_columns)), 0)...};
+    (void) unused;
+}
+
+template <typename... Fields>
+template <size_t... Is, typename... Args>
+void mstd::soa_vector<Fields...>::_construct_back(detail::index_sequence<Is...>, Args &&... args) {
+    size_t constructed = 0;
+    try {
+        int unused[] = {0, (new (&std::get<Is>(_columns)[_size]) Fields(std::forward<Args>(args)), constructed++, 0)...};
+        (void) unused;
+    } catch (...) {
+        _each(_destroy_op{_size, _size + 1, constructed});
+        throw;
+    }
+    _size++;
+}
+
+template <typename... Fields>
+template <size_t... Is>
+void mstd::soa_vector<Fields...>::_push_tuple(value_type &&record, detail::index_sequence<Is...>) {
+    _construct_back(_indices(), std::move(std::get<Is>(record))...);
+}
+
+template <typename... Fields>
+template <size_t... Is>
+void mstd::soa_vector<Fields...>::_assign(size_t index, const value_type &record, detail::index_sequence<Is...>) {
+    int unused[] = {0, (std::get<Is>(_columns)[index] = std::get<Is>(record), 0)...};
+    (void) unused;
+}
+
+template <typename... Fields>
+template <size_t... Is>
+typename mstd::soa_vector<Fields...>::value_type
+mstd::soa_vector<Fields...>::_record(size_t index, detail::index_sequence<Is...>) const {
+    return value_type(std::get<Is>(_columns)[index]...);
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::_enlarge() {
+    auto grown = (size_t) ((double) _capacity * soa_vector_constants::growth_factor);
+    _reallocate(grown > _capacity ? grown : _capacity + 1);
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::_reallocate(size_t new_capacity) {
+    _each(_reallocate_op{_size, _capacity, new_capacity, _resource});
+    _capacity = new_capacity;
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::_check_index(size_t index) const {
+    if (index >= _size) {
+        throw std::out_of_range("Index out of range");
+    }
+}
+
+template <typename... Fields>
+void mstd::soa_vector<Fields...>::_swap(soa_vector &other) noexcept {
+    using std::swap;
+    swap(_size, other._size);
+    swap(_capacity, other._capacity);
+    swap(_columns, other._columns);
+    swap(_resource, other._resource);
+}
+
+#endif // SOA_VECTOR_HPP